@@ -0,0 +1,90 @@
+// Fused (expression template) versus temporaries-based evaluation of
+//
+//    E = sqrt(p*p*c2 + m*m*c2*c2)
+//
+// over arrays of 10^7 elements. The temporaries-based form materializes every
+// intermediate result with physics::eval(), which is what operator overloading
+// returning arrays would do.
+//
+// usage: bench_expression [n_elements] [n_repeats]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+#include "physics/unit.hh"
+#include "physics/unit/array.hh"
+#include "physics/unit/constants.hh"
+#include "physics/unit/standard.hh"
+
+namespace su = physics::standard_units;
+
+using momentum_unit = decltype(su::energy::MeV{} / su::constants::c)::unit;
+using mass_unit = decltype(su::energy::MeV{} / su::constants::c2)::unit;
+using momentum_array = physics::quantity_array<momentum_unit>;
+using mass_array = physics::quantity_array<mass_unit>;
+using energy_array = physics::quantity_array<su::energy::MeV::unit>;
+
+void fused(const momentum_array& p, const mass_array& m, energy_array& E) {
+  const auto c2 = su::constants::c2;
+  E = sqrt(p * p * c2 + m * m * c2 * c2);
+}
+
+void temporaries(const momentum_array& p, const mass_array& m,
+                 energy_array& E) {
+  const auto c2 = su::constants::c2;
+  auto p2 = physics::eval(p * p);
+  auto p2c2 = physics::eval(p2 * c2);
+  auto m2 = physics::eval(m * m);
+  auto m2c2 = physics::eval(m2 * c2);
+  auto m2c4 = physics::eval(m2c2 * c2);
+  auto E2 = physics::eval(p2c2 + m2c4);
+  E = sqrt(E2);
+}
+
+// best wall time of n_repeats calls, in seconds
+template <class F> double best_of(size_t n_repeats, F f) {
+  double best{std::numeric_limits<double>::max()};
+  for (size_t r = 0; r < n_repeats; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(stop - start).count());
+  }
+  return best;
+}
+
+int main(int argc, char* argv[]) {
+  const size_t n{argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000ul};
+  const size_t n_repeats{argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5ul};
+
+  momentum_array p(n);
+  mass_array m(n);
+  energy_array E1(n);
+  energy_array E2(n);
+  for (size_t i = 0; i < n; ++i) {
+    p[i] = physics::quantity<momentum_unit>{1. + (i % 1000)};
+    m[i] = physics::quantity<mass_unit>{0.511 + (i % 100)};
+  }
+
+  const double t_fused{best_of(n_repeats, [&] { fused(p, m, E1); })};
+  const double t_temp{best_of(n_repeats, [&] { temporaries(p, m, E2); })};
+
+  // sanity check: both forms have to agree
+  double max_rel{0};
+  for (size_t i = 0; i < n; ++i) {
+    max_rel = std::max(max_rel,
+                       std::abs((E1[i] - E2[i]).value()) / E1[i].value());
+  }
+
+  std::printf("elements:     %zu\n", n);
+  std::printf("fused:        %8.3f ns/element\n", 1e9 * t_fused / n);
+  std::printf("temporaries:  %8.3f ns/element\n", 1e9 * t_temp / n);
+  std::printf("speedup:      %8.2fx\n", t_temp / t_fused);
+  std::printf("max rel diff: %8.2e\n", max_rel);
+
+  return (max_rel < 1e-12 && t_fused < t_temp) ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// Timing of the tiled jet clustering in physics/vector/jet.hh.
+//
+// Clusters events of N random particles (pt falling off from 0.5 to 10.5,
+// flat in |y| < 5 and phi) with kt, Cambridge/Aachen and anti-kt, and prints
+// the best time of all repeats per event, and the number of jets.
+//
+// usage: bench_jet [--radius=R] [--repeats=N]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "physics/vector.hh"
+#include "physics/vector/jet.hh"
+
+namespace {
+// parse --key=value command line options
+const char* option(int argc, char* argv[], const char* key) {
+  const std::size_t len{std::strlen(key)};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], key, len) == 0 && argv[i][len] == '=') {
+      return argv[i] + len + 1;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<physics::lorentzvector<double>> make_event(std::size_t n) {
+  std::mt19937 rng{1};
+  std::uniform_real_distribution<double> u{0., 1.};
+  std::vector<physics::lorentzvector<double>> particles;
+  particles.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const double pt{0.5 + 10 * u(rng) * u(rng)};
+    const double y{10 * u(rng) - 5};
+    const double phi{2 * M_PI * u(rng)};
+    particles.push_back(
+        {pt * std::cosh(y),
+         {pt * std::cos(phi), pt * std::sin(phi), pt * std::sinh(y)}});
+  }
+  return particles;
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const char* opt_radius{option(argc, argv, "--radius")};
+  const char* opt_repeats{option(argc, argv, "--repeats")};
+  const double radius{opt_radius ? std::strtod(opt_radius, nullptr) : 0.4};
+  const std::size_t n_repeats{
+      opt_repeats ? std::strtoul(opt_repeats, nullptr, 10) : 20};
+
+  const struct {
+    const char* name;
+    physics::jet_algorithm algorithm;
+  } algorithms[]{{"kt", physics::jet_algorithm::kt},
+                 {"cambridge", physics::jet_algorithm::cambridge_aachen},
+                 {"antikt", physics::jet_algorithm::antikt}};
+  std::printf("%-10s %8s %8s %12s\n", "algorithm", "N", "jets", "ms/event");
+  for (const std::size_t n : {500, 1000, 2000, 5000, 10000}) {
+    const auto particles = make_event(n);
+    for (const auto& a : algorithms) {
+      const physics::jet_definition definition{a.algorithm, radius};
+      double best{std::numeric_limits<double>::max()};
+      std::size_t n_jets{0};
+      for (std::size_t r = 0; r <= n_repeats; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto jets = physics::cluster(particles, definition);
+        const auto stop = std::chrono::steady_clock::now();
+        n_jets = jets.size();
+        best = std::min(
+            best,
+            std::chrono::duration<double, std::milli>(stop - start).count());
+      }
+      std::printf("%-10s %8zu %8zu %12.3f\n", a.name, n, n_jets, best);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+// Startup time and peak memory of reading a large calibration file, with
+// boost::property_tree::read_json and with the streaming reader in
+// physics/util/json.hh.
+//
+// Writes a synthetic calibration file (channels with a few scalar settings
+// and an array of pedestals) of about M megabytes, and reads it in a child
+// process per method, to measure the peak resident memory of every method on
+// its own. Prints the best time of all repeats, and the peak RSS above the
+// baseline (a child that does not read the file).
+//
+// usage: bench_json [--mb=M] [--repeats=N]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "physics/util/configuration.hh"
+#include "physics/util/json.hh"
+
+namespace {
+// parse --key=value command line options
+const char* option(int argc, char* argv[], const char* key) {
+  const std::size_t len{std::strlen(key)};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], key, len) == 0 && argv[i][len] == '=') {
+      return argv[i] + len + 1;
+    }
+  }
+  return nullptr;
+}
+
+// {"calib": {"module": "calib", "ch0": {"gain": ..., "pedestals": [...]}, ..}}
+std::size_t write_calibration(const std::string& path, std::size_t bytes) {
+  std::mt19937 rng{1};
+  std::uniform_real_distribution<double> u{0., 1.};
+  std::ofstream out{path};
+  out << "{\"calib\": {\"module\": \"calib\"";
+  std::size_t n_channels{0};
+  while (static_cast<std::size_t>(out.tellp()) < bytes) {
+    out << ",\n \"ch" << n_channels++ << "\": {\"gain\": \"" << 1 + u(rng)
+        << "\", \"enabled\": \"true\", \"pedestals\": [";
+    for (int i = 0; i < 256; ++i) {
+      out << (i ? ", " : "") << physics::json_number_text(100 * u(rng));
+    }
+    out << "]}";
+  }
+  out << "}}\n";
+  return n_channels;
+}
+
+// run f in a child process, returns the best time (ms) and the peak RSS (kB)
+std::pair<double, long> measure(const std::function<void()>& f,
+                                std::size_t n_repeats) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    std::perror("pipe");
+    std::exit(1);
+  }
+  // (the child must not write the buffered output again)
+  std::fflush(stdout);
+  const pid_t pid{fork()};
+  if (pid == 0) {
+    close(fds[0]);
+    double best{std::numeric_limits<double>::max()};
+    for (std::size_t r = 0; r < n_repeats; ++r) {
+      const auto start = std::chrono::steady_clock::now();
+      f();
+      const auto stop = std::chrono::steady_clock::now();
+      best = std::min(
+          best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    const ssize_t written{write(fds[1], &best, sizeof best)};
+    _exit(written == sizeof best ? 0 : 1);
+  }
+  close(fds[1]);
+  double best{0};
+  if (read(fds[0], &best, sizeof best) != sizeof best) {
+    best = 0;
+  }
+  close(fds[0]);
+  int status;
+  rusage usage;
+  wait4(pid, &status, 0, &usage);
+  return {best, usage.ru_maxrss};
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const char* opt_mb{option(argc, argv, "--mb")};
+  const char* opt_repeats{option(argc, argv, "--repeats")};
+  const std::size_t mb{opt_mb ? std::strtoul(opt_mb, nullptr, 10) : 50};
+  const std::size_t n_repeats{
+      opt_repeats ? std::strtoul(opt_repeats, nullptr, 10) : 3};
+
+  char path[] = "/tmp/bench_json_XXXXXX";
+  const int fd{mkstemp(path)};
+  if (fd < 0) {
+    std::perror("mkstemp");
+    return 1;
+  }
+  close(fd);
+  const std::size_t n_channels{write_calibration(path, mb << 20)};
+  std::printf("%zu MB, %zu channels of 256 pedestals\n", mb, n_channels);
+
+  const std::string last{"ch" + std::to_string(n_channels - 1)};
+  const struct {
+    const char* name;
+    std::function<void()> f;
+  } methods[]{
+      {"baseline", [] {}},
+      {"read_json",
+       [&] {
+         physics::ptree tree;
+         physics::read_json(path, tree);
+         if (tree.get<std::string>("calib." + last + ".gain").empty()) {
+           std::abort();
+         }
+       }},
+      {"configuration",
+       [&] {
+         physics::ptree tree;
+         physics::read_json(path, tree);
+         const auto snapshot = physics::configuration{"calib", tree}.freeze();
+         if (snapshot->get_numbers(last + ".pedestals").size() != 256) {
+           std::abort();
+         }
+       }},
+      {"json_document",
+       [&] {
+         std::ifstream in{path};
+         const physics::json_document doc{in};
+         if (!doc.find("calib." + last + ".gain")) {
+           std::abort();
+         }
+       }},
+      {"json_snapshot", [&] {
+         std::ifstream in{path};
+         const physics::configuration_snapshot snapshot{
+             physics::json_document{in}, "calib"};
+         if (snapshot.get_numbers(last + ".pedestals").size() != 256) {
+           std::abort();
+         }
+       }}};
+  std::printf("%-14s %10s %14s\n", "method", "ms", "peak RSS (MB)");
+  long baseline{0};
+  for (const auto& m : methods) {
+    const auto result = measure(m.f, n_repeats);
+    if (!baseline) {
+      baseline = result.second;
+    }
+    std::printf("%-14s %10.1f %14.1f\n", m.name, result.first,
+                (result.second - baseline) / 1024.);
+  }
+  std::remove(path);
+  return 0;
+}
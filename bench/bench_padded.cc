@@ -0,0 +1,132 @@
+// Layout benchmark for the padded 4-lane vectors in physics/vector/padded.hh.
+//
+// Times mag() and boost() over arrays of vector/lorentzvector (3 and 4
+// packed components) and of padded_vector/padded_lorentzvector (4 lanes, 32
+// byte aligned), both for raw doubles and for quantities. Prints the best
+// time of all repeats per element, and the speedup of the padded layout.
+//
+// usage: bench_padded [--size=N] [--repeats=N]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "physics/unit.hh"
+#include "physics/unit/standard.hh"
+#include "physics/util/aligned.hh"
+#include "physics/vector.hh"
+#include "physics/vector/padded.hh"
+
+namespace su = physics::standard_units;
+
+namespace {
+// prevent the optimizer from discarding a result
+template <class T> inline void do_not_optimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// best time of n_repeats calls in ns
+double best_time(std::size_t n_repeats, const std::function<void()>& f) {
+  double best{std::numeric_limits<double>::max()};
+  f();
+  for (std::size_t r = 0; r < n_repeats; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto stop = std::chrono::steady_clock::now();
+    best = std::min(
+        best, std::chrono::duration<double, std::nano>(stop - start).count());
+  }
+  return best;
+}
+
+// parse --key=value command line options
+const char* option(int argc, char* argv[], const char* key) {
+  const std::size_t len{std::strlen(key)};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], key, len) == 0 && argv[i][len] == '=') {
+      return argv[i] + len + 1;
+    }
+  }
+  return nullptr;
+}
+
+// time mag() and boost() for lorentzvector type LV (and its 3-vector part)
+// and the padded type PLV, print one line per kernel
+template <class LV, class PLV>
+void run(const char* name, std::size_t n, std::size_t n_repeats) {
+  using V = typename LV::vector_type;
+  using PV = physics::padded_vector<typename LV::quantity_type>;
+  using Q = typename LV::quantity_type;
+  std::vector<V> v(n);
+  std::vector<LV> lv(n), lv_out(n);
+  physics::aligned_vector<PV> pv(n);
+  physics::aligned_vector<PLV> plv(n), plv_out(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const double d{static_cast<double>(i % 1013)};
+    v[i] = V{Q{1. + d}, Q{2. - d}, Q{0.5 * d}};
+    lv[i] = LV{Q{5000. + d}, v[i]};
+    pv[i] = v[i];
+    plv[i] = lv[i];
+  }
+  const physics::vector<double> beta{0.3, -0.1, 0.2};
+  const physics::padded_vector<double> padded_beta{beta};
+
+  const double mag_v{best_time(n_repeats, [&] {
+    double sum{0};
+    for (std::size_t i = 0; i < n; ++i) {
+      sum += static_cast<double>(v[i].mag() / Q{1});
+    }
+    do_not_optimize(sum);
+  })};
+  const double mag_pv{best_time(n_repeats, [&] {
+    double sum{0};
+    for (std::size_t i = 0; i < n; ++i) {
+      sum += static_cast<double>(pv[i].mag() / Q{1});
+    }
+    do_not_optimize(sum);
+  })};
+  // (local copies of beta, so that the compiler knows the outputs do not
+  // alias it and can hoist gamma out of the loops)
+  const double boost_lv{best_time(n_repeats, [&] {
+    const auto b = beta;
+    for (std::size_t i = 0; i < n; ++i) {
+      lv_out[i] = lv[i].boost(b);
+    }
+    do_not_optimize(lv_out[n / 2]);
+  })};
+  const double boost_plv{best_time(n_repeats, [&] {
+    const auto b = padded_beta;
+    for (std::size_t i = 0; i < n; ++i) {
+      plv_out[i] = plv[i].boost(b);
+    }
+    do_not_optimize(plv_out[n / 2]);
+  })};
+  std::printf("%-10s %-8s %12.3f %12.3f %8.2f\n", name, "mag", mag_v / n,
+              mag_pv / n, mag_v / mag_pv);
+  std::printf("%-10s %-8s %12.3f %12.3f %8.2f\n", name, "boost", boost_lv / n,
+              boost_plv / n, boost_lv / boost_plv);
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const char* opt_size{option(argc, argv, "--size")};
+  const char* opt_repeats{option(argc, argv, "--repeats")};
+  const std::size_t n{opt_size ? std::strtoul(opt_size, nullptr, 10)
+                               : 1000000};
+  const std::size_t n_repeats{
+      opt_repeats ? std::strtoul(opt_repeats, nullptr, 10) : 10};
+
+  std::printf("%-10s %-8s %12s %12s %8s\n", "type", "kernel", "ns (3-lane)",
+              "ns (padded)", "speedup");
+  run<physics::lorentzvector<double>, physics::padded_lorentzvector<double>>(
+      "double", n, n_repeats);
+  run<physics::lorentzvector<su::energy::MeV>,
+      physics::padded_lorentzvector<su::energy::MeV>>("MeV", n, n_repeats);
+  return 0;
+}
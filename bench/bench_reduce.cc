@@ -0,0 +1,129 @@
+// Scaling benchmark for the parallel reductions in physics/unit/reduce.hh.
+//
+// Every reduction is timed over the same quantity column with a thread_pool
+// of 1, 2, ... N threads (and serially, without a pool). Prints the best time
+// of all repeats, the throughput and the speedup w.r.t. the serial version.
+// rsum and rsum_comp are the reproducible (pairwise and compensated) sums.
+//
+// usage: bench_reduce [--size=N] [--repeats=N] [--threads=N]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "physics/unit.hh"
+#include "physics/unit/array.hh"
+#include "physics/unit/reduce.hh"
+#include "physics/unit/standard.hh"
+#include "physics/util/thread_pool.hh"
+
+namespace su = physics::standard_units;
+
+namespace {
+// prevent the optimizer from discarding a result
+template <class T> inline void do_not_optimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// best time of n_repeats calls in ns
+double best_time(std::size_t n_repeats, const std::function<void()>& f) {
+  double best{std::numeric_limits<double>::max()};
+  f();
+  for (std::size_t r = 0; r < n_repeats; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto stop = std::chrono::steady_clock::now();
+    best = std::min(
+        best, std::chrono::duration<double, std::nano>(stop - start).count());
+  }
+  return best;
+}
+
+// parse --key=value command line options
+const char* option(int argc, char* argv[], const char* key) {
+  const std::size_t len{std::strlen(key)};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], key, len) == 0 && argv[i][len] == '=') {
+      return argv[i] + len + 1;
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const char* opt_size{option(argc, argv, "--size")};
+  const char* opt_repeats{option(argc, argv, "--repeats")};
+  const char* opt_threads{option(argc, argv, "--threads")};
+  const std::size_t n{opt_size ? std::strtoul(opt_size, nullptr, 10)
+                               : 10000000};
+  const std::size_t n_repeats{
+      opt_repeats ? std::strtoul(opt_repeats, nullptr, 10) : 10};
+  const std::size_t max_threads{
+      opt_threads ? std::strtoul(opt_threads, nullptr, 10)
+                  : std::max(1u, std::thread::hardware_concurrency())};
+
+  physics::quantity_array<su::energy::MeV::unit> x(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    x[i] = su::energy::MeV{1. + (i % 1013) * 0.25};
+  }
+
+  using reduction = std::function<void(physics::thread_pool*)>;
+  const std::pair<const char*, reduction> reductions[]{
+      {"sum",
+       [&](physics::thread_pool* p) {
+         do_not_optimize(p ? physics::sum(x, *p) : physics::sum(x));
+       }},
+      {"rsum",
+       [&](physics::thread_pool* p) {
+         do_not_optimize(p ? physics::reproducible_sum(x, *p)
+                           : physics::reproducible_sum(x));
+       }},
+      {"rsum_comp",
+       [&](physics::thread_pool* p) {
+         const auto mode = physics::summation::compensated;
+         do_not_optimize(p ? physics::reproducible_sum(x, *p, mode)
+                           : physics::reproducible_sum(x, mode));
+       }},
+      {"mean",
+       [&](physics::thread_pool* p) {
+         do_not_optimize(p ? physics::mean(x, *p) : physics::mean(x));
+       }},
+      {"variance",
+       [&](physics::thread_pool* p) {
+         do_not_optimize(p ? physics::variance(x, *p)
+                           : physics::variance(x));
+       }},
+      {"minmax", [&](physics::thread_pool* p) {
+         do_not_optimize(p ? physics::minmax(x, *p) : physics::minmax(x));
+       }}};
+
+  // 1, 2, 4, ... max_threads
+  std::vector<std::size_t> thread_counts;
+  for (std::size_t t = 1; t < max_threads; t *= 2) {
+    thread_counts.push_back(t);
+  }
+  thread_counts.push_back(max_threads);
+
+  std::printf("%-10s %8s %12s %12s %8s\n", "reduction", "threads", "ms",
+              "Melem/s", "speedup");
+  for (const auto& r : reductions) {
+    const double serial{best_time(n_repeats, [&] { r.second(nullptr); })};
+    std::printf("%-10s %8s %12.3f %12.1f %8.2f\n", r.first, "serial",
+                serial * 1e-6, n * 1e3 / serial, 1.);
+    for (const std::size_t t : thread_counts) {
+      physics::thread_pool pool{t};
+      const double ns{best_time(n_repeats, [&] { r.second(&pool); })};
+      std::printf("%-10s %8zu %12.3f %12.1f %8.2f\n", r.first, t, ns * 1e-6,
+                  n * 1e3 / ns, serial / ns);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,297 @@
+// Zero-overhead benchmark suite: the same kernels written with raw doubles and
+// with physics::quantity, physics::vector and physics::lorentzvector.
+//
+// For every kernel, both versions are run alternately over the same data, and
+// the best time of all repeats is kept. The results are written as JSON (ns/op
+// and throughput for both versions, and the relative overhead of the quantity
+// version). The program fails if any quantity kernel is more than
+// --tolerance percent slower than its raw double counterpart.
+//
+// usage: bench_zero_overhead [--size=N] [--repeats=N] [--tolerance=PERCENT]
+//                            [--json=FILE]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "physics/unit.hh"
+#include "physics/unit/standard.hh"
+#include "physics/vector.hh"
+
+namespace su = physics::standard_units;
+
+// =============================================================================
+// benchmark utilities
+// =============================================================================
+namespace {
+// prevent the optimizer from discarding a result
+template <class T> inline void do_not_optimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct result {
+  std::string name;
+  double ns_double;
+  double ns_quantity;
+  double overhead() const { return ns_quantity / ns_double - 1.; }
+};
+
+// time n_repeats calls of both versions (alternating, to share any frequency
+// or cache effects), keep the best time in ns per element
+result run(const std::string& name, std::size_t n, std::size_t n_repeats,
+           const std::function<void()>& f_double,
+           const std::function<void()>& f_quantity) {
+  double best_double{std::numeric_limits<double>::max()};
+  double best_quantity{std::numeric_limits<double>::max()};
+  auto time = [](const std::function<void()>& f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+  };
+  // warm-up
+  f_double();
+  f_quantity();
+  for (std::size_t r = 0; r < n_repeats; ++r) {
+    best_double = std::min(best_double, time(f_double));
+    best_quantity = std::min(best_quantity, time(f_quantity));
+  }
+  return {name, best_double / n, best_quantity / n};
+}
+
+void write_json(std::FILE* out, const std::vector<result>& results,
+                std::size_t n, std::size_t n_repeats, double tolerance) {
+  std::fprintf(out, "{\n  \"size\": %zu,\n  \"repeats\": %zu,\n", n,
+               n_repeats);
+  std::fprintf(out, "  \"tolerance_percent\": %g,\n  \"kernels\": [\n",
+               tolerance);
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto& r = results[i];
+    std::fprintf(out,
+                 "    {\"name\": \"%s\", "
+                 "\"double\": {\"ns_per_op\": %.4f, \"mops_per_s\": %.2f}, "
+                 "\"quantity\": {\"ns_per_op\": %.4f, \"mops_per_s\": %.2f}, "
+                 "\"overhead_percent\": %.2f, \"pass\": %s}%s\n",
+                 r.name.c_str(), r.ns_double, 1e3 / r.ns_double,
+                 r.ns_quantity, 1e3 / r.ns_quantity, 100. * r.overhead(),
+                 (100. * r.overhead() <= tolerance) ? "true" : "false",
+                 (i + 1 < results.size()) ? "," : "");
+  }
+  std::fprintf(out, "  ]\n}\n");
+}
+
+// parse --key=value command line options
+const char* option(int argc, char* argv[], const char* key) {
+  const std::size_t len{std::strlen(key)};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], key, len) == 0 && argv[i][len] == '=') {
+      return argv[i] + len + 1;
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+// =============================================================================
+// kernels
+// =============================================================================
+namespace {
+struct double3 {
+  double x, y, z;
+};
+struct double4 {
+  double t, x, y, z;
+};
+using momentum = su::energy::MeV;
+using momentum_vector = physics::vector<momentum>;
+using momentum_lorentzvector = physics::lorentzvector<momentum>;
+using beta_vector = physics::vector<double>;
+
+// 1. dot products
+double dot_double(const std::vector<double3>& a, const std::vector<double3>& b) {
+  double sum{0};
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    sum += a[i].x * b[i].x + a[i].y * b[i].y + a[i].z * b[i].z;
+  }
+  return sum;
+}
+auto dot_quantity(const std::vector<momentum_vector>& a,
+                  const std::vector<momentum_vector>& b) {
+  decltype(a[0] * b[0]) sum{0};
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+// 2. magnitudes
+void mag_double(const std::vector<double3>& a, std::vector<double>& out) {
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    out[i] = std::sqrt(a[i].x * a[i].x + a[i].y * a[i].y + a[i].z * a[i].z);
+  }
+}
+void mag_quantity(const std::vector<momentum_vector>& a,
+                  std::vector<momentum>& out) {
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    out[i] = a[i].mag();
+  }
+}
+
+// 3. Lorentz boosts (same arithmetic as lorentzvector::boost())
+void boost_double(const std::vector<double4>& a, const double3& beta,
+                  std::vector<double4>& out) {
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    const double b2{beta.x * beta.x + beta.y * beta.y + beta.z * beta.z};
+    const double gamma{1. / std::sqrt(1. - b2)};
+    const double bp{a[i].x * beta.x + a[i].y * beta.y + a[i].z * beta.z};
+    const double f{(gamma - 1) / b2 * bp - gamma * a[i].t};
+    out[i] = {gamma * (a[i].t - bp), a[i].x + beta.x * f, a[i].y + beta.y * f,
+              a[i].z + beta.z * f};
+  }
+}
+void boost_quantity(const std::vector<momentum_lorentzvector>& a,
+                    const beta_vector& beta,
+                    std::vector<momentum_lorentzvector>& out) {
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    out[i] = a[i].boost(beta);
+  }
+}
+
+// 4. conversions between prefixed units
+void convert_double(const std::vector<double>& cm, std::vector<double>& um) {
+  for (std::size_t i = 0; i < cm.size(); ++i) {
+    um[i] = cm[i] * 1e4;
+  }
+}
+void convert_quantity(const std::vector<su::distance::cm>& cm,
+                      std::vector<su::distance::um>& um) {
+  for (std::size_t i = 0; i < cm.size(); ++i) {
+    um[i] = cm[i];
+  }
+}
+
+// 5. dimensionless arithmetic with the implicit conversion to double
+double dimensionless_double(const std::vector<double>& mm,
+                            const std::vector<double>& cm) {
+  double sum{0};
+  for (std::size_t i = 0; i < mm.size(); ++i) {
+    const double r{mm[i] / cm[i] * 0.1};
+    sum += r * r + 1.;
+  }
+  return sum;
+}
+double dimensionless_quantity(const std::vector<su::distance::mm>& mm,
+                              const std::vector<su::distance::cm>& cm) {
+  double sum{0};
+  for (std::size_t i = 0; i < mm.size(); ++i) {
+    const double r = mm[i] / cm[i];
+    sum += r * r + 1.;
+  }
+  return sum;
+}
+} // namespace
+
+// =============================================================================
+// main
+// =============================================================================
+int main(int argc, char* argv[]) {
+  const char* opt_size{option(argc, argv, "--size")};
+  const char* opt_repeats{option(argc, argv, "--repeats")};
+  const char* opt_tolerance{option(argc, argv, "--tolerance")};
+  const char* opt_json{option(argc, argv, "--json")};
+  const std::size_t n{opt_size ? std::strtoul(opt_size, nullptr, 10) : 4096};
+  const std::size_t n_repeats{
+      opt_repeats ? std::strtoul(opt_repeats, nullptr, 10) : 200};
+  const double tolerance{opt_tolerance ? std::strtod(opt_tolerance, nullptr)
+                                       : 10.};
+
+  // input data, identical for both versions
+  std::vector<double3> a3(n), b3(n);
+  std::vector<double4> a4(n), out4(n);
+  std::vector<double> d1(n), d2(n), dout(n);
+  std::vector<momentum_vector> qa3(n), qb3(n);
+  std::vector<momentum_lorentzvector> qa4(n), qout4(n);
+  std::vector<momentum> qout(n);
+  std::vector<su::distance::cm> qcm(n);
+  std::vector<su::distance::mm> qmm(n);
+  std::vector<su::distance::um> qum(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const double x{1. + (i % 17)}, y{2. - (i % 5)}, z{0.5 * (i % 11)};
+    a3[i] = {x, y, z};
+    b3[i] = {z, x, y};
+    a4[i] = {100. + x, x, y, z};
+    d1[i] = x;
+    d2[i] = 1. + z;
+    qa3[i] = {momentum{x}, momentum{y}, momentum{z}};
+    qb3[i] = {momentum{z}, momentum{x}, momentum{y}};
+    qa4[i] = {momentum{100. + x}, {momentum{x}, momentum{y}, momentum{z}}};
+    qmm[i] = su::distance::mm{x};
+    qcm[i] = su::distance::cm{1. + z};
+  }
+  const double3 beta{0.1, -0.2, 0.3};
+  const beta_vector qbeta{0.1, -0.2, 0.3};
+
+  std::vector<result> results;
+  results.push_back(run("dot", n, n_repeats,
+                        [&] { do_not_optimize(dot_double(a3, b3)); },
+                        [&] { do_not_optimize(dot_quantity(qa3, qb3)); }));
+  results.push_back(run("mag", n, n_repeats,
+                        [&] {
+                          mag_double(a3, dout);
+                          do_not_optimize(dout.data());
+                        },
+                        [&] {
+                          mag_quantity(qa3, qout);
+                          do_not_optimize(qout.data());
+                        }));
+  results.push_back(run("boost", n, n_repeats,
+                        [&] {
+                          boost_double(a4, beta, out4);
+                          do_not_optimize(out4.data());
+                        },
+                        [&] {
+                          boost_quantity(qa4, qbeta, qout4);
+                          do_not_optimize(qout4.data());
+                        }));
+  results.push_back(run("convert", n, n_repeats,
+                        [&] {
+                          convert_double(d2, dout);
+                          do_not_optimize(dout.data());
+                        },
+                        [&] {
+                          convert_quantity(qcm, qum);
+                          do_not_optimize(qum.data());
+                        }));
+  results.push_back(
+      run("dimensionless", n, n_repeats,
+          [&] { do_not_optimize(dimensionless_double(d1, d2)); },
+          [&] { do_not_optimize(dimensionless_quantity(qmm, qcm)); }));
+
+  // output
+  std::FILE* out{opt_json ? std::fopen(opt_json, "w") : stdout};
+  if (!out) {
+    std::fprintf(stderr, "Cannot open %s for writing\n", opt_json);
+    return 2;
+  }
+  write_json(out, results, n, n_repeats, tolerance);
+  if (out != stdout) {
+    std::fclose(out);
+  }
+  bool pass{true};
+  for (const auto& r : results) {
+    const bool ok{100. * r.overhead() <= tolerance};
+    std::fprintf(stderr, "%-14s double %8.3f ns/op  quantity %8.3f ns/op  "
+                         "%+7.2f%%  %s\n",
+                 r.name.c_str(), r.ns_double, r.ns_quantity,
+                 100. * r.overhead(), ok ? "ok" : "FAILED");
+    pass &= ok;
+  }
+  return pass ? 0 : 1;
+}
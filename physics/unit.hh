@@ -1,8 +1,10 @@
 #ifndef PHYSICS_UNIT_LOADED
 #define PHYSICS_UNIT_LOADED
 
-#include <ratio>
 #include <cmath>
+#include <cstdint>
+#include <ratio>
+#include <type_traits>
 
 #include <physics/unit/detail.hh>
 #include <physics/unit/type_traits.hh>
@@ -104,7 +106,7 @@ template <class Unit> using unit_sqrt = unit_pow<Unit, std::ratio<1, 2>>;
 template <class Unit> using unit_cbrt = unit_pow<Unit, std::ratio<1, 3>>;
 
 // =============================================================================
-// quantity<Unit>: a physics quantity
+// quantity<Unit, Rep>: a physics quantity
 // 
 // Notes: 
 //  * In the member functions below I typically capture quantity by value,
@@ -118,68 +120,155 @@ template <class Unit> using unit_cbrt = unit_pow<Unit, std::ratio<1, 3>>;
 //    This is done to avoid loss of precision when taking roots of a
 //    rational number. This does not apply for the unit::pow_10 and unit::pow_pi
 //    values.
+//  * The numerical value is stored as a Rep (double by default). Arithmetic
+//    between quantities (or scalars) with a different Rep yields a quantity
+//    with the std::common_type of both (e.g. float and double -> double),
+//    similar to std::chrono::duration. Conversion to a different Rep on the
+//    other hand is never implicit, use the explicit constructor (or
+//    quantity_cast<>()) instead.
+//  * Powers and roots of integer quantities are evaluated (and returned) as
+//    double.
+//  * Unit conversion of integer quantities is only implicit when the rescale
+//    factor is an integer (e.g. us to ns), otherwise the value would be
+//    truncated and the conversion has to be explicit. Integer quantities in
+//    different units are compared in the unit that converts exactly, and can
+//    not be compared if neither does.
 //
 // =============================================================================
-template <class Unit> class quantity : public comparison_mixin<quantity<Unit>> {
+template <class Unit, class Rep>
+class quantity : public comparison_mixin<quantity<Unit, Rep>> {
 public:
   using unit = Unit;
+  using rep = Rep;
   static_assert(unit_impl::is_unit<Unit>::value,
                 "Unit must be a valid physics::unit<>.");
+  static_assert(std::is_arithmetic<Rep>::value,
+                "Rep must be an arithmetic type.");
 
   // constructors
   //
   // 1. default constructor
-  constexpr quantity() : value_{0.} {}
-  // 2. from double (explicit!)
-  constexpr explicit quantity(double v) : value_{v} {}
-  // 3. from other compatible quantity
-  template <class Pow10, class PowPi, class Factor>
+  constexpr quantity() : value_{0} {}
+  // 2. from a raw value (explicit!)
+  constexpr explicit quantity(Rep v) : value_{v} {}
+  // 3. from other compatible quantity (explicit for integer Reps when the
+  //    rescale factor is not an integer, as the value is truncated)
+  template <class Pow10, class PowPi, class Factor,
+            typename std::enable_if<
+                unit_impl::is_implicit_rescale<
+                    Rep, unit,
+                    physics::unit<typename unit::system,
+                                  typename unit::dimensions, Pow10, PowPi,
+                                  Factor>>::value,
+                int>::type = 0>
   constexpr quantity(
       quantity<physics::unit<typename unit::system, typename unit::dimensions,
-                             Pow10, PowPi, Factor>> rhs)
+                             Pow10, PowPi, Factor>,
+               Rep> rhs)
+      : value_{unit_impl::rescale_value<unit, typename decltype(rhs)::unit>(
+            rhs.raw_value())} {}
+  template <class Pow10, class PowPi, class Factor,
+            typename std::enable_if<
+                !unit_impl::is_implicit_rescale<
+                    Rep, unit,
+                    physics::unit<typename unit::system,
+                                  typename unit::dimensions, Pow10, PowPi,
+                                  Factor>>::value,
+                int>::type = 0>
+  constexpr explicit quantity(
+      quantity<physics::unit<typename unit::system, typename unit::dimensions,
+                             Pow10, PowPi, Factor>,
+               Rep> rhs)
       : value_{unit_impl::rescale_value<unit, typename decltype(rhs)::unit>(
             rhs.raw_value())} {}
+  // 4. from a compatible quantity with a different Rep (explicit!)
+  template <class Pow10, class PowPi, class Factor, class Rep2,
+            class = typename std::enable_if<
+                !std::is_same<Rep, Rep2>::value>::type>
+  constexpr explicit quantity(
+      quantity<physics::unit<typename unit::system, typename unit::dimensions,
+                             Pow10, PowPi, Factor>,
+               Rep2> rhs)
+      : value_{static_cast<Rep>(
+            unit_impl::rescale_value<unit, typename decltype(rhs)::unit>(
+                static_cast<unit_impl::common_rep<Rep, Rep2>>(
+                    rhs.raw_value())))} {}
 
-  // assignment
-  quantity& operator=(quantity rhs) {
-    value_ = rhs.value_;
-    return *this;
-  }
+  // assignment (defaulted, keeping quantity trivially copyable so that
+  // containers of quantities can be copied as raw memory)
+  quantity& operator=(const quantity& rhs) = default;
 
   // extract the numerical value of a quantity
-  constexpr double value() const { return value_; }
+  constexpr Rep value() const { return value_; }
   // raw_value() returns the value_ property for all quantities, while the
   // behavior of value() differes for dimensionless quantities. (See the
   // dimensionless quantity specialization below for more info.)
-  constexpr double raw_value() const { return value_; }
+  constexpr Rep raw_value() const { return value_; }
 
   // extract the numeric value of the quantity in another unit (or quantity with
   // compatible unit)
-  template <class UnitOrQuantity> constexpr double value() const {
+  template <class UnitOrQuantity> constexpr Rep value() const {
     using other_unit = typename std::conditional<
         physics::unit_impl::is_quantity<UnitOrQuantity>::value,
         typename UnitOrQuantity::unit, UnitOrQuantity>::type;
     static_assert(unit_impl::are_compatible<unit, other_unit>::value,
                   "Attempting to convert quantity to incompatible unit");
-    return quantity<other_unit>{*this}.value();
+    return quantity<other_unit, Rep>{*this}.value();
   }
 
   // multiply and divide quantities
   // using raw_value to obtain the values of the second term to correctly handle
   // dimensionless quantities
-  template <class Unit2> constexpr auto operator*(quantity<Unit2> q) const {
-    return quantity<unit_multiply<unit, Unit2>>{value_ * q.raw_value()};
+  template <class Unit2, class Rep2>
+  constexpr auto operator*(quantity<Unit2, Rep2> q) const {
+    using R = unit_impl::common_rep<Rep, Rep2>;
+    return quantity<unit_multiply<unit, Unit2>, R>{
+        static_cast<R>(value_ * q.raw_value())};
+  }
+  template <class Unit2, class Rep2>
+  constexpr auto operator/(quantity<Unit2, Rep2> q) const {
+    using R = unit_impl::common_rep<Rep, Rep2>;
+    return quantity<unit_divide<unit, Unit2>, R>{
+        static_cast<R>(value_ / q.raw_value())};
   }
-  template <class Unit2> constexpr auto operator/(quantity<Unit2> q) const {
-    return quantity<unit_divide<unit, Unit2>>{value_ / q.raw_value()};
+  template <class T, class = typename std::enable_if<
+                         std::is_arithmetic<T>::value>::type>
+  constexpr auto operator*(T d) const {
+    using R = unit_impl::common_rep<Rep, T>;
+    return quantity<unit, R>{static_cast<R>(value_ * d)};
+  }
+  template <class T, class = typename std::enable_if<
+                         std::is_arithmetic<T>::value>::type>
+  constexpr auto operator/(T d) const {
+    using R = unit_impl::common_rep<Rep, T>;
+    return quantity<unit, R>{static_cast<R>(value_ / d)};
   }
-  constexpr auto operator*(double d) const { return quantity{value_ * d}; }
-  constexpr auto operator/(double d) const { return quantity{value_ / d}; }
   // add and subtract quantities
-  constexpr auto operator+(quantity q) const { return quantity{value_ + q.value_}; }
-  constexpr auto operator-(quantity q) const { return quantity{value_ - q.value_}; }
+  constexpr auto operator+(quantity q) const {
+    return quantity{static_cast<Rep>(value_ + q.value_)};
+  }
+  constexpr auto operator-(quantity q) const {
+    return quantity{static_cast<Rep>(value_ - q.value_)};
+  }
+  // mixed Rep: the result is in the LHS unit, with the common Rep
+  template <class Unit2, class Rep2,
+            class = typename std::enable_if<
+                !std::is_same<Rep, Rep2>::value>::type>
+  constexpr auto operator+(quantity<Unit2, Rep2> q) const {
+    using R = unit_impl::common_rep<Rep, Rep2>;
+    return quantity<unit, R>{*this} + quantity<unit, R>{q};
+  }
+  template <class Unit2, class Rep2,
+            class = typename std::enable_if<
+                !std::is_same<Rep, Rep2>::value>::type>
+  constexpr auto operator-(quantity<Unit2, Rep2> q) const {
+    using R = unit_impl::common_rep<Rep, Rep2>;
+    return quantity<unit, R>{*this} - quantity<unit, R>{q};
+  }
   // unary minus sign
-  constexpr auto operator-() const { return quantity{-value_}; }
+  constexpr auto operator-() const {
+    return quantity{static_cast<Rep>(-value_)};
+  }
 
   // power and sqrt/cbrt
   // the scaling factor is automatically applied to avoid losing precision
@@ -188,8 +277,10 @@ public:
     using unit_scaled =
         physics::unit<typename unit::system, typename unit::dimensions,
                       typename unit::pow_10, typename unit::pow_pi>;
-    return quantity<unit_pow<unit_scaled, Ratio>>{
-        physics::pow<Ratio>(value_ * unit::factor::num / unit::factor::den)};
+    using R = unit_impl::floating_rep<Rep>;
+    return quantity<unit_pow<unit_scaled, Ratio>, R>{static_cast<R>(
+        physics::pow<Ratio>(static_cast<R>(value_) * unit::factor::num /
+                            unit::factor::den))};
   }
   template <std::intmax_t N, std::intmax_t D = 1> constexpr auto pow() const {
     return pow<std::ratio<N, D>>();
@@ -219,84 +310,202 @@ public:
   // !=, >, => and <= are defined through comparison_mixin inheritance
   constexpr bool operator==(quantity q) const { return value_ == q.value_; }
   constexpr bool operator<(quantity q) const { return value_ < q.value_; }
+  // integer quantities with a unit that only converts exactly the other way
+  // are compared in the unit of the RHS (e.g. us and ns in ns). Integer
+  // quantities where neither conversion is exact can not be compared.
+  using comparison_mixin<quantity>::operator!=;
+  using comparison_mixin<quantity>::operator<=;
+  using comparison_mixin<quantity>::operator>;
+  using comparison_mixin<quantity>::operator>=;
+  template <class Unit2, class = typename std::enable_if<
+                             unit_impl::is_rhs_comparison<Rep, Unit, Unit2>::
+                                 value>::type>
+  constexpr bool operator==(quantity<Unit2, Rep> q) const {
+    return quantity<Unit2, Rep>{*this} == q;
+  }
+  template <class Unit2, class = typename std::enable_if<
+                             unit_impl::is_rhs_comparison<Rep, Unit, Unit2>::
+                                 value>::type>
+  constexpr bool operator!=(quantity<Unit2, Rep> q) const {
+    return quantity<Unit2, Rep>{*this} != q;
+  }
+  template <class Unit2, class = typename std::enable_if<
+                             unit_impl::is_rhs_comparison<Rep, Unit, Unit2>::
+                                 value>::type>
+  constexpr bool operator<(quantity<Unit2, Rep> q) const {
+    return quantity<Unit2, Rep>{*this} < q;
+  }
+  template <class Unit2, class = typename std::enable_if<
+                             unit_impl::is_rhs_comparison<Rep, Unit, Unit2>::
+                                 value>::type>
+  constexpr bool operator<=(quantity<Unit2, Rep> q) const {
+    return quantity<Unit2, Rep>{*this} <= q;
+  }
+  template <class Unit2, class = typename std::enable_if<
+                             unit_impl::is_rhs_comparison<Rep, Unit, Unit2>::
+                                 value>::type>
+  constexpr bool operator>(quantity<Unit2, Rep> q) const {
+    return quantity<Unit2, Rep>{*this} > q;
+  }
+  template <class Unit2, class = typename std::enable_if<
+                             unit_impl::is_rhs_comparison<Rep, Unit, Unit2>::
+                                 value>::type>
+  constexpr bool operator>=(quantity<Unit2, Rep> q) const {
+    return quantity<Unit2, Rep>{*this} >= q;
+  }
 
 private:
-  double value_;
+  Rep value_;
 }; // quantity<>
 
 // =============================================================================
 // quantity specialization: dimensionless case 
-//  * behaves as if it is a raw double
-//  * implicit cast to double
+//  * behaves as if it is a raw double (or Rep)
+//  * implicit cast to Rep
 // =============================================================================
-template <class System, class Pow10, class PowPi, class Factor>
+template <class System, class Pow10, class PowPi, class Factor, class Rep>
 class quantity<
-    unit<System, typename System::dimensionless, Pow10, PowPi, Factor>>
+    unit<System, typename System::dimensionless, Pow10, PowPi, Factor>, Rep>
     : public comparison_mixin<quantity<
-          unit<System, typename System::dimensionless, Pow10, PowPi, Factor>>> {
+          unit<System, typename System::dimensionless, Pow10, PowPi, Factor>,
+          Rep>> {
 public:
   using unit = physics::unit<System, typename System::dimensionless, Pow10,
                              PowPi, Factor>;
+  using rep = Rep;
+  static_assert(std::is_arithmetic<Rep>::value,
+                "Rep must be an arithmetic type.");
 
   // constructors
   //
-  // 1. from double (explicit!)
-  constexpr explicit quantity(double v) : value_{v} {}
-  // 2. from other compatible quantity (optimized)
-  template <class U2Pow10, class U2PowPi, class U2Factor>
+  // 1. default constructor
+  constexpr quantity() : value_{0} {}
+  // 2. from a raw value (explicit!)
+  constexpr explicit quantity(Rep v) : value_{v} {}
+  // 3. from other compatible quantity (optimized, explicit for integer Reps
+  //    when the rescale factor is not an integer)
+  template <class U2Pow10, class U2PowPi, class U2Factor,
+            typename std::enable_if<
+                unit_impl::is_implicit_rescale<
+                    Rep, unit,
+                    physics::unit<typename unit::system,
+                                  typename unit::dimensions, U2Pow10, U2PowPi,
+                                  U2Factor>>::value,
+                int>::type = 0>
   constexpr quantity(
       quantity<physics::unit<typename unit::system, typename unit::dimensions,
-                             U2Pow10, U2PowPi, U2Factor>> rhs)
+                             U2Pow10, U2PowPi, U2Factor>,
+               Rep> rhs)
+      : value_{unit_impl::rescale_value<unit, typename decltype(rhs)::unit>(
+            rhs.raw_value())} {}
+  template <class U2Pow10, class U2PowPi, class U2Factor,
+            typename std::enable_if<
+                !unit_impl::is_implicit_rescale<
+                    Rep, unit,
+                    physics::unit<typename unit::system,
+                                  typename unit::dimensions, U2Pow10, U2PowPi,
+                                  U2Factor>>::value,
+                int>::type = 0>
+  constexpr explicit quantity(
+      quantity<physics::unit<typename unit::system, typename unit::dimensions,
+                             U2Pow10, U2PowPi, U2Factor>,
+               Rep> rhs)
       : value_{unit_impl::rescale_value<unit, typename decltype(rhs)::unit>(
             rhs.raw_value())} {}
+  // 4. from a compatible quantity with a different Rep (explicit!)
+  template <class U2Pow10, class U2PowPi, class U2Factor, class Rep2,
+            class = typename std::enable_if<
+                !std::is_same<Rep, Rep2>::value>::type>
+  constexpr explicit quantity(
+      quantity<physics::unit<typename unit::system, typename unit::dimensions,
+                             U2Pow10, U2PowPi, U2Factor>,
+               Rep2> rhs)
+      : value_{static_cast<Rep>(
+            unit_impl::rescale_value<unit, typename decltype(rhs)::unit>(
+                static_cast<unit_impl::common_rep<Rep, Rep2>>(
+                    rhs.raw_value())))} {}
 
-  // assignment
-  quantity& operator=(quantity rhs) {
-    value_ = rhs.value_;
-    return *this;
-  }
-  // (implicit) conversion to double
-  constexpr operator double() const { return value(); }
+  // assignment (defaulted, keeping quantity trivially copyable so that
+  // containers of quantities can be copied as raw memory)
+  quantity& operator=(const quantity& rhs) = default;
+  // (implicit) conversion to Rep
+  constexpr operator Rep() const { return value(); }
 
   // extract the numerical value, automatically performing the necessary
   // rescaling steps in order to emulate the behavior of a raw double
-  constexpr double value() const {
+  constexpr Rep value() const {
     return quantity<
-               physics::unit<typename unit::system, typename unit::dimensions>>{
-        *this}.raw_value();
+               physics::unit<typename unit::system, typename unit::dimensions>,
+               Rep>{*this}.raw_value();
   }
   // return the raw internal value, proportional to value() through Pow10, PowPi
   // and Factor
-  constexpr double raw_value() const { return value_; }
+  constexpr Rep raw_value() const { return value_; }
 
   // multiply and divide
-  template <class Unit2>
-  constexpr auto operator*(quantity<Unit2> q) const {
-    return quantity<unit_multiply<unit, Unit2>>{value_ * q.raw_value()};
+  template <class Unit2, class Rep2>
+  constexpr auto operator*(quantity<Unit2, Rep2> q) const {
+    using R = unit_impl::common_rep<Rep, Rep2>;
+    return quantity<unit_multiply<unit, Unit2>, R>{
+        static_cast<R>(value_ * q.raw_value())};
+  }
+  template <class Unit2, class Rep2>
+  constexpr auto operator/(quantity<Unit2, Rep2> q) const {
+    using R = unit_impl::common_rep<Rep, Rep2>;
+    return quantity<unit_divide<unit, Unit2>, R>{
+        static_cast<R>(value_ / q.raw_value())};
+  }
+  template <class T, class = typename std::enable_if<
+                         std::is_arithmetic<T>::value>::type>
+  constexpr auto operator*(T d) const {
+    using R = unit_impl::common_rep<Rep, T>;
+    return quantity<unit, R>{static_cast<R>(value_ * d)};
   }
-  template <class Unit2>
-  constexpr auto operator/(quantity<Unit2> q) const {
-    return quantity<unit_divide<unit, Unit2>>{value_ / q.raw_value()};
+  template <class T, class = typename std::enable_if<
+                         std::is_arithmetic<T>::value>::type>
+  constexpr auto operator/(T d) const {
+    using R = unit_impl::common_rep<Rep, T>;
+    return quantity<unit, R>{static_cast<R>(value_ / d)};
   }
-  constexpr auto operator*(double d) const { return quantity{value_ * d}; }
-  constexpr auto operator/(double d) const { return quantity{value_ / d}; }
   // add and subtract from quantity and raw double
-  constexpr auto operator+(double d) const {
-    return quantity{
+  template <class T, class = typename std::enable_if<
+                         std::is_arithmetic<T>::value>::type>
+  constexpr auto operator+(T d) const {
+    using R = unit_impl::common_rep<Rep, T>;
+    return quantity<unit, R>{static_cast<R>(
         raw_value() +
         unit_impl::rescale_value<
             unit, physics::unit<typename unit::system,
-                                typename unit::system::dimensionless>>(d)};
+                                typename unit::system::dimensionless>>(
+            static_cast<R>(d)))};
   }
-  constexpr auto operator-(double d) const {
-    return quantity{
+  template <class T, class = typename std::enable_if<
+                         std::is_arithmetic<T>::value>::type>
+  constexpr auto operator-(T d) const {
+    using R = unit_impl::common_rep<Rep, T>;
+    return quantity<unit, R>{static_cast<R>(
         raw_value() -
         unit_impl::rescale_value<
             unit, physics::unit<typename unit::system,
-                                typename unit::system::dimensionless>>(d)};
+                                typename unit::system::dimensionless>>(
+            static_cast<R>(d)))};
+  }
+  template <class Unit2, class Rep2,
+            class = typename std::enable_if<
+                unit_impl::is_dimensionless<Unit2>::value>::type>
+  constexpr auto operator+(quantity<Unit2, Rep2> q) const {
+    return *this + q.value();
+  }
+  template <class Unit2, class Rep2,
+            class = typename std::enable_if<
+                unit_impl::is_dimensionless<Unit2>::value>::type>
+  constexpr auto operator-(quantity<Unit2, Rep2> q) const {
+    return *this - q.value();
   }
   // unary minus sign
-  constexpr auto operator-() const { return quantity{-value_}; }
+  constexpr auto operator-() const {
+    return quantity{static_cast<Rep>(-value_)};
+  }
   
   // power and sqrt/cbrt
   // the scaling factor is automatically applied to avoid losing precision
@@ -305,8 +514,10 @@ public:
     using unit_scaled =
         physics::unit<typename unit::system, typename unit::dimensions,
                       typename unit::pow_10, typename unit::pow_pi>;
-    return quantity<unit_pow<unit_scaled, Ratio>>{
-        physics::pow<Ratio>(value_ * unit::factor::num / unit::factor::den)};
+    using R = unit_impl::floating_rep<Rep>;
+    return quantity<unit_pow<unit_scaled, Ratio>, R>{static_cast<R>(
+        physics::pow<Ratio>(static_cast<R>(value_) * unit::factor::num /
+                            unit::factor::den))};
   }
   template <std::intmax_t N, std::intmax_t D = 1> constexpr auto pow() const {
     return pow<std::ratio<N, D>>();
@@ -324,11 +535,11 @@ public:
     return *this;
   }
   quantity& operator+=(double d) {
-    value_ = (*this + d).value_;
+    value_ = static_cast<Rep>((*this + d).raw_value());
     return *this;
   }
   quantity& operator-=(double d) {
-    value_ = (*this - d).value_;
+    value_ = static_cast<Rep>((*this - d).raw_value());
     return *this;
   }
   // compare quantityes; !=, >, => and <= are defined through the
@@ -337,30 +548,67 @@ public:
   constexpr bool operator<(double d) const { return value() < d; }
 
 private:
-  double value_;
+  Rep value_;
 };
 
+// explicit conversion to a quantity with a different Rep and/or compatible
+// unit, e.g. quantity_cast<quantity<Unit, float>>(q)
+template <class ToQuantity, class Unit, class Rep>
+constexpr ToQuantity quantity_cast(quantity<Unit, Rep> q) {
+  static_assert(unit_impl::is_quantity<ToQuantity>::value,
+                "ToQuantity must be a physics::quantity<>.");
+  return ToQuantity{q};
+}
+
+// =============================================================================
+// fixed_quantity<Quantity, Lsb, Int>: fixed-point version of Quantity
+//
+// Stores an integer count (Int, std::int32_t by default) of Lsb x the unit of
+// Quantity, where Lsb is a std::ratio. E.g. for TDC counts of 25/1024 ns:
+//    using tdc_time =
+//        fixed_quantity<standard_units::time::ns, std::ratio<25, 1024>>;
+//
+// Notes:
+//  * The LSB is folded into the unit Factor, so the (explicit) conversion to
+//    a floating point quantity, e.g. time::ns{tdc}, is a single multiplication
+//    with a compile-time constant.
+//  * Addition, subtraction and comparison of fixed quantities with the same
+//    unit stay in the integer domain.
+//  * Conversion from a floating point quantity truncates towards zero, like a
+//    static_cast. Conversion to another fixed quantity is implicit when the
+//    LSB ratio is an integer, and explicit (truncating) otherwise.
+// =============================================================================
+template <class Quantity, class Lsb, class Int = std::int32_t>
+using fixed_quantity = quantity<
+    unit<typename Quantity::unit::system, typename Quantity::unit::dimensions,
+         typename Quantity::unit::pow_10, typename Quantity::unit::pow_pi,
+         std::ratio_multiply<typename Quantity::unit::factor, Lsb>>,
+    typename std::enable_if<std::is_integral<Int>::value, Int>::type>;
+
 // powers, sqrt and fabs for quantities
-  template <std::intmax_t N, std::intmax_t D, class Unit>
-  constexpr auto pow(quantity<Unit> q) {
+  template <std::intmax_t N, std::intmax_t D, class Unit, class Rep>
+  constexpr auto pow(quantity<Unit, Rep> q) {
     return q.template pow<N, D>();
   }
-  template <std::intmax_t N, class Unit>
-  constexpr auto pow(quantity<Unit> q) {
+  template <std::intmax_t N, class Unit, class Rep>
+  constexpr auto pow(quantity<Unit, Rep> q) {
     return q.template pow<N>();
   }
-  template <class Ratio, class Unit>
-  constexpr auto pow(quantity<Unit> q) {
+  template <class Ratio, class Unit, class Rep>
+  constexpr auto pow(quantity<Unit, Rep> q) {
     return q.template pow<Ratio>();
   }
 
-  template <class Unit> constexpr auto sqrt(quantity<Unit> q) {
+  template <class Unit, class Rep> constexpr auto sqrt(quantity<Unit, Rep> q) {
     return q.sqrt();
   }
-  template <class Unit> constexpr auto cbrt(quantity<Unit> q) {
+  template <class Unit, class Rep> constexpr auto cbrt(quantity<Unit, Rep> q) {
     return q.cbrt();
   }
-  template <class Unit> constexpr auto fabs(quantity<Unit> q) { return abs(q); }
+  template <class Unit, class Rep>
+  constexpr auto fabs(quantity<Unit, Rep> q) {
+    return abs(q);
+  }
 } // namespace physics;
 
 // allow sqrt and cbrt to be used in the global and std namespace
@@ -379,16 +627,19 @@ using physics::fabs;
 using physics::sgn;
 }
 
-// multiply and divide doubles and quantities, add and subtract doubles and
-// dimensionless quantities
-template <class Unit>
-constexpr auto operator*(double d, physics::quantity<Unit> q) {
+// multiply and divide doubles (or other scalars) and quantities, add and
+// subtract doubles and dimensionless quantities
+template <class T, class Unit, class Rep,
+          class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+constexpr auto operator*(T d, physics::quantity<Unit, Rep> q) {
   return q * d;
 }
-template <class Unit>
-constexpr auto operator/(double d, physics::quantity<Unit> q) {
-  return physics::quantity<physics::unit_pow<Unit, std::ratio<-1>>>{
-      d / q.raw_value()};
+template <class T, class Unit, class Rep,
+          class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+constexpr auto operator/(T d, physics::quantity<Unit, Rep> q) {
+  using R = physics::unit_impl::common_rep<T, Rep>;
+  return physics::quantity<physics::unit_pow<Unit, std::ratio<-1>>, R>{
+      static_cast<R>(d / q.raw_value())};
 }
 
 #endif
@@ -0,0 +1,191 @@
+#ifndef PHYSICS_UNIT_ARRAY_LOADED
+#define PHYSICS_UNIT_ARRAY_LOADED
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <ratio>
+#include <type_traits>
+
+#include <physics/unit.hh>
+#include <physics/unit/expression.hh>
+#include <physics/util/aligned.hh>
+#include <physics/util/span.hh>
+
+// =============================================================================
+// quantity_array<Unit>: contiguous array of quantities, stored in a
+//                       PHYSICS_SIMD_ALIGNMENT (64 byte) aligned buffer
+// quantity_span<Unit>: non-owning view of contiguous quantities (e.g. a
+//                      quantity_array or a std::vector<quantity<Unit>>)
+//
+// Notes:
+//  * quantity<Unit> is a standard-layout wrapper around a single double, so an
+//    array of quantities is just a double buffer (accessible through
+//    raw_data()).
+//  * Whole-array arithmetic (+, -, *, /, scaling, pow<N,D>(), sqrt(), cbrt())
+//    is implemented through the expression templates in
+//    physics/unit/expression.hh: an arithmetic expression is evaluated
+//    in a single loop over the raw buffers when it is assigned to an array.
+//    The loops are simple enough to be auto-vectorized. Build with
+//    -march=native (or the PHYSICS_NATIVE_ARCH CMake option) to get AVX2/AVX-512
+//    code.
+//  * The result units are obtained through unit_multiply, unit_divide and
+//    unit_pow, exactly as for the element-wise quantity arithmetic.
+//  * Assigning an expression with a compatible unit rescales the result, and
+//    adding/subtracting arrays with compatible units rescales the RHS to the
+//    unit of the LHS. The rescale factor is evaluated once per operation.
+//  * convert<ToUnit>() converts a whole range of quantities at once, with a
+//    single multiplication per element.
+// =============================================================================
+namespace physics {
+
+template <class Unit> using quantity_span = span<quantity<Unit>>;
+template <class Unit> using const_quantity_span = span<const quantity<Unit>>;
+
+// bulk unit conversion, ToUnit can be either a unit or a quantity type.
+//
+// The powers of 10 and pi and the unit factors are folded into a single
+// rescale factor, which is applied in a (vectorized) loop over the raw values.
+//
+// 1. convert a range (span or contiguous container) of quantities into a new
+//    quantity_array<ToUnit>
+template <class ToUnit, class Q> auto convert(span<Q> in);
+template <class ToUnit, class Container> auto convert(const Container& in);
+// 2. convert into an existing range of quantities with the same size (the
+//    output range can be the same as the input range, or have a different
+//    Rep)
+template <class QIn, class QOut> void convert(span<QIn> in, span<QOut> out);
+
+template <class Unit> class quantity_array {
+public:
+  using unit = Unit;
+  using value_type = quantity<Unit>;
+  using storage_type = aligned_vector<value_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using iterator = typename storage_type::iterator;
+  using const_iterator = typename storage_type::const_iterator;
+
+  static_assert(sizeof(value_type) == sizeof(double) &&
+                    std::is_standard_layout<value_type>::value,
+                "quantity<Unit> has to be layout-compatible with double.");
+
+  // constructors
+  //
+  // 1. empty array, or n zero-initialized quantities
+  quantity_array() = default;
+  explicit quantity_array(size_type n) : data_(n) {}
+  // 2. n copies of q
+  quantity_array(size_type n, value_type q) : data_(n, q) {}
+  // 3. from a list of quantities
+  quantity_array(std::initializer_list<value_type> il) : data_(il) {}
+  // 4. copy of a range of (compatible) quantities
+  template <class Q>
+  explicit quantity_array(span<Q> s) : data_(s.size()) {
+    assign(expression_impl::as_expression(s));
+  }
+  // 5. evaluate an expression with a compatible unit
+  template <class E>
+  quantity_array(const quantity_expression<E>& e) : data_(e.derived().size()) {
+    assign(e.derived());
+  }
+
+  // assignment from an expression with a compatible unit. The expression is
+  // allowed to reference this array.
+  template <class E> quantity_array& operator=(const quantity_expression<E>& e) {
+    resize(e.derived().size());
+    assign(e.derived());
+    return *this;
+  }
+
+  // size and capacity
+  size_type size() const { return data_.size(); }
+  bool empty() const { return data_.empty(); }
+  void resize(size_type n) { data_.resize(n); }
+  void reserve(size_type n) { data_.reserve(n); }
+  void clear() { data_.clear(); }
+  void push_back(value_type q) { data_.push_back(q); }
+
+  // element access
+  reference operator[](size_type i) { return data_[i]; }
+  const_reference operator[](size_type i) const { return data_[i]; }
+  iterator begin() { return data_.begin(); }
+  iterator end() { return data_.end(); }
+  const_iterator begin() const { return data_.begin(); }
+  const_iterator end() const { return data_.end(); }
+  value_type* data() { return data_.data(); }
+  const value_type* data() const { return data_.data(); }
+  // raw double buffer, with the numerical values as returned by
+  // quantity::raw_value()
+  double* raw_data() { return reinterpret_cast<double*>(data_.data()); }
+  const double* raw_data() const {
+    return reinterpret_cast<const double*>(data_.data());
+  }
+
+  // *=, /=, += and -= assignment (with doubles, quantities and compatible
+  // arrays or expressions)
+  quantity_array& operator*=(double d) { return *this = *this * d; }
+  quantity_array& operator/=(double d) { return *this = *this / d; }
+  template <class T> quantity_array& operator+=(const T& rhs) {
+    return *this = *this + rhs;
+  }
+  template <class T> quantity_array& operator-=(const T& rhs) {
+    return *this = *this - rhs;
+  }
+
+  // element-wise power and sqrt/cbrt (see quantity::pow()), returns an
+  // expression
+  template <class Ratio> auto pow() const {
+    return physics::pow<Ratio>(*this);
+  }
+  template <std::intmax_t N, std::intmax_t D = 1> auto pow() const {
+    return pow<std::ratio<N, D>>();
+  }
+  auto sqrt() const { return pow<1, 2>(); }
+  auto cbrt() const { return pow<1, 3>(); }
+
+private:
+  template <class E> void assign(const E& e) {
+    expression_impl::evaluate<Unit>(
+        e, PHYSICS_ASSUME_ALIGNED(raw_data(), PHYSICS_SIMD_ALIGNMENT));
+  }
+
+  storage_type data_;
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: convert
+// =============================================================================
+namespace physics {
+namespace array_impl {
+// unit of a unit or quantity type
+template <class UnitOrQuantity>
+using unit_type = typename std::conditional<
+    unit_impl::is_quantity<UnitOrQuantity>::value,
+    typename UnitOrQuantity::unit, UnitOrQuantity>::type;
+} // namespace array_impl
+
+template <class ToUnit, class Q> auto convert(span<Q> in) {
+  return quantity_array<array_impl::unit_type<ToUnit>>{in};
+}
+template <class ToUnit, class Container> auto convert(const Container& in) {
+  return convert<ToUnit>(make_span(in));
+}
+template <class QIn, class QOut> void convert(span<QIn> in, span<QOut> out) {
+  static_assert(!std::is_const<QOut>::value,
+                "Cannot convert into a range of const quantities");
+  if (in.size() != out.size()) {
+    throw expression_error{"Conversion size mismatch (" +
+                               std::to_string(in.size()) + " vs. " +
+                               std::to_string(out.size()) + ")",
+                           "expression_size_error"};
+  }
+  expression_impl::evaluate<typename QOut::unit>(
+      expression_impl::as_expression(in),
+      reinterpret_cast<typename QOut::rep*>(out.data()));
+}
+} // namespace physics
+
+#endif
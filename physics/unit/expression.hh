@@ -0,0 +1,367 @@
+#ifndef PHYSICS_UNIT_EXPRESSION_LOADED
+#define PHYSICS_UNIT_EXPRESSION_LOADED
+
+#include <cstddef>
+#include <ratio>
+#include <string>
+#include <type_traits>
+
+#include <physics/unit.hh>
+#include <physics/unit/prototype.hh>
+#include <physics/util/exception.hh>
+#include <physics/util/span.hh>
+
+// =============================================================================
+// quantity_expression<Derived>: expression templates for lazy, fused
+// quantity-array arithmetic
+//
+// Arithmetic on quantity arrays, quantity spans and expressions does not
+// compute anything, it returns a light-weight expression object instead. The
+// unit of the result is computed while building the expression, using the
+// regular compile-time unit algebra (unit_multiply, unit_divide, unit_pow and
+// are_compatible for addition/subtraction). The expression is only evaluated
+// when it is assigned to a quantity_array (or passed to eval()), in a single
+// loop without any temporary arrays.
+//
+// Notes:
+//  * Expressions reference the arrays they were built from, without taking
+//    ownership. Do not store an expression (e.g. with auto) that references
+//    a temporary array beyond the statement it was created in, use eval()
+//    to materialize the result instead.
+//  * Doubles in an expression behave like dimensionless quantities, i.e. they
+//    can scale any expression, but can only be added to dimensionless
+//    expressions.
+//  * The element-wise semantics (raw values for dimensionless quantities,
+//    rescaling of compatible units, ...) are the same as for quantity.
+//  * Expressions are evaluated in double precision. Spans of quantities with a
+//    different Rep (e.g. float) are converted element by element.
+//
+// Protocol for an expression node E:
+//  * E::unit: the (compile-time) unit of the expression
+//  * E::is_scalar: true if the node is a broadcasted scalar
+//  * E::size(): the number of elements (0 for scalars)
+//  * E::eval(i): the raw value of element i
+// =============================================================================
+namespace physics {
+
+template <class Derived> class quantity_expression {
+public:
+  const Derived& derived() const { return static_cast<const Derived&>(*this); }
+  // evaluate a single element
+  auto operator[](std::size_t i) const {
+    return quantity<typename Derived::unit>{derived().eval(i)};
+  }
+};
+
+// test if T can be used as operand in an expression (expression, array or
+// span of quantities)
+template <class T> struct is_expression_operand;
+
+// materialize an expression (or copy an array/span) into a new quantity_array
+template <class E>
+quantity_array<typename E::unit> eval(const quantity_expression<E>& e);
+
+// expression arithmetic (see implementation below for the exact signatures)
+//
+// 1. expression-expression: +, -, *, /
+// 2. expression-quantity and quantity-expression: +, -, *, /
+// 3. expression-double and double-expression: +, -, *, /
+// 4. unary minus
+// 5. pow<Ratio>, pow<N, D>, sqrt and cbrt
+} // namespace physics
+
+// =============================================================================
+// implementation: exceptions
+// =============================================================================
+namespace physics {
+class expression_error : public physics::exception {
+public:
+  expression_error(const std::string& msg,
+                   const std::string& type = "expression_error")
+      : physics::exception{msg, type} {}
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: expression nodes
+// =============================================================================
+namespace physics {
+namespace expression_impl {
+// leaf node, referencing a contiguous buffer of raw values (converted to
+// double on the fly)
+template <class Unit, class Rep = double>
+class terminal : public quantity_expression<terminal<Unit, Rep>> {
+public:
+  using unit = Unit;
+  static constexpr bool is_scalar = false;
+  terminal(const Rep* data, std::size_t size) : data_{data}, size_{size} {}
+  std::size_t size() const { return size_; }
+  double eval(std::size_t i) const { return data_[i]; }
+
+private:
+  const Rep* data_;
+  std::size_t size_;
+};
+// leaf node, a broadcasted scalar
+template <class Unit> class scalar : public quantity_expression<scalar<Unit>> {
+public:
+  using unit = Unit;
+  static constexpr bool is_scalar = true;
+  explicit scalar(double value) : value_{value} {}
+  std::size_t size() const { return 0; }
+  double eval(std::size_t) const { return value_; }
+
+private:
+  double value_;
+};
+// unary operation node
+template <class Op, class E>
+class unary : public quantity_expression<unary<Op, E>> {
+public:
+  using unit = typename Op::unit;
+  static constexpr bool is_scalar = E::is_scalar;
+  explicit unary(const E& e) : e_{e} {}
+  std::size_t size() const { return e_.size(); }
+  double eval(std::size_t i) const { return op_(e_.eval(i)); }
+
+private:
+  E e_;
+  Op op_;
+};
+// binary operation node
+template <class Op, class L, class R>
+class binary : public quantity_expression<binary<Op, L, R>> {
+public:
+  using unit = typename Op::unit;
+  static constexpr bool is_scalar = L::is_scalar && R::is_scalar;
+  binary(const L& l, const R& r) : l_{l}, r_{r} {
+    if (!L::is_scalar && !R::is_scalar && l_.size() != r_.size()) {
+      throw expression_error{"Expression size mismatch (" +
+                                 std::to_string(l_.size()) + " vs. " +
+                                 std::to_string(r_.size()) + ")",
+                             "expression_size_error"};
+    }
+  }
+  std::size_t size() const { return L::is_scalar ? r_.size() : l_.size(); }
+  double eval(std::size_t i) const { return op_(l_.eval(i), r_.eval(i)); }
+
+private:
+  L l_;
+  R r_;
+  Op op_;
+};
+
+// operations, with the resulting unit. Addition and subtraction rescale the
+// RHS to the LHS unit, with the factor evaluated once per expression.
+template <class Unit1, class Unit2> struct add_op {
+  static_assert(unit_impl::are_compatible<Unit1, Unit2>::value,
+                "Attempting to add quantities with incompatible units");
+  using unit = Unit1;
+  double operator()(double x, double y) const { return x + y * factor; }
+  const double factor{unit_impl::rescale_factor<Unit1, Unit2>()};
+};
+template <class Unit1, class Unit2> struct subtract_op {
+  static_assert(unit_impl::are_compatible<Unit1, Unit2>::value,
+                "Attempting to subtract quantities with incompatible units");
+  using unit = Unit1;
+  double operator()(double x, double y) const { return x - y * factor; }
+  const double factor{unit_impl::rescale_factor<Unit1, Unit2>()};
+};
+template <class Unit1, class Unit2> struct multiply_op {
+  using unit = unit_multiply<Unit1, Unit2>;
+  double operator()(double x, double y) const { return x * y; }
+};
+template <class Unit1, class Unit2> struct divide_op {
+  using unit = unit_divide<Unit1, Unit2>;
+  double operator()(double x, double y) const { return x / y; }
+};
+template <class Unit> struct negate_op {
+  using unit = Unit;
+  double operator()(double x) const { return -x; }
+};
+// same as quantity<>::pow(): the unit factor is applied to the value
+template <class Unit, class Ratio> struct pow_op {
+  using unit =
+      unit_pow<physics::unit<typename Unit::system, typename Unit::dimensions,
+                             typename Unit::pow_10, typename Unit::pow_pi>,
+               Ratio>;
+  double operator()(double x) const {
+    return physics::pow<Ratio>(x * Unit::factor::num / Unit::factor::den);
+  }
+};
+
+// dimensionless unit in the unit system of Unit, used for raw doubles
+template <class Unit>
+using dimensionless_unit =
+    physics::unit<typename Unit::system,
+                  typename Unit::system::dimensionless>;
+
+// convert an operand into an expression node
+template <class E> E as_expression(const quantity_expression<E>& e) {
+  return e.derived();
+}
+template <class Unit>
+terminal<Unit> as_expression(const quantity_array<Unit>& a) {
+  return {a.raw_data(), a.size()};
+}
+template <class Unit, class Rep>
+terminal<Unit, Rep> as_expression(span<const quantity<Unit, Rep>> s) {
+  return {reinterpret_cast<const Rep*>(s.data()), s.size()};
+}
+template <class Unit, class Rep>
+terminal<Unit, Rep> as_expression(span<quantity<Unit, Rep>> s) {
+  return as_expression(span<const quantity<Unit, Rep>>{s});
+}
+template <class T>
+using expression_type = decltype(as_expression(std::declval<const T&>()));
+
+// node construction helpers
+template <template <class, class> class Op, class L, class R>
+binary<Op<typename L::unit, typename R::unit>, L, R> make_binary(const L& l,
+                                                                 const R& r) {
+  return {l, r};
+}
+template <class Op, class E> unary<Op, E> make_unary(const E& e) {
+  return unary<Op, E>{e};
+}
+} // namespace expression_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: is_expression_operand
+// =============================================================================
+namespace physics {
+template <class T>
+struct is_expression_operand
+    : std::is_base_of<quantity_expression<T>, T> {};
+template <class Unit>
+struct is_expression_operand<quantity_array<Unit>> : std::true_type {};
+template <class Unit, class Rep>
+struct is_expression_operand<span<quantity<Unit, Rep>>> : std::true_type {};
+template <class Unit, class Rep>
+struct is_expression_operand<span<const quantity<Unit, Rep>>>
+    : std::true_type {};
+} // namespace physics
+
+// =============================================================================
+// implementation: powers, sqrt and cbrt
+// =============================================================================
+namespace physics {
+template <class Ratio, class E,
+          class = typename std::enable_if<is_expression_operand<E>::value>::type>
+auto pow(const E& e) {
+  using unit = typename expression_impl::expression_type<E>::unit;
+  return expression_impl::make_unary<expression_impl::pow_op<unit, Ratio>>(
+      expression_impl::as_expression(e));
+}
+template <std::intmax_t N, std::intmax_t D, class E,
+          class = typename std::enable_if<is_expression_operand<E>::value>::type>
+auto pow(const E& e) {
+  return pow<std::ratio<N, D>>(e);
+}
+template <std::intmax_t N, class E,
+          class = typename std::enable_if<is_expression_operand<E>::value>::type>
+auto pow(const E& e) {
+  return pow<std::ratio<N>>(e);
+}
+template <class E,
+          class = typename std::enable_if<is_expression_operand<E>::value>::type>
+auto sqrt(const E& e) {
+  return pow<std::ratio<1, 2>>(e);
+}
+template <class E,
+          class = typename std::enable_if<is_expression_operand<E>::value>::type>
+auto cbrt(const E& e) {
+  return pow<std::ratio<1, 3>>(e);
+}
+} // namespace physics
+
+// =============================================================================
+// implementation: evaluation
+// =============================================================================
+namespace physics {
+namespace expression_impl {
+// evaluate an expression into a raw buffer in unit Unit (in a single loop)
+template <class Unit, class E, class Rep> void evaluate(const E& e, Rep* out) {
+  static_assert(unit_impl::are_compatible<Unit, typename E::unit>::value,
+                "Attempting to assign an expression with an incompatible unit");
+  static_assert(!E::is_scalar, "Cannot evaluate a scalar expression.");
+  const double factor{unit_impl::rescale_factor<Unit, typename E::unit>()};
+  const std::size_t n{e.size()};
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = static_cast<Rep>(e.eval(i) * factor);
+  }
+}
+} // namespace expression_impl
+
+template <class E>
+quantity_array<typename E::unit> eval(const quantity_expression<E>& e) {
+  return quantity_array<typename E::unit>{e};
+}
+} // namespace physics
+
+// =============================================================================
+// implementation: expression arithmetic
+//
+// Similar to the quantity-double operators, these are defined in the global
+// namespace.
+// =============================================================================
+// helper macro to define a binary operator for all operand combinations
+// (operand-operand, operand-quantity, quantity-operand, operand-double and
+// double-operand)
+#define PHYSICS_EXPRESSION_BINARY_OPERATOR(OP, OP_IMPL)                        \
+  template <class L, class R,                                                  \
+            class = typename std::enable_if<                                   \
+                physics::is_expression_operand<L>::value &&                    \
+                physics::is_expression_operand<R>::value>::type>               \
+  auto operator OP(const L& l, const R& r) {                                   \
+    using namespace physics::expression_impl;                                  \
+    return make_binary<OP_IMPL>(as_expression(l), as_expression(r));           \
+  }                                                                            \
+  template <class L, class Unit, class Rep,                                    \
+            class = typename std::enable_if<                                   \
+                physics::is_expression_operand<L>::value>::type>               \
+  auto operator OP(const L& l, physics::quantity<Unit, Rep> q) {               \
+    using namespace physics::expression_impl;                                  \
+    return make_binary<OP_IMPL>(as_expression(l),                              \
+                                scalar<Unit>{double(q.raw_value())});          \
+  }                                                                            \
+  template <class Unit, class Rep, class R,                                    \
+            class = typename std::enable_if<                                   \
+                physics::is_expression_operand<R>::value>::type>               \
+  auto operator OP(physics::quantity<Unit, Rep> q, const R& r) {               \
+    using namespace physics::expression_impl;                                  \
+    return make_binary<OP_IMPL>(scalar<Unit>{double(q.raw_value())},           \
+                                as_expression(r));                             \
+  }                                                                            \
+  template <class L, class = typename std::enable_if<                          \
+                         physics::is_expression_operand<L>::value>::type>      \
+  auto operator OP(const L& l, double d) {                                     \
+    using namespace physics::expression_impl;                                  \
+    using unit = dimensionless_unit<typename expression_type<L>::unit>;        \
+    return make_binary<OP_IMPL>(as_expression(l), scalar<unit>{d});            \
+  }                                                                            \
+  template <class R, class = typename std::enable_if<                          \
+                         physics::is_expression_operand<R>::value>::type>      \
+  auto operator OP(double d, const R& r) {                                     \
+    using namespace physics::expression_impl;                                  \
+    using unit = dimensionless_unit<typename expression_type<R>::unit>;        \
+    return make_binary<OP_IMPL>(scalar<unit>{d}, as_expression(r));            \
+  }
+
+PHYSICS_EXPRESSION_BINARY_OPERATOR(+, add_op)
+PHYSICS_EXPRESSION_BINARY_OPERATOR(-, subtract_op)
+PHYSICS_EXPRESSION_BINARY_OPERATOR(*, multiply_op)
+PHYSICS_EXPRESSION_BINARY_OPERATOR(/, divide_op)
+
+template <class E, class = typename std::enable_if<
+                       physics::is_expression_operand<E>::value>::type>
+auto operator-(const E& e) {
+  using namespace physics::expression_impl;
+  using unit = typename expression_type<E>::unit;
+  return make_unary<negate_op<unit>>(as_expression(e));
+}
+
+#undef PHYSICS_EXPRESSION_BINARY_OPERATOR
+
+#endif
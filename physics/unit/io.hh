@@ -1,12 +1,18 @@
 #ifndef PHYSICS_UNIT_IO_LOADED
 #define PHYSICS_UNIT_IO_LOADED
 
+#include <cmath>
+#include <limits>
+#include <locale>
 #include <ostream>
 #include <istream>
 #include <sstream>
 #include <string>
+#include <type_traits>
 
+#include <physics/unit/math.hh>
 #include <physics/unit/prototype.hh>
+#include <physics/util/exception.hh>
 
 // =============================================================================
 // I/O stream definitions. 
@@ -18,6 +24,25 @@
 //
 // and quantity<> can be streamed to a ostream,
 // and an istream can be streamed to a quantity.
+//
+// Text with a unit name ("5 GeV", "2.5mm", "30 deg") is parsed into a quantity
+// with parse_quantity(text, q).
+//
+// Notes:
+//  * The names are compile time traits (no registration at run time, so
+//    they can be used during static initialization). parse_quantity knows
+//    the named units listed for the unit system of the quantity with
+//    PHYSICS_DEFINE_SYSTEM_UNIT_NAMES (as done for the standard units).
+//  * The named unit has to be of the same unit system and dimensions as the
+//    quantity (it can differ by its factor), otherwise parse_quantity throws
+//    a unit_name_error, as for a name that is not known. Only single names
+//    are known, not products like "GeV/c".
+//  * The number is read as [+-]digits[.digits][(e|E)[+-]digits] (at least
+//    one digit before or after the point), independent of the locale. Hex
+//    numbers, inf and nan are not numbers.
+//  * A number without a name is taken to be in the unit of the quantity.
+//  * For an integral representation the value is rounded to the nearest
+//    integer, a value out of its range throws a unit_name_error.
 // =============================================================================
 namespace physics {
 
@@ -26,20 +51,57 @@ template <class Unit> std::string unit_string();
 template <class Quantity> std::string unit_string(Quantity) {
   return unit_string<typename Quantity::unit>();
 }
+
+class unit_name_error : public physics::exception {
+public:
+  unit_name_error(const std::string& msg,
+                  const std::string& type = "unit_name_error")
+      : physics::exception{msg, type} {}
+};
+
+// parse "<number> [<unit name>]" into q, false if the text does not start
+// with a number
+template <class Unit, class Rep>
+bool parse_quantity(const std::string& text, quantity<Unit, Rep>& q);
+
+namespace unit_impl {
+template <class... Units> struct unit_list;
+// the name of a unit (nullptr if it has none), set with
+// PHYSICS_DEFINE_UNIT_NAME
+template <class Unit> struct unit_name {
+  static constexpr const char* value() { return nullptr; }
+};
+// the named units (or quantities, or unit_lists of them) of a unit system
+// that parse_quantity knows, set with PHYSICS_DEFINE_SYSTEM_UNIT_NAMES
+template <class System> struct system_unit_names {
+  using type = unit_list<>;
+};
+// the name of the unit, or an empty string
+template <class Unit> std::string registered_unit_name();
+} // namespace unit_impl
 }
 #define PHYSICS_DEFINE_UNIT_NAME(UNIT, NAME)                                   \
   template <> inline std::string physics::unit_string<UNIT>() {                \
     return " " NAME;                                                           \
-  }
+  }                                                                            \
+  template <> struct physics::unit_impl::unit_name<UNIT> {                     \
+    static constexpr const char* value() { return NAME; }                      \
+  };
 #define PHYSICS_DEFINE_QUANTITY_NAME(QUANTITY, NAME)                           \
   PHYSICS_DEFINE_UNIT_NAME(typename QUANTITY::unit, NAME)
+// list the named units of SYSTEM for parse_quantity (from the global scope)
+#define PHYSICS_DEFINE_SYSTEM_UNIT_NAMES(SYSTEM, ...)                          \
+  template <> struct physics::unit_impl::system_unit_names<SYSTEM> {           \
+    using type = physics::unit_impl::unit_list<__VA_ARGS__>;                   \
+  };
 
 // stream value(), equivalent to <ostream> << q.value();
-template <class Unit>
-std::ostream& operator<<(std::ostream& os, const physics::quantity<Unit>& q);
+template <class Unit, class Rep>
+std::ostream& operator<<(std::ostream& os,
+                         const physics::quantity<Unit, Rep>& q);
 // store new double value
-template <class Unit>
-std::istream& operator>>(std::istream& is, physics::quantity<Unit>& q);
+template <class Unit, class Rep>
+std::istream& operator>>(std::istream& is, physics::quantity<Unit, Rep>& q);
 
 // =============================================================================
 // implementation: unit streaming
@@ -127,18 +189,205 @@ template <class Unit> std::string unit_string() {
 } // physics
 
 // =============================================================================
-// implementation: quantity I/O
+// implementation: unit names
 // =============================================================================
+namespace physics {
+namespace unit_impl {
+// the unit without factors, with the same system and dimensions
 template <class Unit>
-std::ostream& operator<<(std::ostream& os, const physics::quantity<Unit>& q) {
+using base_unit = unit<typename Unit::system, typename Unit::dimensions,
+                       std::ratio<0>, std::ratio<0>, std::ratio<1>>;
+template <class Unit> constexpr double base_scale() {
+  return rescale_factor<base_unit<Unit>, Unit>();
+}
+
+// all SI-prefix versions of a quantity, as defined with
+// PHYSICS_DEFINE_PREFIX_QUANTITIES
+template <class Unit, int Scale>
+using prefix_unit =
+    unit<typename Unit::system, typename Unit::dimensions,
+         std::ratio_add<typename Unit::pow_10, std::ratio<Scale>>,
+         typename Unit::pow_pi, typename Unit::factor>;
+template <class Quantity, class Unit = typename Quantity::unit>
+using prefix_units =
+    unit_list<prefix_unit<Unit, -24>, prefix_unit<Unit, -21>,
+              prefix_unit<Unit, -18>, prefix_unit<Unit, -15>,
+              prefix_unit<Unit, -12>, prefix_unit<Unit, -9>,
+              prefix_unit<Unit, -6>, prefix_unit<Unit, -3>,
+              prefix_unit<Unit, -2>, prefix_unit<Unit, -1>,
+              prefix_unit<Unit, 0>, prefix_unit<Unit, 1>, prefix_unit<Unit, 2>,
+              prefix_unit<Unit, 3>, prefix_unit<Unit, 6>, prefix_unit<Unit, 9>,
+              prefix_unit<Unit, 12>, prefix_unit<Unit, 15>,
+              prefix_unit<Unit, 18>, prefix_unit<Unit, 21>,
+              prefix_unit<Unit, 24>>;
+
+template <class Unit> std::string registered_unit_name() {
+  const char* name{unit_name<Unit>::value()};
+  return name ? std::string{name} : std::string{};
+}
+
+// search a named unit in the list, the first one with the name that
+// converts to Unit sets the factor
+struct unit_name_match {
+  bool named{false};
+  bool converts{false};
+  double factor{1};
+};
+template <class Unit, class Named>
+void match_unit_name(const std::string& name, unit_name_match& match,
+                     Named*) {
+  const char* named{unit_name<Named>::value()};
+  if (match.converts || !named || name != named) {
+    return;
+  }
+  match.named = true;
+  if (std::is_same<base_unit<Named>, base_unit<Unit>>::value) {
+    match.converts = true;
+    match.factor = base_scale<Named>() / base_scale<Unit>();
+  }
+}
+template <class Unit, class Named, class Rep>
+void match_unit_name(const std::string& name, unit_name_match& match,
+                     quantity<Named, Rep>*) {
+  match_unit_name<Unit>(name, match, static_cast<Named*>(nullptr));
+}
+template <class Unit, class... Named>
+void match_unit_name(const std::string& name, unit_name_match& match,
+                     unit_list<Named...>*) {
+  // expand the list in order
+  const bool ordered[]{
+      (match_unit_name<Unit>(name, match, static_cast<Named*>(nullptr)),
+       true)...,
+      true};
+  static_cast<void>(ordered);
+}
+
+// factor from the named unit to Unit
+template <class Unit>
+double named_unit_factor(const std::string& name, const std::string& text) {
+  using names = typename system_unit_names<typename Unit::system>::type;
+  unit_name_match match;
+  match_unit_name<Unit>(name, match, static_cast<names*>(nullptr));
+  if (!match.named) {
+    throw unit_name_error{"unknown unit '" + name + "' in '" + text + "'"};
+  }
+  if (!match.converts) {
+    throw unit_name_error{"unit '" + name + "' in '" + text +
+                              "' does not convert to" + unit_string<Unit>(),
+                          "unit_dimension_error"};
+  }
+  return match.factor;
+}
+
+// read the number at the start of the text (after white space) into value,
+// the position after the number, or npos if the text does not start with a
+// number
+inline std::string::size_type read_number(const std::string& text,
+                                          double& value) {
+  const auto digits = [&text](std::string::size_type i) {
+    const auto begin = i;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+      ++i;
+    }
+    return i - begin;
+  };
+  const auto start = text.find_first_not_of(" \t\n\r\f\v");
+  if (start == std::string::npos) {
+    return std::string::npos;
+  }
+  auto i = start;
+  if (text[i] == '+' || text[i] == '-') {
+    ++i;
+  }
+  auto n = digits(i);
+  i += n;
+  if (i < text.size() && text[i] == '.') {
+    const auto fraction = digits(i + 1);
+    n += fraction;
+    i += 1 + fraction;
+  }
+  if (n == 0) {
+    return std::string::npos;
+  }
+  // an exponent needs digits ("5eV" is 5 eV)
+  if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+    auto j = i + 1;
+    if (j < text.size() && (text[j] == '+' || text[j] == '-')) {
+      ++j;
+    }
+    const auto exponent = digits(j);
+    if (exponent > 0) {
+      i = j + exponent;
+    }
+  }
+  std::istringstream in{text.substr(start, i - start)};
+  in.imbue(std::locale::classic());
+  in >> value;
+  if (in.fail()) {
+    throw unit_name_error{"value of '" + text + "' is out of range",
+                          "unit_range_error"};
+  }
+  return i;
+}
+
+// the parsed value in the representation of the quantity, integral
+// representations are rounded to the nearest value (the unit factor is not
+// exact) and have to be in range
+template <class Rep>
+Rep parsed_value(double value, const std::string& text, std::true_type) {
+  const double rounded{std::round(value)};
+  // max() + 1 is a power of 2, and exact as a double
+  if (!(rounded >= static_cast<double>(std::numeric_limits<Rep>::lowest()) &&
+        rounded < static_cast<double>(std::numeric_limits<Rep>::max()) + 1.)) {
+    throw unit_name_error{"value of '" + text + "' is out of range",
+                          "unit_range_error"};
+  }
+  return static_cast<Rep>(rounded);
+}
+template <class Rep>
+Rep parsed_value(double value, const std::string&, std::false_type) {
+  return static_cast<Rep>(value);
+}
+template <class Rep> Rep parsed_value(double value, const std::string& text) {
+  return parsed_value<Rep>(value, text, std::is_integral<Rep>{});
+}
+} // namespace unit_impl
+
+template <class Unit, class Rep>
+bool parse_quantity(const std::string& text, quantity<Unit, Rep>& q) {
+  double value{0};
+  const auto end = unit_impl::read_number(text, value);
+  if (end == std::string::npos) {
+    return false;
+  }
+  const char* space{" \t\n\r\f\v"};
+  const auto first = text.find_first_not_of(space, end);
+  if (first == std::string::npos) {
+    q = quantity<Unit, Rep>{unit_impl::parsed_value<Rep>(value, text)};
+    return true;
+  }
+  const auto last = text.find_last_not_of(space);
+  const std::string name{text.substr(first, last + 1 - first)};
+  q = quantity<Unit, Rep>{unit_impl::parsed_value<Rep>(
+      value * unit_impl::named_unit_factor<Unit>(name, text), text)};
+  return true;
+}
+} // physics
+
+// =============================================================================
+// implementation: quantity I/O
+// =============================================================================
+template <class Unit, class Rep>
+std::ostream& operator<<(std::ostream& os,
+                         const physics::quantity<Unit, Rep>& q) {
   os << q.value();
   return os;
 }
-template <class Unit>
-std::istream& operator>>(std::istream& is, physics::quantity<Unit>& q){
-  double value;
+template <class Unit, class Rep>
+std::istream& operator>>(std::istream& is, physics::quantity<Unit, Rep>& q){
+  Rep value;
   is >> value;
-  q = physics::quantity<Unit>{q};
+  q = physics::quantity<Unit, Rep>{value};
   return is;
 }
 
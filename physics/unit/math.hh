@@ -1,9 +1,12 @@
 #ifndef PHYSICS_UNIT_MATH_LOADED
 #define PHYSICS_UNIT_MATH_LOADED
 
+#include <cstdint>
 #include <ratio>
+#include <type_traits>
 
 #include <physics/unit/prototype.hh>
+#include <physics/unit/type_traits.hh>
 #include <physics/util/math.hh>
 
 // utility structs to implement compile-time unit multiplication/division
@@ -32,14 +35,39 @@ using dimensions_multiply = typename dimensions_multiply_impl<Dim, Ratio>::type;
 template <class Dim, class Ratio>
 using dimensions_divide = typename dimensions_divide_impl<Dim, Ratio>::type;
 
-// rescale the RHS value to match the unit of the LHS value
-template <class UnitLHS, class UnitRHS> constexpr double rescale_value(double
-rhs_value);
+// rescale the RHS value to match the unit of the LHS value. Floating point
+// values are rescaled in their own precision, integer values are rescaled in
+// double precision and truncated.
+template <class UnitLHS, class UnitRHS, class Rep>
+constexpr Rep rescale_value(Rep rhs_value);
+// the factor used by rescale_value, with the power of 10, power of pi and
+// unit factor folded into a single compile-time constant
+template <class UnitLHS, class UnitRHS> constexpr double rescale_factor();
+// true if the rescale factor is an exact integer (no power of pi, and an
+// integer power of 10 times the unit factors), so that integer values are
+// rescaled without rounding
+template <class UnitLHS, class UnitRHS> struct is_exact_rescale;
+// implicit conversion between compatible units: always for floating point
+// Reps, only for exact rescale factors for integer Reps
+template <class Rep, class UnitLHS, class UnitRHS>
+using is_implicit_rescale =
+    std::integral_constant<bool, !std::is_integral<Rep>::value ||
+                                     is_exact_rescale<UnitLHS, UnitRHS>::value>;
+// integer quantities of Unit1 that are compared to Unit2 in Unit2, as only
+// that conversion is exact
+template <class Rep, class Unit1, class Unit2>
+using is_rhs_comparison = std::integral_constant<
+    bool, std::is_integral<Rep>::value && are_compatible<Unit1, Unit2>::value &&
+              !is_exact_rescale<Unit1, Unit2>::value &&
+              is_exact_rescale<Unit2, Unit1>::value>;
 
 // maximum accuracy pi constant, to avoid dependence on boost::constants, or
 // non-standard compiler features
 constexpr const double
 pi{3.14159265358979323846264338327950288419716939937510582097494459230781640628620899862803482534211706798214808651e+00};
+// long double version, used to evaluate rescale constants at compile time
+constexpr const long double
+pi_l{3.14159265358979323846264338327950288419716939937510582097494459230781640628620899862803482534211706798214808651e+00L};
 
 } // namespace unit_impl
 } // namespace physics
@@ -98,34 +126,74 @@ template <class Dim, class Ratio> struct dimensions_multiply_impl {
 // =============================================================================
 namespace physics {
 namespace unit_impl {
+// The rescale factor is evaluated in long double precision and rounded once,
+// also for fractional powers of 10 and pi (e.g. from unit_sqrt or unit_cbrt),
+// so that every conversion is a single multiplication with a constant.
 template <class UnitLHS, class UnitRHS> struct rescale_impl {
-  constexpr static double pow_10() {
-    using delta_pow_10 =
-        std::ratio_subtract<typename UnitRHS::pow_10, typename UnitLHS::pow_10>;
-    return pow<delta_pow_10>(10.);
-  }
-  constexpr static double pow_pi() {
-    using delta_pow_pi =
-        std::ratio_subtract<typename UnitRHS::pow_pi, typename UnitLHS::pow_pi>;
-    return pow<delta_pow_pi>(physics::unit_impl::pi);
-  }
-  constexpr static double factor() {
-    using factor =
-        std::ratio_divide<typename UnitRHS::factor, typename UnitLHS::factor>;
-    return double(factor::num) / factor::den;
-  }
+  using delta_pow_10 =
+      std::ratio_subtract<typename UnitRHS::pow_10, typename UnitLHS::pow_10>;
+  using delta_pow_pi =
+      std::ratio_subtract<typename UnitRHS::pow_pi, typename UnitLHS::pow_pi>;
+  using factor =
+      std::ratio_divide<typename UnitRHS::factor, typename UnitLHS::factor>;
+  constexpr static double value =
+      static_cast<double>(constexpr_pow<delta_pow_10>(10.L) *
+                          constexpr_pow<delta_pow_pi>(pi_l) * factor::num /
+                          factor::den);
 };
 // no-op specialization when no rescaling is needed
 template <class Unit> struct rescale_impl<Unit, Unit> {
-  constexpr static std::intmax_t pow_10() { return 1; }
-  constexpr static std::intmax_t pow_pi() { return 1; }
-  constexpr static std::intmax_t factor() { return 1; }
+  constexpr static double value = 1.;
 };
-template <class UnitLHS, class UnitRHS> constexpr double rescale_value(double
-rhs_value) {
-  return rhs_value * rescale_impl<UnitLHS, UnitRHS>::pow_10() *
-         rescale_impl<UnitLHS, UnitRHS>::pow_pi() *
-         rescale_impl<UnitLHS, UnitRHS>::factor();
+template <class UnitLHS, class UnitRHS>
+constexpr double rescale_impl<UnitLHS, UnitRHS>::value;
+template <class Unit> constexpr double rescale_impl<Unit, Unit>::value;
+
+// num / den x 10^pow10 is an integer (num and den without common factors)
+constexpr bool is_integer_scale(std::intmax_t num, std::intmax_t den,
+                                std::intmax_t pow10) {
+  if (pow10 < 0) {
+    for (; pow10 < 0; ++pow10) {
+      if (num % 10 != 0) {
+        return false;
+      }
+      num /= 10;
+    }
+    return den == 1;
+  }
+  std::intmax_t twos{0}, fives{0};
+  for (; den % 2 == 0; den /= 2) {
+    ++twos;
+  }
+  for (; den % 5 == 0; den /= 5) {
+    ++fives;
+  }
+  return den == 1 && twos <= pow10 && fives <= pow10;
+}
+template <class UnitLHS, class UnitRHS>
+struct is_exact_rescale
+    : std::integral_constant<
+          bool,
+          rescale_impl<UnitLHS, UnitRHS>::delta_pow_pi::num == 0 &&
+              rescale_impl<UnitLHS, UnitRHS>::delta_pow_10::den == 1 &&
+              is_integer_scale(
+                  rescale_impl<UnitLHS, UnitRHS>::factor::num,
+                  rescale_impl<UnitLHS, UnitRHS>::factor::den,
+                  rescale_impl<UnitLHS, UnitRHS>::delta_pow_10::num)> {};
+template <class Unit> struct is_exact_rescale<Unit, Unit> : std::true_type {};
+
+template <class UnitLHS, class UnitRHS> constexpr double rescale_factor() {
+  return rescale_impl<UnitLHS, UnitRHS>::value;
+}
+template <class UnitLHS, class UnitRHS, class Rep>
+constexpr Rep rescale_value(Rep rhs_value) {
+  using scale_type =
+      typename std::conditional<std::is_floating_point<Rep>::value, Rep,
+                                double>::type;
+  constexpr double factor{rescale_impl<UnitLHS, UnitRHS>::value};
+  return (factor == 1.) ? rhs_value
+                        : static_cast<Rep>(rhs_value *
+                                           static_cast<scale_type>(factor));
 }
 
 }
@@ -8,7 +8,8 @@ template <const char* const&... Names> struct unit_system;
 template <class... Dimensions> struct unit_dimensions;
 template <class System, class Dimensions, class Pow10, class PowPi,
           class Factor> struct unit;
-template <class Unit> class quantity;
+template <class Unit, class Rep = double> class quantity;
+template <class Unit> class quantity_array;
 }
 
 #endif
@@ -0,0 +1,488 @@
+#ifndef PHYSICS_UNIT_REDUCE_LOADED
+#define PHYSICS_UNIT_REDUCE_LOADED
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iterator>
+#include <ratio>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <physics/unit.hh>
+#include <physics/unit/type_traits.hh>
+#include <physics/util/exception.hh>
+#include <physics/util/thread_pool.hh>
+
+// =============================================================================
+// Unit-aware reductions over ranges of quantities: sum, mean, variance, min,
+// max and minmax
+//
+// Every reduction takes either a range (span, quantity_array, std::vector,
+// ...) or a pair of random access iterators, and optionally a thread_pool.
+// With a pool, the range is split in (at most) pool.size() contiguous chunks
+// that are reduced in parallel, and the partial results are combined in
+// order, so the result is reproducible for a given pool size.
+//
+// Notes:
+//  * sum() returns a quantity with the same unit, accumulated in Rep (or
+//    std::intmax_t for integer quantities).
+//  * mean() and variance() are evaluated in floating point (double for integer
+//    quantities). The unit of the (population) variance is unit_pow<Unit, 2>.
+//  * mean(), variance(), min(), max() and minmax() throw a reduce_error for an
+//    empty range.
+//  * Ranges shorter than reduce_impl::min_chunk_size per thread are not split
+//    any further.
+//  * The floating point result of sum() depends on the pool size (through the
+//    chunk boundaries). reproducible_sum() instead sums fixed-size blocks and
+//    combines the block sums in a fixed-shape pairwise tree, so its result is
+//    bit-identical for any number of threads (including no pool at all). With
+//    summation::compensated, every addition also carries its rounding error
+//    (Neumaier/Kahan-style compensation, through the branch-free TwoSum).
+// =============================================================================
+namespace physics {
+
+class reduce_error;
+
+namespace reduce_impl {
+template <class It>
+using iterator_quantity =
+    typename std::decay<decltype(*std::declval<It>())>::type;
+template <class Range>
+using range_iterator = decltype(std::begin(std::declval<const Range&>()));
+template <class It>
+using enable_if_quantity_iterator = typename std::enable_if<
+    unit_impl::is_quantity<iterator_quantity<It>>::value>::type;
+template <class Range>
+using enable_if_quantity_range =
+    enable_if_quantity_iterator<range_iterator<Range>>;
+// accumulator type for the sum of quantities with a given Rep
+template <class Rep>
+using sum_rep = typename std::conditional<std::is_integral<Rep>::value,
+                                          std::intmax_t, Rep>::type;
+} // namespace reduce_impl
+
+// 1. sum
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto sum(const Range& r);
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto sum(const Range& r, thread_pool& pool);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto sum(It first, It last);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto sum(It first, It last, thread_pool& pool);
+// 2. mean
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto mean(const Range& r);
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto mean(const Range& r, thread_pool& pool);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto mean(It first, It last);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto mean(It first, It last, thread_pool& pool);
+// 3. (population) variance
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto variance(const Range& r);
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto variance(const Range& r, thread_pool& pool);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto variance(It first, It last);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto variance(It first, It last, thread_pool& pool);
+// 4. min, max and minmax (returns a std::pair{min, max})
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto min(const Range& r);
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto min(const Range& r, thread_pool& pool);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto min(It first, It last);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto min(It first, It last, thread_pool& pool);
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto max(const Range& r);
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto max(const Range& r, thread_pool& pool);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto max(It first, It last);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto max(It first, It last, thread_pool& pool);
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto minmax(const Range& r);
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto minmax(const Range& r, thread_pool& pool);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto minmax(It first, It last);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto minmax(It first, It last, thread_pool& pool);
+// 5. reproducible sum
+enum class summation { pairwise, compensated };
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto reproducible_sum(const Range& r, summation mode = summation::pairwise);
+template <class Range, class = reduce_impl::enable_if_quantity_range<Range>>
+auto reproducible_sum(const Range& r, thread_pool& pool,
+                      summation mode = summation::pairwise);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto reproducible_sum(It first, It last,
+                      summation mode = summation::pairwise);
+template <class It, class = reduce_impl::enable_if_quantity_iterator<It>>
+auto reproducible_sum(It first, It last, thread_pool& pool,
+                      summation mode = summation::pairwise);
+
+class reduce_error : public physics::exception {
+public:
+  reduce_error(const std::string& msg,
+               const std::string& type = "reduce_error")
+      : physics::exception{msg, type} {}
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: parallel reduction
+// =============================================================================
+namespace physics {
+namespace reduce_impl {
+// minimum number of elements per parallel chunk
+constexpr std::size_t min_chunk_size{1 << 14};
+
+// reduce [first, last) with chunk(first, last), in parallel if a pool is
+// given, and combine the partial results in order
+template <class It, class Chunk, class Combine>
+auto parallel_reduce(It first, It last, thread_pool* pool, Chunk chunk,
+                     Combine combine) {
+  static_assert(
+      std::is_base_of<
+          std::random_access_iterator_tag,
+          typename std::iterator_traits<It>::iterator_category>::value,
+      "Parallel reductions require random access iterators.");
+  using result_type = decltype(chunk(first, last));
+  const std::size_t n{static_cast<std::size_t>(std::distance(first, last))};
+  const std::size_t n_chunks{
+      pool ? std::min(pool->size(), (n + min_chunk_size - 1) / min_chunk_size)
+           : 1};
+  if (n_chunks <= 1) {
+    return chunk(first, last);
+  }
+  std::vector<std::future<result_type>> partial;
+  partial.reserve(n_chunks);
+  for (std::size_t i = 0; i < n_chunks; ++i) {
+    const It begin{first + n * i / n_chunks};
+    const It end{first + n * (i + 1) / n_chunks};
+    partial.push_back(pool->submit([=] { return chunk(begin, end); }));
+  }
+  // wait for all chunks before re-throwing any exception, as they read the
+  // range
+  for (auto& p : partial) {
+    p.wait();
+  }
+  result_type result{partial[0].get()};
+  for (std::size_t i = 1; i < n_chunks; ++i) {
+    result = combine(result, partial[i].get());
+  }
+  return result;
+}
+
+template <class It> void check_not_empty(It first, It last, const char* what) {
+  if (first == last) {
+    throw reduce_error{std::string{"Cannot compute the "} + what +
+                           " of an empty range",
+                       "reduce_empty_error"};
+  }
+}
+
+// sum of f(raw_value) over [first, last), with 4 independent accumulators to
+// break the dependency chain of the additions
+template <class Acc, class It, class F>
+Acc sum_raw(It first, It last, F f) {
+  const std::size_t n{static_cast<std::size_t>(last - first)};
+  Acc s0{0}, s1{0}, s2{0}, s3{0};
+  std::size_t i{0};
+  for (; i + 4 <= n; i += 4) {
+    s0 += f(first[i].raw_value());
+    s1 += f(first[i + 1].raw_value());
+    s2 += f(first[i + 2].raw_value());
+    s3 += f(first[i + 3].raw_value());
+  }
+  for (; i < n; ++i) {
+    s0 += f(first[i].raw_value());
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+// minimum or maximum (Op) of the raw values in the non-empty range
+// [first, last), with 4 independent lanes as for sum_raw
+template <class It, class Op> auto extremum_raw(It first, It last, Op op) {
+  const std::size_t n{static_cast<std::size_t>(last - first)};
+  auto m0 = first->raw_value();
+  auto m1 = m0, m2 = m0, m3 = m0;
+  std::size_t i{0};
+  for (; i + 4 <= n; i += 4) {
+    m0 = op(m0, first[i].raw_value());
+    m1 = op(m1, first[i + 1].raw_value());
+    m2 = op(m2, first[i + 2].raw_value());
+    m3 = op(m3, first[i + 3].raw_value());
+  }
+  for (; i < n; ++i) {
+    m0 = op(m0, first[i].raw_value());
+  }
+  return op(op(m0, m1), op(m2, m3));
+}
+struct min_op {
+  template <class T> constexpr T operator()(T a, T b) const {
+    return b < a ? b : a;
+  }
+};
+struct max_op {
+  template <class T> constexpr T operator()(T a, T b) const {
+    return a < b ? b : a;
+  }
+};
+struct identity {
+  template <class T> constexpr T operator()(T x) const { return x; }
+};
+struct plus {
+  template <class T> constexpr T operator()(T a, T b) const { return a + b; }
+};
+
+template <class It> auto sum(It first, It last, thread_pool* pool) {
+  using Q = iterator_quantity<It>;
+  using acc_type = sum_rep<typename Q::rep>;
+  return quantity<typename Q::unit, acc_type>{parallel_reduce(
+      first, last, pool,
+      [](It b, It e) { return sum_raw<acc_type>(b, e, identity{}); },
+      plus{})};
+}
+template <class It> auto mean(It first, It last, thread_pool* pool) {
+  check_not_empty(first, last, "mean");
+  using Q = iterator_quantity<It>;
+  using float_type = unit_impl::floating_rep<typename Q::rep>;
+  const float_type total{static_cast<float_type>(
+      sum(first, last, pool).raw_value())};
+  return quantity<typename Q::unit, float_type>{
+      total / static_cast<float_type>(std::distance(first, last))};
+}
+// two-pass algorithm: mean, then the sum of the squared deviations
+template <class It> auto variance(It first, It last, thread_pool* pool) {
+  using Q = iterator_quantity<It>;
+  using float_type = unit_impl::floating_rep<typename Q::rep>;
+  const float_type m{mean(first, last, pool).raw_value()};
+  const float_type ss{parallel_reduce(
+      first, last, pool,
+      [m](It b, It e) {
+        return sum_raw<float_type>(b, e, [m](typename Q::rep x) {
+          const float_type d{static_cast<float_type>(x) - m};
+          return d * d;
+        });
+      },
+      plus{})};
+  return quantity<unit_pow<typename Q::unit, std::ratio<2>>, float_type>{
+      ss / static_cast<float_type>(std::distance(first, last))};
+}
+template <class It> auto minmax(It first, It last, thread_pool* pool) {
+  check_not_empty(first, last, "minmax");
+  using Q = iterator_quantity<It>;
+  using result_type = std::pair<typename Q::rep, typename Q::rep>;
+  const result_type r{parallel_reduce(
+      first, last, pool,
+      [](It b, It e) {
+        return result_type{extremum_raw(b, e, min_op{}),
+                           extremum_raw(b, e, max_op{})};
+      },
+      [](const result_type& a, const result_type& b) {
+        return result_type{min_op{}(a.first, b.first),
+                           max_op{}(a.second, b.second)};
+      })};
+  return std::pair<Q, Q>{Q{r.first}, Q{r.second}};
+}
+template <class It> auto min(It first, It last, thread_pool* pool) {
+  check_not_empty(first, last, "min");
+  return iterator_quantity<It>{parallel_reduce(
+      first, last, pool,
+      [](It b, It e) { return extremum_raw(b, e, min_op{}); }, min_op{})};
+}
+template <class It> auto max(It first, It last, thread_pool* pool) {
+  check_not_empty(first, last, "max");
+  return iterator_quantity<It>{parallel_reduce(
+      first, last, pool,
+      [](It b, It e) { return extremum_raw(b, e, max_op{}); }, max_op{})};
+}
+} // namespace reduce_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: reproducible sum
+// =============================================================================
+namespace physics {
+namespace reduce_impl {
+// number of elements per block. The block boundaries, and hence the order of
+// all additions, only depend on the size of the range.
+constexpr std::size_t reproducible_block_size{1 << 12};
+
+// partial sum with the accumulated rounding error
+template <class T> struct compensated_value {
+  T sum;
+  T error;
+};
+// sum and exact rounding error of a + b (Knuth's TwoSum)
+template <class T> compensated_value<T> two_sum(T a, T b) {
+  const T s{a + b};
+  const T z{s - a};
+  return {s, (a - (s - z)) + (b - z)};
+}
+
+// summation policies: block sums, combination of two partial sums, and the
+// final value
+struct pairwise_policy {
+  template <class T> using partial = T;
+  template <class T, class It> static T block(It first, It last) {
+    return sum_raw<T>(first, last, identity{});
+  }
+  template <class T> static T combine(T a, T b) { return a + b; }
+  template <class T> static T result(T a) { return a; }
+};
+struct compensated_policy {
+  template <class T> using partial = compensated_value<T>;
+  template <class T>
+  static compensated_value<T> add(compensated_value<T> a, T x) {
+    const compensated_value<T> s{two_sum(a.sum, x)};
+    return {s.sum, a.error + s.error};
+  }
+  template <class T, class It>
+  static compensated_value<T> block(It first, It last) {
+    const std::size_t n{static_cast<std::size_t>(last - first)};
+    compensated_value<T> s0{0, 0}, s1{0, 0}, s2{0, 0}, s3{0, 0};
+    std::size_t i{0};
+    for (; i + 4 <= n; i += 4) {
+      s0 = add(s0, static_cast<T>(first[i].raw_value()));
+      s1 = add(s1, static_cast<T>(first[i + 1].raw_value()));
+      s2 = add(s2, static_cast<T>(first[i + 2].raw_value()));
+      s3 = add(s3, static_cast<T>(first[i + 3].raw_value()));
+    }
+    for (; i < n; ++i) {
+      s0 = add(s0, static_cast<T>(first[i].raw_value()));
+    }
+    return combine(combine(s0, s1), combine(s2, s3));
+  }
+  template <class T>
+  static compensated_value<T> combine(compensated_value<T> a,
+                                      compensated_value<T> b) {
+    const compensated_value<T> s{two_sum(a.sum, b.sum)};
+    return {s.sum, s.error + (a.error + b.error)};
+  }
+  template <class T> static T result(compensated_value<T> a) {
+    return a.sum + a.error;
+  }
+};
+
+// fixed-shape pairwise tree over n > 0 partial sums
+template <class Policy, class P> P tree_sum(const P* p, std::size_t n) {
+  return (n == 1) ? p[0]
+                  : Policy::combine(tree_sum<Policy>(p, n / 2),
+                                    tree_sum<Policy>(p + n / 2, n - n / 2));
+}
+
+template <class Policy, class It>
+auto reproducible_sum(It first, It last, thread_pool* pool) {
+  using Q = iterator_quantity<It>;
+  using acc_type = sum_rep<typename Q::rep>;
+  using partial_type = typename Policy::template partial<acc_type>;
+  using result_type = quantity<typename Q::unit, acc_type>;
+  const std::size_t n{static_cast<std::size_t>(std::distance(first, last))};
+  if (n == 0) {
+    return result_type{0};
+  }
+  constexpr std::size_t block_size{reproducible_block_size};
+  const std::size_t n_blocks{(n + block_size - 1) / block_size};
+  std::vector<partial_type> partial(n_blocks);
+  auto sum_blocks = [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      partial[i] = Policy::template block<acc_type>(
+          first + i * block_size, first + std::min(n, (i + 1) * block_size));
+    }
+  };
+  // the distribution of the blocks over the threads does not affect the
+  // result
+  const std::size_t n_chunks{
+      pool ? std::min(pool->size(), (n + min_chunk_size - 1) / min_chunk_size)
+           : 1};
+  if (n_chunks <= 1) {
+    sum_blocks(0, n_blocks);
+  } else {
+    std::vector<std::future<void>> done;
+    done.reserve(n_chunks);
+    for (std::size_t i = 0; i < n_chunks; ++i) {
+      const std::size_t begin{n_blocks * i / n_chunks};
+      const std::size_t end{n_blocks * (i + 1) / n_chunks};
+      done.push_back(pool->submit([&, begin, end] { sum_blocks(begin, end); }));
+    }
+    // wait for all chunks before re-throwing any exception, as they write to
+    // partial
+    for (auto& d : done) {
+      d.wait();
+    }
+    for (auto& d : done) {
+      d.get();
+    }
+  }
+  return result_type{
+      Policy::result(tree_sum<Policy>(partial.data(), n_blocks))};
+}
+template <class It>
+auto reproducible_sum(It first, It last, thread_pool* pool, summation mode) {
+  return (mode == summation::compensated)
+             ? reproducible_sum<compensated_policy>(first, last, pool)
+             : reproducible_sum<pairwise_policy>(first, last, pool);
+}
+} // namespace reduce_impl
+
+template <class Range, class>
+auto reproducible_sum(const Range& r, summation mode) {
+  return reduce_impl::reproducible_sum(std::begin(r), std::end(r), nullptr,
+                                       mode);
+}
+template <class Range, class>
+auto reproducible_sum(const Range& r, thread_pool& pool, summation mode) {
+  return reduce_impl::reproducible_sum(std::begin(r), std::end(r), &pool,
+                                       mode);
+}
+template <class It, class>
+auto reproducible_sum(It first, It last, summation mode) {
+  return reduce_impl::reproducible_sum(first, last, nullptr, mode);
+}
+template <class It, class>
+auto reproducible_sum(It first, It last, thread_pool& pool, summation mode) {
+  return reduce_impl::reproducible_sum(first, last, &pool, mode);
+}
+} // namespace physics
+
+// =============================================================================
+// implementation: public interface
+// =============================================================================
+#define PHYSICS_REDUCE_DEFINE(name)                                            \
+  template <class Range, class>                                                \
+  auto name(const Range& r) {                                                  \
+    return reduce_impl::name(std::begin(r), std::end(r), nullptr);            \
+  }                                                                            \
+  template <class Range, class>                                                \
+  auto name(const Range& r, thread_pool& pool) {                               \
+    return reduce_impl::name(std::begin(r), std::end(r), &pool);              \
+  }                                                                            \
+  template <class It, class> auto name(It first, It last) {                    \
+    return reduce_impl::name(first, last, nullptr);                            \
+  }                                                                            \
+  template <class It, class>                                                   \
+  auto name(It first, It last, thread_pool& pool) {                            \
+    return reduce_impl::name(first, last, &pool);                              \
+  }
+namespace physics {
+PHYSICS_REDUCE_DEFINE(sum)
+PHYSICS_REDUCE_DEFINE(mean)
+PHYSICS_REDUCE_DEFINE(variance)
+PHYSICS_REDUCE_DEFINE(min)
+PHYSICS_REDUCE_DEFINE(max)
+PHYSICS_REDUCE_DEFINE(minmax)
+} // namespace physics
+#undef PHYSICS_REDUCE_DEFINE
+
+#endif
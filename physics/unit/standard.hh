@@ -180,12 +180,32 @@ PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::temperature, K);
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::amount, mol);
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::luminous_intensity, cd);
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::angle, rad);
+PHYSICS_DEFINE_QUANTITY_NAME(physics::standard_units::angle::degree, "deg");
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::solid_angle, sr);
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::cross_section, barn);
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::mass, g);
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::power, W);
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::force, N);
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(physics::standard_units::pressure, Pa);
+// the names known to parse_quantity
+PHYSICS_DEFINE_SYSTEM_UNIT_NAMES(
+    physics::standard_units::standard_system,
+    physics::unit_impl::prefix_units<physics::standard_units::distance::m>,
+    physics::unit_impl::prefix_units<physics::standard_units::time::s>,
+    physics::unit_impl::prefix_units<physics::standard_units::energy::eV>,
+    physics::unit_impl::prefix_units<physics::standard_units::energy::J>,
+    physics::unit_impl::prefix_units<physics::standard_units::charge::C>,
+    physics::unit_impl::prefix_units<physics::standard_units::temperature::K>,
+    physics::unit_impl::prefix_units<physics::standard_units::amount::mol>,
+    physics::unit_impl::prefix_units<physics::standard_units::luminous_intensity::cd>,
+    physics::unit_impl::prefix_units<physics::standard_units::angle::rad>,
+    physics::unit_impl::prefix_units<physics::standard_units::solid_angle::sr>,
+    physics::unit_impl::prefix_units<physics::standard_units::cross_section::barn>,
+    physics::unit_impl::prefix_units<physics::standard_units::mass::g>,
+    physics::unit_impl::prefix_units<physics::standard_units::power::W>,
+    physics::unit_impl::prefix_units<physics::standard_units::force::N>,
+    physics::unit_impl::prefix_units<physics::standard_units::pressure::Pa>,
+    physics::standard_units::angle::degree);
 
 // define geometrical functions of angles
 
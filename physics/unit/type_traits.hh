@@ -17,6 +17,7 @@ template <class T> struct is_unit_system;
 template <class T> struct is_unit_dimensions;
 template <class T> struct is_unit;
 template <class T> struct is_quantity;
+template <class Unit> struct is_dimensionless;
 
 // test unit compatibility (same system and dimensions)
 template <class U1, class U2> struct are_compatible;
@@ -25,6 +26,15 @@ template <class U1, class U2> struct have_same_system;
 // test for valid std::ratios
 template <class... R> struct are_valid_ratios;
 
+// numerical representation of quantities: the common Rep for mixed-Rep
+// arithmetic, and the floating point type used for e.g. powers and roots
+template <class Rep1, class Rep2>
+using common_rep = typename std::common_type<Rep1, Rep2>::type;
+template <class Rep>
+using floating_rep =
+    typename std::conditional<std::is_floating_point<Rep>::value, Rep,
+                              double>::type;
+
 } // namespace unit_impl
 } // namespace physics
 
@@ -52,7 +62,19 @@ struct is_unit<unit<System, Dimensions, Pow10, PowPi, Factor>>
 
 // is_quantity
 template <class T> struct is_quantity : std::false_type {};
-template <class Unit> struct is_quantity<quantity<Unit>> : std::true_type {};
+template <class Unit, class Rep>
+struct is_quantity<quantity<Unit, Rep>> : std::true_type {};
+
+// is_dimensionless
+template <class Unit>
+struct is_dimensionless
+    : std::is_same<typename Unit::dimensions,
+                   typename Unit::system::dimensionless> {};
+
+// is_dimensionless_value
+template <class T> struct is_dimensionless_value : std::is_arithmetic<T> {};
+template <class Unit, class Rep>
+struct is_dimensionless_value<quantity<Unit, Rep>> : is_dimensionless<Unit> {};
 
 } // namespace unit_impl
 } // namespace physics
@@ -0,0 +1,75 @@
+#ifndef PHYSICS_UTIL_ALIGNED_LOADED
+#define PHYSICS_UTIL_ALIGNED_LOADED
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// =============================================================================
+// Over-aligned memory for SIMD-friendly containers
+//
+// PHYSICS_SIMD_ALIGNMENT is the default alignment (in bytes) of the data
+// buffers of the contiguous containers in this library. 64 bytes matches both
+// a cache line and a full AVX-512 register.
+//
+// PHYSICS_ASSUME_ALIGNED(ptr, alignment) tells the optimizer that ptr is
+// aligned, so the vectorized loops can skip the peeling prologue.
+// =============================================================================
+#ifndef PHYSICS_SIMD_ALIGNMENT
+#define PHYSICS_SIMD_ALIGNMENT 64
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define PHYSICS_ASSUME_ALIGNED(ptr, alignment)                                 \
+  static_cast<decltype(ptr)>(__builtin_assume_aligned((ptr), (alignment)))
+#else
+#define PHYSICS_ASSUME_ALIGNED(ptr, alignment) (ptr)
+#endif
+
+namespace physics {
+
+// allocator returning memory aligned to (at least) Alignment bytes
+template <class T, std::size_t Alignment = PHYSICS_SIMD_ALIGNMENT>
+struct aligned_allocator {
+  static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0,
+                "Alignment must be a power of 2 and at least alignof(T).");
+  using value_type = T;
+  template <class U> struct rebind {
+    using other = aligned_allocator<U, Alignment>;
+  };
+
+  aligned_allocator() = default;
+  template <class U>
+  constexpr aligned_allocator(const aligned_allocator<U, Alignment>&) {}
+
+  T* allocate(std::size_t n) {
+    // n * sizeof(T) must not wrap around to a small buffer
+    if (n > static_cast<std::size_t>(-1) / sizeof(T)) {
+      throw std::bad_array_new_length{};
+    }
+    void* ptr{nullptr};
+    if (posix_memalign(&ptr, Alignment, n * sizeof(T)) != 0) {
+      throw std::bad_alloc{};
+    }
+    return static_cast<T*>(ptr);
+  }
+  void deallocate(T* ptr, std::size_t) { std::free(ptr); }
+};
+template <class T, class U, std::size_t Alignment>
+constexpr bool operator==(const aligned_allocator<T, Alignment>&,
+                          const aligned_allocator<U, Alignment>&) {
+  return true;
+}
+template <class T, class U, std::size_t Alignment>
+constexpr bool operator!=(const aligned_allocator<T, Alignment>&,
+                          const aligned_allocator<U, Alignment>&) {
+  return false;
+}
+
+// std::vector with an aligned data buffer
+template <class T, std::size_t Alignment = PHYSICS_SIMD_ALIGNMENT>
+using aligned_vector = std::vector<T, aligned_allocator<T, Alignment>>;
+
+} // namespace physics
+
+#endif
@@ -2,6 +2,9 @@
 
 #include <physics/util/logger.hh>
 
+#include <algorithm>
+#include <cstdlib>
+
 using namespace physics;
 
 using boost::property_tree::ptree_bad_path;
@@ -40,7 +43,7 @@ void configuration::load(const ptree& in_conf) {
       LOG_INFO(settings_path_, "No default settings provided for this board.");
     }
   } catch (ptree_bad_path& e) {
-    throw path_error(e.path<std::string>());
+    throw path_error(e.path<ptree::path_type>().dump());
   } catch (ptree_error& e) {
     // shouldn't happen
     throw configuration_error("Processing error", e.what());
@@ -105,3 +108,261 @@ configuration_translation_error::configuration_translation_error(
                               "' for key '" + key + "' (in '" + settings_path +
                               "' or '" + defaults_path + "')",
                           "configuration_translation_error"} {}
+
+////////////////////////////////////////////////////////////////////////////////
+// class configuration_snapshot
+////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<const configuration_snapshot> configuration::freeze() const {
+  return std::make_shared<const configuration_snapshot>(
+      settings_, defaults_, settings_path_, defaults_path_, module_key_);
+}
+
+namespace {
+constexpr unsigned from_settings{1};
+constexpr unsigned from_defaults{2};
+} // namespace
+
+configuration_snapshot::configuration_snapshot(
+    const ptree& settings, const ptree& defaults,
+    const std::string& settings_path, const std::string& defaults_path,
+    const std::string& module_key)
+    : settings_path_{settings_path}
+    , defaults_path_{defaults_path}
+    , module_key_{module_key} {
+  auto numbers = std::make_shared<std::vector<double>>();
+  insert(settings, "", from_settings, *numbers);
+  insert(defaults, "", from_defaults, *numbers);
+  numbers_ = numbers;
+  convert_all();
+}
+// the settings at the identifier, and the defaults of the module (as
+// configuration::load)
+configuration_snapshot::configuration_snapshot(const json_document& document,
+                                               const std::string& identifier,
+                                               const std::string& defaults_path,
+                                               const std::string& module_key)
+    : numbers_{document.number_storage()}
+    , settings_path_{identifier}
+    , defaults_path_{defaults_path}
+    , module_key_{module_key} {
+  if (!document.find(identifier)) {
+    throw configuration_path_error{identifier};
+  }
+  const auto* module = document.find(identifier + "." + module_key_);
+  if (!module || module->array) {
+    throw configuration_error("module descriptor '" + module_key_ +
+                              "' has to be set in " + settings_path_);
+  }
+  defaults_path_ += "." + module->text.to_string();
+  insert(document, settings_path_, from_settings);
+  insert(document, defaults_path_, from_defaults);
+  convert_all();
+}
+void configuration_snapshot::convert_all() {
+  for (auto& el : entries_) {
+    configuration_impl::convert_all(el.second.texts, el.second.values);
+  }
+}
+// add all nodes of the tree, with their full key
+void configuration_snapshot::insert(const ptree& tree,
+                                    const std::string& prefix,
+                                    unsigned source,
+                                    std::vector<double>& numbers) {
+  for (const auto& child : tree) {
+    // (children without a key are vector elements, and a key that appears
+    // twice can only be looked up in its first node)
+    if (child.first.empty()) {
+      continue;
+    }
+    const std::string key{prefix.empty() ? child.first
+                                         : prefix + "." + child.first};
+    entry& e = entries_[key];
+    if (e.sources & source) {
+      continue;
+    }
+    e.texts.push_back(child.second.data());
+    if (e.sources == 0) {
+      for (const auto& element : child.second) {
+        e.elements.push_back(element.second.data());
+      }
+      // arrays of numbers are also stored as numbers, for get_numbers()
+      const std::size_t first{numbers.size()};
+      e.numeric = !child.second.empty();
+      // (the same numbers as for a json_document, strtod also accepts
+      // e.g. nan, hex and leading spaces)
+      for (const auto& element : child.second) {
+        const std::string& text{element.second.data()};
+        if (!element.first.empty() || !element.second.empty() ||
+            !is_json_number(text)) {
+          e.numeric = false;
+          break;
+        }
+        numbers.push_back(std::strtod(text.c_str(), nullptr));
+      }
+      if (e.numeric) {
+        e.first = first;
+        e.count = numbers.size() - first;
+      } else {
+        numbers.resize(first);
+      }
+    }
+    e.sources |= source;
+    insert(child.second, key, source, numbers);
+  }
+}
+// add the nodes of the document below the prefix
+void configuration_snapshot::insert(const json_document& document,
+                                    const std::string& prefix,
+                                    unsigned source) {
+  for (const auto& node : document.nodes()) {
+    if (node.key.size() <= prefix.size() + 1 ||
+        node.key.compare(0, prefix.size(), prefix) != 0 ||
+        node.key[prefix.size()] != '.') {
+      continue;
+    }
+    entry& e = entries_[node.key.substr(prefix.size() + 1).to_string()];
+    if (e.sources & source) {
+      continue;
+    }
+    e.texts.push_back(node.text.to_string());
+    if (e.sources == 0) {
+      for (const auto& element : document.elements(node)) {
+        e.elements.push_back(element.to_string());
+      }
+      if (node.numeric) {
+        e.numeric = true;
+        e.first = node.first;
+        e.count = node.size;
+      }
+    }
+    e.sources |= source;
+  }
+}
+span<const double>
+configuration_snapshot::get_numbers(const std::string& key) const {
+  const entry* e{find(key)};
+  if (!e) {
+    throw configuration_key_error{key, settings_path_, defaults_path_};
+  }
+  if (!e->numeric) {
+    // (arrays have no text of their own, their elements are shown instead)
+    std::string text{e->texts.front()};
+    if (text.empty() && !e->elements.empty()) {
+      text = "[";
+      for (const auto& element : e->elements) {
+        text += (text.size() > 1 ? ", " : "") + element;
+      }
+      text += "]";
+    }
+    throw configuration_translation_error{key, text, settings_path_,
+                                          defaults_path_};
+  }
+  return {numbers_->data() + e->first, e->count};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class configuration_holder
+////////////////////////////////////////////////////////////////////////////////
+configuration_holder::configuration_holder(const std::string& identifier,
+                                           const ptree& settings,
+                                           const std::string& defaults_path,
+                                           const std::string& module_key)
+    : identifier_{identifier}
+    , defaults_path_{defaults_path}
+    , module_key_{module_key}
+    , current_{nullptr}
+    , version_{0} {
+  reload(settings);
+}
+// reload
+void configuration_holder::reload(const ptree& settings) {
+  configuration conf{identifier_, settings, defaults_path_, module_key_};
+  publish(conf.freeze());
+}
+// (read with the streaming reader, without a ptree)
+void configuration_holder::reload(std::istream& json) {
+  std::shared_ptr<const configuration_snapshot> snapshot;
+  try {
+    const json_document document{json};
+    snapshot = std::make_shared<const configuration_snapshot>(
+        document, identifier_, defaults_path_, module_key_);
+  } catch (json_error& e) {
+    throw configuration_error(std::string{"Invalid JSON settings: "} +
+                              e.what());
+  }
+  publish(snapshot);
+}
+// publish a new snapshot, and release the snapshots that are no longer used
+void configuration_holder::publish(
+    std::shared_ptr<const configuration_snapshot> snapshot) {
+  if (!snapshot) {
+    throw configuration_error("Cannot publish an empty configuration snapshot");
+  }
+  std::lock_guard<std::mutex> lock{mutex_};
+  const std::uint64_t version{version_.load() + 1};
+  nodes_.emplace_back(new node{std::move(snapshot), version});
+  current_.store(nodes_.back().get());
+  version_.store(version);
+  const std::size_t kept{reclaim_locked()};
+  LOG_INFO(identifier_, "Configuration version " + std::to_string(version) +
+                            " published (" + std::to_string(kept) +
+                            " snapshots kept)");
+}
+std::size_t configuration_holder::reclaim() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return reclaim_locked();
+}
+// a reader announces its node in its hazard before it uses the node (and
+// checks that it is still current), so a replaced node that is not in any
+// hazard can not be used anymore
+std::size_t configuration_holder::reclaim_locked() {
+  const node* current{current_.load()};
+  const auto unused = [&](const std::unique_ptr<node>& n) {
+    if (n.get() == current) {
+      return false;
+    }
+    for (const auto& h : hazards_) {
+      if (h->load() == n.get()) {
+        return false;
+      }
+    }
+    return true;
+  };
+  nodes_.erase(std::remove_if(nodes_.begin(), nodes_.end(), unused),
+               nodes_.end());
+  return nodes_.size();
+}
+std::shared_ptr<const configuration_snapshot>
+configuration_holder::snapshot() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return current_.load()->snapshot;
+}
+
+// reader
+configuration_holder::reader::reader(configuration_holder& holder)
+    : holder_{holder} {
+  std::lock_guard<std::mutex> lock{holder_.mutex_};
+  node_ = holder_.current_.load();
+  holder_.hazards_.emplace_back(new hazard{node_});
+  hazard_ = holder_.hazards_.back().get();
+}
+configuration_holder::reader::~reader() {
+  std::lock_guard<std::mutex> lock{holder_.mutex_};
+  auto& hazards = holder_.hazards_;
+  hazards.erase(std::find_if(hazards.begin(), hazards.end(),
+                             [this](const std::unique_ptr<hazard>& h) {
+                               return h.get() == hazard_;
+                             }));
+}
+void configuration_holder::reader::refresh() {
+  const node* current{holder_.current_.load()};
+  for (;;) {
+    hazard_->store(current);
+    const node* check{holder_.current_.load()};
+    if (check == current) {
+      break;
+    }
+    current = check;
+  }
+  node_ = current;
+}
@@ -1,11 +1,26 @@
 #ifndef PHYSICS_UTIL_CONFIGURATION_LOADED
 #define PHYSICS_UTIL_CONFIGURATION_LOADED
 
+#include <physics/unit/io.hh>
 #include <physics/util/exception.hh>
+#include <physics/util/json.hh>
+#include <physics/util/span.hh>
 #include <physics/util/stringify.hh>
 
-#include <string>
+#include <limits>
+#include <atomic>
+#include <cstdint>
+#include <istream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
@@ -28,6 +43,8 @@ class configuration_path_error;
 class configuration_key_error;
 class configuration_value_error;
 class configuration_translation_error;
+class configuration_snapshot;
+class configuration_holder;
 
 // configuration handler
 //
@@ -50,12 +67,21 @@ public:
   // get the module info
   std::string module() const { return get<std::string>(module_key_); }
 
+  // immutable snapshot of the current settings and defaults, for fast
+  // lookups (see configuration_snapshot)
+  std::shared_ptr<const configuration_snapshot> freeze() const;
+
   // Three pairs of functions to get a setting by its key.
   //
   // In each pair, the translation_map version will lookup the
   // configuration value in the map, and throw a
   // configuration_translation_error if the lookup failed.
   //
+  // physics::quantity settings are parsed with their unit name ("5 GeV", see
+  // physics::parse_quantity) and converted to the unit of the quantity, an
+  // unknown name or a unit of other dimensions throws a
+  // configuration_translation_error.
+  //
   // 1. optional version
   template <class T> optional<T> get_optional(const std::string& key) const;
   template <class T>
@@ -137,8 +163,281 @@ private:
   ptree defaults_;
   const std::string module_key_;
 };
+
+// handle to a setting in a configuration_snapshot, obtained once with
+// configuration_snapshot::handle(), reading it is a pointer dereference.
+// The handle is valid as long as the snapshot.
+template <class T> class configuration_handle {
+public:
+  const T& get() const { return *value_; }
+  const T& operator*() const { return *value_; }
+  const T* operator->() const { return value_; }
+
+private:
+  friend class configuration_snapshot;
+  explicit configuration_handle(const T* value) : value_{value} {}
+  const T* value_;
+};
+
+namespace configuration_impl {
+// setting types that are converted when freezing a configuration
+template <class... T> struct type_list {};
+using frozen_types =
+    type_list<std::string, bool, int, unsigned, long, unsigned long,
+              long long, unsigned long long, float, double>;
+template <class T, class List> struct is_frozen : std::false_type {};
+template <class T, class... U>
+struct is_frozen<T, type_list<T, U...>> : std::true_type {};
+template <class T, class V, class... U>
+struct is_frozen<T, type_list<V, U...>> : is_frozen<T, type_list<U...>> {};
+template <class List> struct frozen_values;
+template <class... T> struct frozen_values<type_list<T...>> {
+  using type = std::tuple<optional<T>...>;
+};
+} // namespace configuration_impl
+
+namespace configuration_impl {
+// ptree translator for physics::quantity settings, with the unit name
+template <class Quantity> struct quantity_translator {
+  using internal_type = std::string;
+  using external_type = Quantity;
+  optional<Quantity> get_value(const std::string& text) const {
+    Quantity q;
+    try {
+      if (!parse_quantity(text, q)) {
+        return {};
+      }
+    } catch (const unit_name_error& e) {
+      throw boost::property_tree::ptree_bad_data{e.what(), text};
+    }
+    return q;
+  }
+  optional<std::string> put_value(const Quantity& q) const {
+    std::ostringstream os;
+    os.precision(std::numeric_limits<decltype(q.value())>::max_digits10);
+    os << q.value();
+    const std::string name{
+        unit_impl::registered_unit_name<typename Quantity::unit>()};
+    if (!name.empty()) {
+      os << " " << name;
+    }
+    return os.str();
+  }
+};
+} // namespace configuration_impl
+
+// configuration_snapshot: immutable copy of the settings and defaults of a
+// configuration, created with configuration::freeze()
+//
+// Notes:
+//  * All settings are stored in a hash map by their full (dotted) key, a key
+//    in the settings hides the same key in the defaults (as for
+//    configuration::get).
+//  * The values are converted to the types in configuration_impl::frozen_types
+//    when freezing, get<T>() for these types is a hash lookup. Other types are
+//    converted on every call.
+//  * handle<T>(key) converts the value once, the handle then reads it without
+//    a lookup. Handles to the same key and type share the value, e.g. a
+//    handle to a physics::quantity holds the value in its own unit.
+//  * The getters throw the same exceptions as the configuration getters.
+//  * A snapshot can also be created from a json_document, without a ptree,
+//    with the settings at the identifier and the defaults of the module (as
+//    for the configuration constructor). get_numbers(key) returns the
+//    elements of an array of numbers without a conversion, the arrays of a
+//    json_document are shared with the snapshot.
+//  * A snapshot is not modified after its creation (except for the values of
+//    new handles, under a mutex), and can be shared between threads.
+class configuration_snapshot {
+public:
+  configuration_snapshot(const ptree& settings, const ptree& defaults,
+                         const std::string& settings_path,
+                         const std::string& defaults_path,
+                         const std::string& module_key);
+  configuration_snapshot(const json_document& document,
+                         const std::string& identifier,
+                         const std::string& defaults_path = "defaults",
+                         const std::string& module_key = "module");
+
+  std::size_t size() const { return entries_.size(); }
+  bool contains(const std::string& key) const {
+    return entries_.count(key) > 0;
+  }
+  std::string module() const { return get<std::string>(module_key_); }
+
+  // getters, as for configuration
+  template <class T> optional<T> get_optional(const std::string& key) const;
+  template <class T> T get(const std::string& key) const;
+  template <class T>
+  T get(const std::string& key, const translation_map<T>& tr) const;
+  // (the default value is not stored, the snapshot is immutable)
+  template <class T, class = typename std::enable_if<!is_map<T>::value>::type>
+  T get(const std::string& key, const T& default_value) const;
+  template <class T>
+  optional<std::vector<T>> get_optional_vector(const std::string& key) const;
+  template <class T> std::vector<T> get_vector(const std::string& key) const;
+  // an array of numbers (valid as long as the snapshot), throws a
+  // configuration_translation_error for other values
+  span<const double> get_numbers(const std::string& key) const;
+
+  // handles, throw if the key does not exist
+  template <class T>
+  configuration_handle<T> handle(const std::string& key) const;
+  template <class T>
+  configuration_handle<T> handle(const std::string& key,
+                                 const translation_map<T>& tr) const;
+  template <class T>
+  configuration_handle<std::vector<T>>
+  vector_handle(const std::string& key) const;
+
+private:
+  struct entry {
+    // the value in the settings and/or the defaults (in this order), and the
+    // values of the children of the first one (for the vector getters)
+    std::vector<std::string> texts;
+    std::vector<std::string> elements;
+    unsigned sources{0};
+    // an array of numbers, in numbers_
+    bool numeric{false};
+    std::size_t first{0};
+    std::size_t count{0};
+    // the first value that converts, for every frozen type
+    configuration_impl::frozen_values<configuration_impl::frozen_types>::type
+        values;
+  };
+
+  void insert(const ptree& tree, const std::string& prefix, unsigned source,
+              std::vector<double>& numbers);
+  void insert(const json_document& document, const std::string& prefix,
+              unsigned source);
+  void convert_all();
+  const entry* find(const std::string& key) const;
+  template <class T>
+  static const optional<T>& convert(const entry& e,
+                                    std::true_type /* frozen */);
+  template <class T>
+  static optional<T> convert(const entry& e, std::false_type /* frozen */);
+  template <class T>
+  const T* handle_value(const std::string& key,
+                        std::true_type /* frozen */) const;
+  template <class T>
+  const T* handle_value(const std::string& key,
+                        std::false_type /* frozen */) const;
+  // store the value of a handle: shared by key and type, or (for translated
+  // values) separately for every handle
+  template <class T> const T* store(const std::string& key, T value) const;
+  template <class T> const T* store(T value) const;
+
+  std::unordered_map<std::string, entry> entries_;
+  std::shared_ptr<const std::vector<double>> numbers_;
+  std::string settings_path_;
+  std::string defaults_path_;
+  std::string module_key_;
+  mutable std::mutex mutex_;
+  mutable std::map<std::pair<std::string, std::type_index>,
+                   std::shared_ptr<const void>>
+      handles_;
+  mutable std::vector<std::shared_ptr<const void>> translated_;
+};
+
+// configuration_holder: the current configuration_snapshot of a
+// configuration that is reloaded while other threads read it
+// (read-copy-update)
+//
+// Notes:
+//  * reload() builds a new snapshot from the settings (as the configuration
+//    constructor), and publishes it with an atomic pointer store. A reload
+//    that fails (e.g. invalid JSON, or no settings for the identifier) throws
+//    and keeps the current snapshot.
+//  * Worker threads read through a configuration_holder::reader of their own.
+//    reader.get() returns the current snapshot with an atomic pointer load,
+//    and never takes a lock. This snapshot stays valid until the next get()
+//    of the same reader, handles to it should be obtained again when
+//    reader.version() changes.
+//  * Replaced snapshots are kept while a reader may still use them, and are
+//    released by a later publish() or by reclaim().
+//  * Readers are created and destroyed under the mutex of the holder, as are
+//    reload(), publish() and snapshot(). The holder has to outlive its
+//    readers.
+class configuration_holder {
+public:
+  class reader;
+
+  configuration_holder(const std::string& identifier, const ptree& settings,
+                       const std::string& defaults_path = "defaults",
+                       const std::string& module_key = "module");
+  configuration_holder(const configuration_holder&) = delete;
+  configuration_holder& operator=(const configuration_holder&) = delete;
+
+  // build a new snapshot from the settings (or from JSON) and publish it
+  void reload(const ptree& settings);
+  void reload(std::istream& json);
+  void publish(std::shared_ptr<const configuration_snapshot> snapshot);
+  // release the replaced snapshots that are not used by a reader, returns
+  // the number of snapshots still kept (including the current one)
+  std::size_t reclaim();
+
+  // the current snapshot (takes the lock, use a reader in hot code)
+  std::shared_ptr<const configuration_snapshot> snapshot() const;
+  // the number of published snapshots
+  std::uint64_t version() const { return version_.load(); }
+
+private:
+  struct node {
+    std::shared_ptr<const configuration_snapshot> snapshot;
+    std::uint64_t version;
+  };
+  // the node that a reader uses
+  using hazard = std::atomic<const node*>;
+
+  std::size_t reclaim_locked();
+
+  const std::string identifier_;
+  const std::string defaults_path_;
+  const std::string module_key_;
+  std::atomic<const node*> current_;
+  std::atomic<std::uint64_t> version_;
+  mutable std::mutex mutex_;
+  // the current node and the replaced nodes that are still kept
+  std::vector<std::unique_ptr<node>> nodes_;
+  std::vector<std::unique_ptr<hazard>> hazards_;
+};
+
+class configuration_holder::reader {
+public:
+  explicit reader(configuration_holder& holder);
+  ~reader();
+  reader(const reader&) = delete;
+  reader& operator=(const reader&) = delete;
+
+  // the current snapshot
+  const configuration_snapshot& get() {
+    if (holder_.current_.load(std::memory_order_acquire) != node_) {
+      refresh();
+    }
+    return *node_->snapshot;
+  }
+  // the version of the snapshot returned by the last get()
+  std::uint64_t version() const { return node_->version; }
+
+private:
+  void refresh();
+
+  configuration_holder& holder_;
+  hazard* hazard_;
+  const node* node_;
+};
 }
 
+namespace boost {
+namespace property_tree {
+template <class Unit, class Rep>
+struct translator_between<std::string, physics::quantity<Unit, Rep>> {
+  using type = physics::configuration_impl::quantity_translator<
+      physics::quantity<Unit, Rep>>;
+};
+} // namespace property_tree
+} // namespace boost
+
 //////////////////////////////////////////////////////////////////////////////////////////
 // Implementation
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -244,9 +543,13 @@ configuration::get_optional_vector(const std::string& key) const {
   if (node) {
     vec.reset(std::vector<T>());
     for (const auto& child : *node) {
-      auto val = child.second.get_value_optional<T>();
-      if (val) {
-        vec->push_back(*val);
+      try {
+        auto val = child.second.get_value_optional<T>();
+        if (val) {
+          vec->push_back(*val);
+        }
+      } catch (boost::property_tree::ptree_bad_data& e) {
+        throw translation_error(key, e.data<std::string>());
       }
     }
   }
@@ -335,8 +638,9 @@ configuration::get_optional_range(const std::string& key) const
 {
   auto range = get_optional_vector<T>(key);
   if (range) {
+    // (the error shows the text, T need not be streamable)
     if(range->size() != 2) {
-      throw translation_error(key, stringify(*range));
+      throw translation_error(key, stringify(get_vector<std::string>(key)));
     }
     return {{(*range)[0], (*range)[1]}};
   }
@@ -409,6 +713,187 @@ configuration_translation_error::configuration_translation_error(
               }) +
               "')",
           "configuration_translation_error") {}
+
+// configuration_snapshot
+namespace configuration_impl {
+// the first of the texts that converts to T (as ptree::get_optional)
+template <class T>
+void convert(const std::vector<std::string>& texts, optional<T>& value) {
+  using translator =
+      typename boost::property_tree::translator_between<std::string, T>::type;
+  for (const auto& text : texts) {
+    value = translator{}.get_value(text);
+    if (value) {
+      return;
+    }
+  }
+}
+// numbers of arrays, as their text
+inline void convert_number(double number, optional<double>& value) {
+  value = number;
+}
+inline void convert_number(double number, optional<float>& value) {
+  value = static_cast<float>(number);
+}
+template <class T> void convert_number(double number, optional<T>& value) {
+  convert({json_number_text(number)}, value);
+}
+template <class... T>
+void convert_all(const std::vector<std::string>& texts,
+                 std::tuple<optional<T>...>& values) {
+  (void)std::initializer_list<int>{
+      (convert(texts, std::get<optional<T>>(values)), 0)...};
+}
+} // namespace configuration_impl
+
+inline const configuration_snapshot::entry*
+configuration_snapshot::find(const std::string& key) const {
+  const auto it = entries_.find(key);
+  return it == entries_.end() ? nullptr : &it->second;
+}
+template <class T>
+const optional<T>& configuration_snapshot::convert(const entry& e,
+                                                   std::true_type) {
+  return std::get<optional<T>>(e.values);
+}
+template <class T>
+optional<T> configuration_snapshot::convert(const entry& e, std::false_type) {
+  optional<T> value;
+  configuration_impl::convert(e.texts, value);
+  return value;
+}
+template <class T>
+optional<T> configuration_snapshot::get_optional(const std::string& key) const {
+  const entry* e{find(key)};
+  if (!e) {
+    return {};
+  }
+  try {
+    return convert<T>(*e, configuration_impl::is_frozen<
+                              T, configuration_impl::frozen_types>{});
+  } catch (boost::property_tree::ptree_bad_data& bad) {
+    throw configuration_translation_error{key, bad.data<std::string>(),
+                                          settings_path_, defaults_path_};
+  }
+}
+template <class T>
+T configuration_snapshot::get(const std::string& key) const {
+  auto s = get_optional<T>(key);
+  if (!s) {
+    throw configuration_key_error{key, settings_path_, defaults_path_};
+  }
+  return *s;
+}
+template <class T>
+T configuration_snapshot::get(const std::string& key,
+                              const translation_map<T>& tr) const {
+  const std::string val{get<std::string>(key)};
+  const auto it = tr.find(val);
+  if (it == tr.end()) {
+    throw configuration_translation_error{key, val, tr, settings_path_,
+                                          defaults_path_};
+  }
+  return it->second;
+}
+template <class T, class>
+T configuration_snapshot::get(const std::string& key,
+                              const T& default_value) const {
+  auto s = get_optional<T>(key);
+  return s ? *s : default_value;
+}
+template <class T>
+optional<std::vector<T>>
+configuration_snapshot::get_optional_vector(const std::string& key) const {
+  const entry* e{find(key)};
+  if (!e) {
+    return {};
+  }
+  std::vector<T> vec;
+  // (arrays of numbers of a json_document have no text elements)
+  if (e->numeric && e->elements.empty()) {
+    for (std::size_t i = 0; i < e->count; ++i) {
+      optional<T> val;
+      try {
+        configuration_impl::convert_number((*numbers_)[e->first + i], val);
+      } catch (boost::property_tree::ptree_bad_data& bad) {
+        throw configuration_translation_error{key, bad.data<std::string>(),
+                                              settings_path_, defaults_path_};
+      }
+      if (val) {
+        vec.push_back(*val);
+      }
+    }
+    return vec;
+  }
+  for (const auto& element : e->elements) {
+    optional<T> val;
+    try {
+      configuration_impl::convert({element}, val);
+    } catch (boost::property_tree::ptree_bad_data& bad) {
+      throw configuration_translation_error{key, bad.data<std::string>(),
+                                            settings_path_, defaults_path_};
+    }
+    if (val) {
+      vec.push_back(*val);
+    }
+  }
+  return vec;
+}
+template <class T>
+std::vector<T> configuration_snapshot::get_vector(const std::string& key) const {
+  auto s = get_optional_vector<T>(key);
+  if (!s) {
+    throw configuration_key_error{key, settings_path_, defaults_path_};
+  }
+  return *s;
+}
+
+template <class T>
+configuration_handle<T>
+configuration_snapshot::handle(const std::string& key) const {
+  return configuration_handle<T>{handle_value<T>(
+      key, configuration_impl::is_frozen<T, configuration_impl::frozen_types>{})};
+}
+// frozen values are read from the entry directly
+template <class T>
+const T* configuration_snapshot::handle_value(const std::string& key,
+                                              std::true_type) const {
+  const entry* e{find(key)};
+  if (!e || !std::get<optional<T>>(e->values)) {
+    throw configuration_key_error{key, settings_path_, defaults_path_};
+  }
+  return &*std::get<optional<T>>(e->values);
+}
+template <class T>
+const T* configuration_snapshot::handle_value(const std::string& key,
+                                              std::false_type) const {
+  return store(key, get<T>(key));
+}
+template <class T>
+configuration_handle<T>
+configuration_snapshot::handle(const std::string& key,
+                               const translation_map<T>& tr) const {
+  return configuration_handle<T>{store(get(key, tr))};
+}
+template <class T>
+configuration_handle<std::vector<T>>
+configuration_snapshot::vector_handle(const std::string& key) const {
+  return configuration_handle<std::vector<T>>{store(key, get_vector<T>(key))};
+}
+template <class T>
+const T* configuration_snapshot::store(const std::string& key, T value) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto& stored = handles_[{key, std::type_index{typeid(T)}}];
+  if (!stored) {
+    stored = std::make_shared<const T>(std::move(value));
+  }
+  return static_cast<const T*>(stored.get());
+}
+template <class T> const T* configuration_snapshot::store(T value) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  translated_.push_back(std::make_shared<const T>(std::move(value)));
+  return static_cast<const T*>(translated_.back().get());
+}
 }
 
 #endif
@@ -0,0 +1,245 @@
+#include "configuration_watcher.hh"
+
+#include <physics/util/logger.hh>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace physics;
+
+////////////////////////////////////////////////////////////////////////////////
+// configuration_diff
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+std::string join(const std::string& prefix, const std::string& key) {
+  return prefix.empty() ? key : prefix + "." + key;
+}
+bool has_array(const ptree& tree) {
+  return std::any_of(tree.begin(), tree.end(),
+                     [](const ptree::value_type& child) {
+                       return child.first.empty();
+                     });
+}
+// (a key that appears twice is only compared in its first node, as it can
+// only be looked up there)
+void diff(const ptree& before, const ptree& after, const std::string& key,
+          std::vector<std::string>& keys) {
+  if (before.data() != after.data()) {
+    keys.push_back(key);
+    return;
+  }
+  if (has_array(before) || has_array(after)) {
+    if (before != after) {
+      keys.push_back(key);
+    }
+    return;
+  }
+  for (auto it = before.begin(); it != before.end(); ++it) {
+    if (&before.find(it->first)->second != &it->second) {
+      continue;
+    }
+    const auto other = after.find(it->first);
+    if (other == after.not_found()) {
+      keys.push_back(join(key, it->first));
+    } else {
+      diff(it->second, other->second, join(key, it->first), keys);
+    }
+  }
+  for (const auto& child : after) {
+    if (before.find(child.first) == before.not_found()) {
+      keys.push_back(join(key, child.first));
+    }
+  }
+}
+// a change of key changes the subtree at prefix
+bool overlaps(const std::string& prefix, const std::string& key) {
+  const auto below = [](const std::string& a, const std::string& b) {
+    return a.size() > b.size() && a.compare(0, b.size(), b) == 0 &&
+           a[b.size()] == '.';
+  };
+  return prefix.empty() || key.empty() || key == prefix ||
+         below(key, prefix) || below(prefix, key);
+}
+} // namespace
+
+std::vector<std::string> physics::configuration_diff(const ptree& before,
+                                                     const ptree& after) {
+  std::vector<std::string> keys;
+  diff(before, after, "", keys);
+  // (the same key can be added more than once for duplicate keys)
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class configuration_watcher
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+ptree read_settings(const std::string& path) {
+  ptree tree;
+  try {
+    read_json(path, tree);
+  } catch (boost::property_tree::json_parser_error& e) {
+    throw configuration_error(std::string{"Unable to read settings: "} +
+                              e.what());
+  }
+  return tree;
+}
+} // namespace
+
+configuration_watcher::configuration_watcher(const std::string& path,
+                                             const std::string& identifier,
+                                             const std::string& defaults_path,
+                                             const std::string& module_key)
+    : configuration_watcher{read_settings(path), path, identifier,
+                            defaults_path, module_key} {}
+configuration_watcher::configuration_watcher(const ptree& tree,
+                                             const std::string& path,
+                                             const std::string& identifier,
+                                             const std::string& defaults_path,
+                                             const std::string& module_key)
+    : path_{path}
+    , identifier_{identifier}
+    , defaults_path_{defaults_path}
+    , module_key_{module_key}
+    , holder_{identifier, tree, defaults_path, module_key}
+    , fd_{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)} {
+  select(tree);
+  if (fd_ < 0) {
+    throw configuration_error("Unable to watch '" + path_ +
+                                  "': " + std::strerror(errno),
+                              "configuration_watch_error");
+  }
+  // watch the directory, to also see the file when it is replaced
+  const auto slash = path_.rfind('/');
+  const std::string dir{slash == std::string::npos
+                            ? "."
+                            : slash == 0 ? "/" : path_.substr(0, slash)};
+  name_ = slash == std::string::npos ? path_ : path_.substr(slash + 1);
+  if (inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    const int error{errno};
+    close(fd_);
+    throw configuration_error("Unable to watch '" + dir +
+                                  "': " + std::strerror(error),
+                              "configuration_watch_error");
+  }
+}
+configuration_watcher::~configuration_watcher() { close(fd_); }
+
+// subscriptions
+std::size_t configuration_watcher::subscribe(const std::string& prefix,
+                                             callback f) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  subscriptions_.push_back({next_id_, prefix, std::move(f)});
+  return next_id_++;
+}
+void configuration_watcher::unsubscribe(std::size_t id) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  subscriptions_.erase(
+      std::remove_if(subscriptions_.begin(), subscriptions_.end(),
+                     [id](const subscription& s) { return s.id == id; }),
+      subscriptions_.end());
+}
+
+// poll
+bool configuration_watcher::poll(std::chrono::milliseconds timeout) {
+  pollfd p{fd_, POLLIN, 0};
+  const int n{::poll(&p, 1, static_cast<int>(timeout.count()))};
+  if (n < 0 && errno != EINTR) {
+    throw configuration_error("Unable to watch '" + path_ +
+                                  "': " + std::strerror(errno),
+                              "configuration_watch_error");
+  }
+  if (n <= 0) {
+    return false;
+  }
+  // read all pending events, the file is reloaded once
+  bool changed{false};
+  alignas(inotify_event) char buffer[4096];
+  ssize_t size;
+  while ((size = read(fd_, buffer, sizeof buffer)) > 0) {
+    for (ssize_t i = 0; i < size;) {
+      const auto* event = reinterpret_cast<const inotify_event*>(buffer + i);
+      if (event->len > 0 && name_ == event->name) {
+        changed = true;
+      }
+      i += sizeof(inotify_event) + event->len;
+    }
+  }
+  return changed && reload();
+}
+
+// reload
+bool configuration_watcher::reload() {
+  ptree tree;
+  try {
+    read_json(path_, tree);
+  } catch (boost::property_tree::ptree_error& e) {
+    LOG_WARNING(identifier_, "Ignoring changed settings in '" + path_ +
+                                 "': " + e.what());
+    return false;
+  }
+  std::shared_ptr<const configuration_snapshot> snapshot;
+  try {
+    snapshot = configuration{identifier_, tree, defaults_path_, module_key_}
+                   .freeze();
+  } catch (physics::exception& e) {
+    LOG_WARNING(identifier_, "Ignoring changed settings in '" + path_ +
+                                 "': " + e.what());
+    return false;
+  }
+  const std::vector<std::string> keys{select(tree)};
+  if (keys.empty()) {
+    return false;
+  }
+  holder_.publish(snapshot);
+
+  // call the subscriptions with the keys that concern them (outside of the
+  // lock, so they can subscribe themselves)
+  std::vector<std::pair<callback, std::vector<std::string>>> calls;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (const auto& s : subscriptions_) {
+      std::vector<std::string> matched;
+      for (const auto& key : keys) {
+        if (overlaps(s.prefix, key)) {
+          matched.push_back(key);
+        }
+      }
+      if (!matched.empty()) {
+        calls.emplace_back(s.f, std::move(matched));
+      }
+    }
+  }
+  for (const auto& call : calls) {
+    call.first(*snapshot, call.second);
+  }
+  return true;
+}
+
+// the settings and the defaults of the module (as the configuration), this
+// is only called for trees that contain them
+std::vector<std::string> configuration_watcher::select(const ptree& tree) {
+  ptree settings{tree.get_child(identifier_)};
+  ptree defaults;
+  const auto def = tree.get_child_optional(
+      defaults_path_ + "." + settings.get<std::string>(module_key_));
+  if (def) {
+    defaults = *def;
+  }
+  std::vector<std::string> keys{configuration_diff(settings_, settings)};
+  for (const auto& key : configuration_diff(defaults_, defaults)) {
+    keys.push_back(key);
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  settings_.swap(settings);
+  defaults_.swap(defaults);
+  return keys;
+}
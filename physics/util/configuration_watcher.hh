@@ -0,0 +1,96 @@
+#ifndef PHYSICS_UTIL_CONFIGURATION_WATCHER_LOADED
+#define PHYSICS_UTIL_CONFIGURATION_WATCHER_LOADED
+
+#include <physics/util/configuration.hh>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace physics {
+
+// the keys of the nodes that differ between two trees (the full dotted keys
+// of changed, added and removed nodes, and of arrays with any change)
+std::vector<std::string> configuration_diff(const ptree& before,
+                                            const ptree& after);
+
+// configuration_watcher: a configuration_holder for the settings in a JSON
+// file, that is reloaded when the file changes (Linux inotify)
+//
+// Notes:
+//  * poll() waits for changes of the file (also when it is replaced by a
+//    rename, as most editors do), and reloads it. A file that does not parse,
+//    or does not contain the settings, is logged and ignored, the current
+//    snapshot stays. The constructor throws in this case.
+//  * A reload diffs the settings and the defaults of the module against the
+//    previous ones. Callbacks subscribed to a key prefix are only called when
+//    a key at, below or above the prefix changed, with these keys and the new
+//    snapshot. A change of a default that is hidden by a setting is reported
+//    as well.
+//  * Reading and diffing the file scales with its size, the callbacks (where
+//    the modules rebuild what they derived from the settings) only run for
+//    the parts that changed. A reload without changes publishes nothing.
+//  * poll() and reload() call the callbacks on the calling thread, fd() can
+//    be used to wait for changes in an existing event loop instead.
+class configuration_watcher {
+public:
+  using callback = std::function<void(const configuration_snapshot& snapshot,
+                                      const std::vector<std::string>& keys)>;
+
+  configuration_watcher(const std::string& path, const std::string& identifier,
+                        const std::string& defaults_path = "defaults",
+                        const std::string& module_key = "module");
+  ~configuration_watcher();
+  configuration_watcher(const configuration_watcher&) = delete;
+  configuration_watcher& operator=(const configuration_watcher&) = delete;
+
+  configuration_holder& holder() { return holder_; }
+  const std::string& path() const { return path_; }
+  // the inotify file descriptor, readable when the file may have changed
+  int fd() const { return fd_; }
+
+  // call f for changes at, below or above prefix ("" for all changes),
+  // returns an id for unsubscribe()
+  std::size_t subscribe(const std::string& prefix, callback f);
+  void unsubscribe(std::size_t id);
+
+  // wait up to timeout for a change of the file and reload it, true if a
+  // changed configuration was published
+  bool poll(std::chrono::milliseconds timeout = std::chrono::milliseconds{0});
+  // reload the file now
+  bool reload();
+
+private:
+  struct subscription {
+    std::size_t id;
+    std::string prefix;
+    callback f;
+  };
+
+  configuration_watcher(const ptree& tree, const std::string& path,
+                        const std::string& identifier,
+                        const std::string& defaults_path,
+                        const std::string& module_key);
+  // store the settings and defaults of the tree, returns the changed keys
+  std::vector<std::string> select(const ptree& tree);
+
+  const std::string path_;
+  const std::string identifier_;
+  const std::string defaults_path_;
+  const std::string module_key_;
+  // the settings and the defaults of the module, of the current snapshot
+  ptree settings_;
+  ptree defaults_;
+  configuration_holder holder_;
+  int fd_;
+  std::string name_;
+  std::mutex mutex_;
+  std::vector<subscription> subscriptions_;
+  std::size_t next_id_{0};
+};
+}
+
+#endif
@@ -0,0 +1,572 @@
+#include "json.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace physics;
+
+////////////////////////////////////////////////////////////////////////////////
+// parse_json
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+// deeper nesting is refused, instead of running out of stack
+constexpr std::size_t max_depth{512};
+
+class parser {
+public:
+  parser(std::istream& in, json_handler& handler)
+      : in_{in}, handler_{handler} {}
+
+  void parse() {
+    skip_space();
+    value(0);
+    skip_space();
+    if (peek() >= 0) {
+      error("unexpected text after the JSON value");
+    }
+  }
+
+private:
+  // the next character, or -1 at the end of the stream
+  int peek() {
+    return pos_ < end_ || fill() ? static_cast<unsigned char>(*pos_) : -1;
+  }
+  int get() {
+    const int c{peek()};
+    if (c >= 0) {
+      ++pos_;
+    }
+    return c;
+  }
+  bool fill() {
+    offset_ += end_ - buffer_;
+    in_.read(buffer_, sizeof buffer_);
+    pos_ = buffer_;
+    end_ = buffer_ + in_.gcount();
+    return pos_ < end_;
+  }
+  void skip_space() {
+    for (int c = peek(); c == ' ' || c == '\n' || c == '\r' || c == '\t';
+         c = peek()) {
+      ++pos_;
+    }
+  }
+  void expect(char c) {
+    if (get() != c) {
+      error(std::string{"expected '"} + c + "'");
+    }
+  }
+  [[noreturn]] void error(const std::string& msg) const {
+    throw json_error{"Invalid JSON: " + msg + " at offset " +
+                     std::to_string(offset_ + (pos_ - buffer_))};
+  }
+  boost::string_view text() const { return {text_.data(), text_.size()}; }
+
+  void value(std::size_t depth) {
+    if (depth > max_depth) {
+      error("too deeply nested");
+    }
+    const int c{peek()};
+    switch (c) {
+    case '{':
+      object(depth);
+      break;
+    case '[':
+      array(depth);
+      break;
+    case '"':
+      string();
+      handler_.string(text());
+      break;
+    case 't':
+      literal("true");
+      break;
+    case 'f':
+      literal("false");
+      break;
+    case 'n':
+      literal("null");
+      break;
+    default:
+      if (c == '-' || (c >= '0' && c <= '9')) {
+        number();
+      } else {
+        error(c < 0 ? "unexpected end" : "unexpected character");
+      }
+    }
+  }
+  void object(std::size_t depth) {
+    ++pos_;
+    handler_.begin_object();
+    skip_space();
+    if (peek() == '}') {
+      ++pos_;
+    } else {
+      for (;;) {
+        if (peek() != '"') {
+          error("expected a key");
+        }
+        string();
+        handler_.key(text());
+        skip_space();
+        expect(':');
+        skip_space();
+        value(depth + 1);
+        skip_space();
+        const int c{get()};
+        if (c == '}') {
+          break;
+        }
+        if (c != ',') {
+          error("expected ',' or '}'");
+        }
+        skip_space();
+      }
+    }
+    handler_.end_object();
+  }
+  void array(std::size_t depth) {
+    ++pos_;
+    handler_.begin_array();
+    skip_space();
+    if (peek() == ']') {
+      ++pos_;
+    } else {
+      for (;;) {
+        value(depth + 1);
+        skip_space();
+        const int c{get()};
+        if (c == ']') {
+          break;
+        }
+        if (c != ',') {
+          error("expected ',' or ']'");
+        }
+        skip_space();
+      }
+    }
+    handler_.end_array();
+  }
+  // read a string into text_
+  void string() {
+    ++pos_;
+    text_.clear();
+    for (;;) {
+      if (pos_ == end_ && !fill()) {
+        error("unterminated string");
+      }
+      // copy the characters up to the next quote or escape at once
+      const char* p{pos_};
+      while (p < end_ && *p != '"' && *p != '\\' &&
+             static_cast<unsigned char>(*p) >= 0x20) {
+        ++p;
+      }
+      text_.append(pos_, p);
+      pos_ = p;
+      if (pos_ == end_) {
+        continue;
+      }
+      const char c{*pos_++};
+      if (c == '"') {
+        return;
+      }
+      if (c != '\\') {
+        error("control character in string");
+      }
+      escape();
+    }
+  }
+  void escape() {
+    const int c{get()};
+    switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+      text_ += static_cast<char>(c);
+      break;
+    case 'b':
+      text_ += '\b';
+      break;
+    case 'f':
+      text_ += '\f';
+      break;
+    case 'n':
+      text_ += '\n';
+      break;
+    case 'r':
+      text_ += '\r';
+      break;
+    case 't':
+      text_ += '\t';
+      break;
+    case 'u': {
+      unsigned long code{hex4()};
+      if (code >= 0xD800 && code < 0xDC00) {
+        expect('\\');
+        expect('u');
+        const unsigned long low{hex4()};
+        if (low < 0xDC00 || low >= 0xE000) {
+          error("invalid surrogate pair");
+        }
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+      }
+      utf8(code);
+      break;
+    }
+    default:
+      error("invalid escape");
+    }
+  }
+  unsigned long hex4() {
+    unsigned long code{0};
+    for (int i = 0; i < 4; ++i) {
+      const int c{get()};
+      code <<= 4;
+      if (c >= '0' && c <= '9') {
+        code += c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        code += c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        code += c - 'A' + 10;
+      } else {
+        error("invalid \\u escape");
+      }
+    }
+    return code;
+  }
+  void utf8(unsigned long code) {
+    if (code < 0x80) {
+      text_ += static_cast<char>(code);
+    } else if (code < 0x800) {
+      text_ += static_cast<char>(0xC0 | (code >> 6));
+      text_ += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+      text_ += static_cast<char>(0xE0 | (code >> 12));
+      text_ += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      text_ += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+      text_ += static_cast<char>(0xF0 | (code >> 18));
+      text_ += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+      text_ += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      text_ += static_cast<char>(0x80 | (code & 0x3F));
+    }
+  }
+  void number() {
+    text_.clear();
+    for (int c = peek(); (c >= '0' && c <= '9') || c == '-' || c == '+' ||
+                         c == '.' || c == 'e' || c == 'E';
+         c = peek()) {
+      text_ += static_cast<char>(c);
+      ++pos_;
+    }
+    // strtod accepts more than JSON (01, 1., .5)
+    if (!is_json_number(text_)) {
+      error("invalid number '" + text_ + "'");
+    }
+    char* end{nullptr};
+    const double value{std::strtod(text_.c_str(), &end)};
+    if (end != text_.c_str() + text_.size()) {
+      error("invalid number '" + text_ + "'");
+    }
+    handler_.number(text(), value);
+  }
+  void literal(const char* word) {
+    for (const char* c = word; *c; ++c) {
+      if (get() != *c) {
+        error("invalid literal");
+      }
+    }
+    handler_.literal(word);
+  }
+
+  std::istream& in_;
+  json_handler& handler_;
+  char buffer_[1 << 16];
+  const char* pos_{buffer_};
+  const char* end_{buffer_};
+  std::size_t offset_{0};
+  // the current string or number
+  std::string text_;
+};
+} // namespace
+
+void physics::parse_json(std::istream& in, json_handler& handler) {
+  parser{in, handler}.parse();
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+bool physics::is_json_number(boost::string_view text) {
+  const auto digit = [&](std::size_t i) {
+    return i < text.size() && text[i] >= '0' && text[i] <= '9';
+  };
+  const auto is = [&](std::size_t i, char c) {
+    return i < text.size() && text[i] == c;
+  };
+  std::size_t i{is(0, '-') ? 1u : 0u};
+  if (is(i, '0')) {
+    ++i;
+  } else if (digit(i)) {
+    while (digit(i)) {
+      ++i;
+    }
+  } else {
+    return false;
+  }
+  if (is(i, '.')) {
+    if (!digit(++i)) {
+      return false;
+    }
+    while (digit(i)) {
+      ++i;
+    }
+  }
+  if (is(i, 'e') || is(i, 'E')) {
+    if (is(++i, '+') || is(i, '-')) {
+      ++i;
+    }
+    if (!digit(i)) {
+      return false;
+    }
+    while (digit(i)) {
+      ++i;
+    }
+  }
+  return i == text.size();
+}
+std::string physics::json_number_text(double value) {
+  char text[32];
+  for (int precision = 15; precision <= 17; ++precision) {
+    std::snprintf(text, sizeof text, "%.*g", precision, value);
+    if (std::strtod(text, nullptr) == value) {
+      break;
+    }
+  }
+  return text;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// string storage
+////////////////////////////////////////////////////////////////////////////////
+// FNV-1a
+std::size_t json_impl::string_view_hash::
+operator()(boost::string_view text) const {
+  std::uint64_t hash{0xcbf29ce484222325};
+  for (const char c : text) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+  }
+  return static_cast<std::size_t>(hash);
+}
+
+boost::string_view string_arena::store(boost::string_view text) {
+  if (used_ + text.size() > block_size_ || blocks_.empty()) {
+    // blocks grow up to 1 MB, longer strings get a block of their own
+    const std::size_t grown{block_size_ == 0
+                                ? std::size_t{4096}
+                                : std::min(2 * block_size_,
+                                           std::size_t{1} << 20)};
+    block_size_ = std::max(grown, text.size());
+    blocks_.emplace_back(new char[block_size_]);
+    used_ = 0;
+  }
+  char* data{blocks_.back().get() + used_};
+  std::copy(text.begin(), text.end(), data);
+  used_ += text.size();
+  return {data, text.size()};
+}
+
+boost::string_view string_interner::intern(boost::string_view text) {
+  const auto it = strings_.find(text);
+  if (it != strings_.end()) {
+    return *it;
+  }
+  const boost::string_view stored{arena_.store(text)};
+  strings_.insert(stored);
+  return stored;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class json_document
+////////////////////////////////////////////////////////////////////////////////
+// builds the nodes of a document from the parser callbacks
+class json_document::builder : public json_handler {
+public:
+  explicit builder(json_document& doc) : doc_{doc} {}
+
+  void begin_object() override {
+    if (!element()) {
+      open(false);
+    }
+  }
+  void end_object() override { close(); }
+  void begin_array() override {
+    if (!element()) {
+      open(true);
+    }
+  }
+  void end_array() override { close(); }
+  void key(boost::string_view key) override {
+    key_.assign(key.data(), key.size());
+  }
+  void string(boost::string_view value) override { scalar(value); }
+  void number(boost::string_view text, double value) override {
+    if (skip_ > 0 || !in_array() || !array_node().numeric) {
+      scalar(text);
+      return;
+    }
+    node& n = array_node();
+    if (!n.texts && !exact_number(text, value)) {
+      keep_texts(n);
+    }
+    doc_.numbers_->push_back(value);
+    if (n.texts) {
+      doc_.elements_.push_back(doc_.texts_.store(text));
+    }
+  }
+  void literal(boost::string_view text) override { scalar(text); }
+
+private:
+  static constexpr std::size_t no_node{static_cast<std::size_t>(-1)};
+  struct frame {
+    std::size_t path_size;
+    std::size_t node;
+    bool array;
+  };
+
+  // true if the number reads back as its text from the double (otherwise
+  // the array also keeps the text of its elements)
+  static bool exact_number(boost::string_view text, double value) {
+    const std::size_t sign{!text.empty() && text[0] == '-' ? 1u : 0u};
+    const bool integer{text.find_first_of(".eE") == boost::string_view::npos};
+    // (up to 15 digits are exact, and the shortest text)
+    if (integer && text.size() - sign <= 15) {
+      return true;
+    }
+    // larger integers are kept as text, for conversions to 64-bit integers
+    if (integer && std::fabs(value) > 9007199254740992.) {
+      return false;
+    }
+    return text == json_number_text(value);
+  }
+  bool in_array() const { return !frames_.empty() && frames_.back().array; }
+  node& array_node() { return doc_.nodes_[frames_.back().node]; }
+
+  // objects and arrays in arrays are an empty element, their contents are
+  // skipped
+  bool element() {
+    if (skip_ == 0 && in_array()) {
+      add_element({});
+    } else if (skip_ == 0) {
+      return false;
+    }
+    ++skip_;
+    return true;
+  }
+  void open(bool array) {
+    frame f{path_.size(), no_node, array};
+    if (!frames_.empty() || array) {
+      enter();
+      f.node = add_node({});
+      if (array) {
+        node& n = doc_.nodes_[f.node];
+        n.array = true;
+        n.numeric = true;
+        n.first = doc_.numbers_->size();
+      }
+    }
+    frames_.push_back(f);
+  }
+  void close() {
+    if (skip_ > 0) {
+      --skip_;
+      return;
+    }
+    const frame f{frames_.back()};
+    if (f.array) {
+      node& n = doc_.nodes_[f.node];
+      n.size = (n.numeric ? doc_.numbers_->size() : doc_.elements_.size()) -
+               n.first;
+      // an empty array is not an array of numbers (as in a ptree, where it
+      // can not be told from an empty value)
+      if (n.numeric && n.size == 0) {
+        n.numeric = false;
+        n.first = doc_.elements_.size();
+      }
+    }
+    path_.resize(f.path_size);
+    frames_.pop_back();
+  }
+  void scalar(boost::string_view text) {
+    if (skip_ > 0) {
+      return;
+    }
+    if (in_array()) {
+      add_element(text);
+      return;
+    }
+    const std::size_t size{path_.size()};
+    enter();
+    add_node(doc_.texts_.store(text));
+    path_.resize(size);
+  }
+  // extend the path by the last key (the root has an empty path)
+  void enter() {
+    if (frames_.empty()) {
+      return;
+    }
+    if (!path_.empty()) {
+      path_ += '.';
+    }
+    path_ += key_;
+  }
+  std::size_t add_node(boost::string_view text) {
+    node n;
+    n.key = doc_.keys_.intern(path_);
+    n.text = text;
+    doc_.index_.emplace(n.key, doc_.nodes_.size());
+    doc_.nodes_.push_back(n);
+    return doc_.nodes_.size() - 1;
+  }
+  // the text of the numbers of the array so far (they read back exactly)
+  void keep_texts(node& n) {
+    const std::vector<double>& numbers = *doc_.numbers_;
+    n.texts = true;
+    n.text_first = doc_.elements_.size();
+    for (std::size_t i = n.first; i < numbers.size(); ++i) {
+      doc_.elements_.push_back(doc_.texts_.store(json_number_text(numbers[i])));
+    }
+  }
+  void add_element(boost::string_view text) {
+    node& n = array_node();
+    // the numbers so far become text elements
+    if (n.numeric) {
+      if (!n.texts) {
+        keep_texts(n);
+      }
+      doc_.numbers_->resize(n.first);
+      n.numeric = false;
+      n.texts = false;
+      n.first = n.text_first;
+    }
+    doc_.elements_.push_back(doc_.texts_.store(text));
+  }
+
+  json_document& doc_;
+  std::string path_;
+  std::string key_;
+  std::vector<frame> frames_;
+  std::size_t skip_{0};
+};
+constexpr std::size_t json_document::builder::no_node;
+
+json_document::json_document(std::istream& in)
+    : numbers_{std::make_shared<std::vector<double>>()} {
+  builder b{*this};
+  parse_json(in, b);
+}
+
+const json_document::node* json_document::find(boost::string_view key) const {
+  const auto it = index_.find(key);
+  return it == index_.end() ? nullptr : &nodes_[it->second];
+}
@@ -0,0 +1,164 @@
+#ifndef PHYSICS_UTIL_JSON_LOADED
+#define PHYSICS_UTIL_JSON_LOADED
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+
+#include <physics/util/exception.hh>
+#include <physics/util/span.hh>
+
+// =============================================================================
+// Streaming (SAX) JSON reader, and a flat read-only JSON document for large
+// configuration and calibration files
+//
+// parse_json(in, handler) reads JSON text from a stream, and calls the
+// json_handler for every object, array, key and value in document order.
+// json_document doc{in} stores the values of a document by their full dotted
+// key (as boost::property_tree, "a.b.c"), with arrays of numbers as
+// contiguous doubles. A configuration_snapshot can be created from it
+// directly (see configuration.hh).
+//
+// Notes:
+//  * The stream is read in blocks, only the current key or value is copied.
+//    The string_views passed to the handler are only valid during the call.
+//  * Strings are unescaped (\uXXXX to UTF-8). Number values are converted
+//    with strtod, their text is passed along as well. Invalid JSON throws a
+//    json_error with the offset in the stream.
+//  * json_document keeps the text of the scalar values, and of the elements
+//    of arrays that are not all numbers. Arrays of numbers store the
+//    doubles, in one pool for all arrays, and only keep the text of their
+//    elements as well if an element is not json_number_text of its double
+//    (as for 1.10, or integers beyond 2^53). The contents of objects and
+//    arrays inside arrays are skipped (the element is an empty text). An
+//    empty array is not an array of numbers.
+//  * The keys are interned in a string_interner: a key is stored once, the
+//    lookup index refers to the interned text. A key that appears twice in
+//    an object is only found in its first node (as for ptree::get).
+// =============================================================================
+namespace physics {
+
+class json_error : public physics::exception {
+public:
+  json_error(const std::string& msg,
+             const std::string& type = "json_syntax_error")
+      : physics::exception{msg, type} {}
+};
+
+// SAX callbacks
+class json_handler {
+public:
+  virtual ~json_handler() {}
+  virtual void begin_object() = 0;
+  virtual void end_object() = 0;
+  virtual void begin_array() = 0;
+  virtual void end_array() = 0;
+  virtual void key(boost::string_view key) = 0;
+  virtual void string(boost::string_view value) = 0;
+  virtual void number(boost::string_view text, double value) = 0;
+  // true, false or null
+  virtual void literal(boost::string_view text) = 0;
+};
+
+// read one JSON value from the stream
+void parse_json(std::istream& in, json_handler& handler);
+
+// true if the text is a number in the JSON grammar (no hex, inf, nan or
+// surrounding spaces, as accepted by strtod)
+bool is_json_number(boost::string_view text);
+// the shortest text that reads back as value
+std::string json_number_text(double value);
+
+namespace json_impl {
+struct string_view_hash {
+  std::size_t operator()(boost::string_view text) const;
+};
+} // namespace json_impl
+
+// stable storage for strings: stored strings stay at their address as long
+// as the arena
+class string_arena {
+public:
+  boost::string_view store(boost::string_view text);
+
+private:
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  std::size_t block_size_{0};
+  std::size_t used_{0};
+};
+
+// a single stored copy of every distinct string
+class string_interner {
+public:
+  boost::string_view intern(boost::string_view text);
+  std::size_t size() const { return strings_.size(); }
+
+private:
+  string_arena arena_;
+  std::unordered_set<boost::string_view, json_impl::string_view_hash>
+      strings_;
+};
+
+class json_document {
+public:
+  struct node {
+    // the full dotted key, and the text of a scalar value (empty for
+    // objects and arrays)
+    boost::string_view key;
+    boost::string_view text;
+    bool array{false};
+    // arrays of numbers are in numbers(), other arrays in elements()
+    bool numeric{false};
+    std::size_t first{0};
+    std::size_t size{0};
+    // arrays of numbers that also keep the text of their elements, from
+    // text_first in elements()
+    bool texts{false};
+    std::size_t text_first{0};
+  };
+
+  explicit json_document(std::istream& in);
+
+  // all nodes, in document order
+  const std::vector<node>& nodes() const { return nodes_; }
+  std::size_t size() const { return nodes_.size(); }
+  const node* find(boost::string_view key) const;
+
+  span<const double> numbers(const node& n) const {
+    return n.numeric ? span<const double>{numbers_->data() + n.first, n.size}
+                     : span<const double>{};
+  }
+  span<const boost::string_view> elements(const node& n) const {
+    if (!n.array || (n.numeric && !n.texts)) {
+      return {};
+    }
+    return {elements_.data() + (n.numeric ? n.text_first : n.first), n.size};
+  }
+  // the storage of all arrays of numbers (shared with configuration
+  // snapshots of the document)
+  std::shared_ptr<const std::vector<double>> number_storage() const {
+    return numbers_;
+  }
+
+private:
+  class builder;
+
+  string_interner keys_;
+  string_arena texts_;
+  std::vector<node> nodes_;
+  std::unordered_map<boost::string_view, std::size_t,
+                     json_impl::string_view_hash>
+      index_;
+  std::shared_ptr<std::vector<double>> numbers_;
+  std::vector<boost::string_view> elements_;
+};
+} // namespace physics
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef PHYSICS_UTIL_MATH_LOADED
 #define PHYSICS_UTIL_MATH_LOADED
 
+#include <cmath>
 #include <cstdint>
 #include <ratio>
 
@@ -56,6 +57,17 @@ template <class Ratio> using ratio_cbrt = ratio_pow<Ratio, std::ratio<1, 3>>;
 template <class Ratio> constexpr double pow(double x);
 template <intmax_t N, intmax_t D = 1> constexpr double pow(double x);
 
+// =============================================================================
+// floating point: compile-time routines
+// =============================================================================
+// constexpr D-th root and x^(N/D) for x > 0, evaluated in long double precision
+// with a Newton iteration. These are meant for compile-time constants (e.g.
+// unit rescale factors), pow<>() is faster for runtime values.
+constexpr long double root(long double x, std::intmax_t d);
+template <class Ratio> constexpr long double constexpr_pow(long double x);
+template <intmax_t N, intmax_t D = 1>
+constexpr long double constexpr_pow(long double x);
+
 } // namespace physics
 
 
@@ -152,5 +164,37 @@ template <intmax_t N, intmax_t D> constexpr double pow(double x) {
   return pow_impl::pow<N, D>::call(x);
 }
 
+// =============================================================================
+// implementation: root(x, d) and constexpr_pow(x)
+// =============================================================================
+namespace root_impl {
+// Newton step for y^d = x
+constexpr long double step(long double x, long double y, std::intmax_t d) {
+  return ((d - 1) * y + x / pow_impl::recursive_pow(y, d - 1)) / d;
+}
+// For x >= 1, 1 + (x - 1) / d is an upper bound for the root (Bernoulli's
+// inequality), and the iteration converges monotonically from above. Stop
+// as soon as the next step no longer decreases the estimate (i.e. when it
+// has converged to within rounding).
+constexpr long double iterate(long double x, long double y, long double next,
+                              std::intmax_t d) {
+  return next < y ? iterate(x, next, step(x, next, d), d) : y;
+}
+constexpr long double root_ge1(long double x, std::intmax_t d) {
+  return iterate(x, 1 + (x - 1) / d, step(x, 1 + (x - 1) / d, d), d);
+}
+} // namespace root_impl
+constexpr long double root(long double x, std::intmax_t d) {
+  return (d == 1) ? x : (x < 1) ? 1 / root_impl::root_ge1(1 / x, d)
+                                : root_impl::root_ge1(x, d);
+}
+template <class Ratio> constexpr long double constexpr_pow(long double x) {
+  return pow_impl::recursive_pow(root(x, Ratio::den), Ratio::num);
+}
+template <intmax_t N, intmax_t D>
+constexpr long double constexpr_pow(long double x) {
+  return constexpr_pow<std::ratio<N, D>>(x);
+}
+
 } // namespace physics
 #endif
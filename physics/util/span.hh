@@ -0,0 +1,77 @@
+#ifndef PHYSICS_UTIL_SPAN_LOADED
+#define PHYSICS_UTIL_SPAN_LOADED
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// =============================================================================
+// span<T>: a non-owning view of a contiguous range of T elements, modeled
+// after (a subset of) the C++20 std::span.
+//
+// Notes:
+//  * A span can be constructed from any contiguous container that provides
+//    data() and size() (std::vector, std::array, physics::quantity_array, ...)
+//  * span<T> implicitly converts to span<const T>
+//  * The span does not own the data, the underlying container has to outlive
+//    the span.
+// =============================================================================
+namespace physics {
+template <class T> class span {
+public:
+  using element_type = T;
+  using value_type = typename std::remove_cv<T>::type;
+  using size_type = std::size_t;
+  using pointer = T*;
+  using reference = T&;
+  using iterator = T*;
+
+  constexpr span() : data_{nullptr}, size_{0} {}
+  constexpr span(pointer data, size_type size) : data_{data}, size_{size} {}
+  constexpr span(pointer first, pointer last)
+      : data_{first}, size_{static_cast<size_type>(last - first)} {}
+  // from a span with compatible element type (e.g. span<T> -> span<const T>)
+  template <class U, class = typename std::enable_if<
+                         std::is_convertible<U (*)[], T (*)[]>::value>::type>
+  constexpr span(const span<U>& s) : data_{s.data()}, size_{s.size()} {}
+  // from a contiguous container
+  template <class Container,
+            class = typename std::enable_if<std::is_convertible<
+                typename std::remove_pointer<decltype(
+                    std::declval<Container&>().data())>::type (*)[],
+                T (*)[]>::value>::type>
+  constexpr span(Container& c) : data_{c.data()}, size_{c.size()} {}
+
+  constexpr pointer data() const { return data_; }
+  constexpr size_type size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+
+  constexpr reference operator[](size_type i) const { return data_[i]; }
+  constexpr reference front() const { return data_[0]; }
+  constexpr reference back() const { return data_[size_ - 1]; }
+  constexpr iterator begin() const { return data_; }
+  constexpr iterator end() const { return data_ + size_; }
+
+  // sub-views
+  constexpr span first(size_type count) const { return {data_, count}; }
+  constexpr span last(size_type count) const {
+    return {data_ + size_ - count, count};
+  }
+  constexpr span subspan(size_type offset, size_type count) const {
+    return {data_ + offset, count};
+  }
+
+private:
+  pointer data_;
+  size_type size_;
+};
+
+// create a span from a contiguous container, deducing the element type
+template <class Container>
+constexpr auto make_span(Container& c)
+    -> span<typename std::remove_pointer<decltype(c.data())>::type> {
+  return {c};
+}
+} // namespace physics
+
+#endif
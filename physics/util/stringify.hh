@@ -59,7 +59,7 @@ stringify(const Range& r, const std::string& delimiter = ", ",
 // =============================================================================
 namespace physics {
 namespace stringify_impl {
-template <class Element, class> auto element_accessor(const Element& el) {
+template <class Element, class> Element element_accessor(const Element& el) {
   return el;
 }
 template <class Container, class, class>
@@ -0,0 +1,109 @@
+#ifndef PHYSICS_UTIL_THREAD_POOL_LOADED
+#define PHYSICS_UTIL_THREAD_POOL_LOADED
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// =============================================================================
+// thread_pool: a fixed set of worker threads executing tasks from a shared
+// FIFO queue
+//
+// Notes:
+//  * submit(f) queues f() and returns a std::future for its result, exceptions
+//    thrown by f are re-thrown by future::get().
+//  * The destructor finishes all queued tasks before joining the workers.
+//  * A pool with 0 threads is valid: submit() then runs the task immediately
+//    in the calling thread.
+//  * Tasks should not submit to their own pool and wait for the result: when
+//    all workers wait like this, the queued tasks never run (deadlock).
+// =============================================================================
+namespace physics {
+class thread_pool {
+public:
+  explicit thread_pool(
+      std::size_t n_threads = std::thread::hardware_concurrency());
+  ~thread_pool();
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  std::size_t size() const { return workers_.size(); }
+
+  template <class F>
+  std::future<typename std::result_of<F()>::type> submit(F&& f);
+
+private:
+  void work();
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stop_{false};
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: thread_pool
+// =============================================================================
+namespace physics {
+inline thread_pool::thread_pool(std::size_t n_threads) {
+  workers_.reserve(n_threads);
+  for (std::size_t i = 0; i < n_threads; ++i) {
+    workers_.emplace_back([this] { work(); });
+  }
+}
+inline thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stop_ = true;
+  }
+  condition_.notify_all();
+  for (auto& w : workers_) {
+    w.join();
+  }
+}
+template <class F>
+std::future<typename std::result_of<F()>::type> thread_pool::submit(F&& f) {
+  using result_type = typename std::result_of<F()>::type;
+  // std::function needs a copyable callable, hence the shared_ptr
+  auto task = std::make_shared<std::packaged_task<result_type()>>(
+      std::forward<F>(f));
+  auto result = task->get_future();
+  if (workers_.empty()) {
+    (*task)();
+    return result;
+  }
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    tasks_.emplace_back([task] { (*task)(); });
+  }
+  condition_.notify_one();
+  return result;
+}
+inline void thread_pool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      condition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+} // namespace physics
+
+#endif
@@ -2,10 +2,18 @@
 #define PHYSICS_VECTOR_LOADED
 
 #include <cmath>
+#include <type_traits>
 #include <physics/unit.hh>
 #include <physics/vector/io.hh>
 
 namespace physics {
+namespace vector_impl {
+// numerical value of q in units of Quantity (used for the angles, which only
+// depend on ratios of the components)
+template <class Quantity> constexpr double raw(Quantity q) {
+  return static_cast<double>(q / Quantity{1});
+}
+} // namespace vector_impl
 
 // =============================================================================
 // definition: physics::vector
@@ -45,10 +53,18 @@ template <class Quantity, class Radian = double> struct vector {
   vector(quantity_type r, RadianType theta, quantity_type y3)
       : x1{r * cos(theta)}, x2{r * sin(theta)}, x3{y3} {}
 
-  // construction and assignment from a compatible vector
-  template <class Q2, class R2>
+  // construction and assignment from a compatible vector (explicit when the
+  // quantities are not implicitly convertible, e.g. for a different Rep)
+  template <class Q2, class R2,
+            typename std::enable_if<std::is_convertible<Q2, Quantity>::value>::
+                type* Dummy = nullptr>
   constexpr vector(const vector<Q2, R2>& v)
       : x1{v.x1}, x2{v.x2}, x3{v.x3} {}
+  template <class Q2, class R2,
+            typename std::enable_if<!std::is_convertible<Q2, Quantity>::value>::
+                type* Dummy = nullptr>
+  explicit constexpr vector(const vector<Q2, R2>& v)
+      : x1{v.x1}, x2{v.x2}, x3{v.x3} {}
   template <class Q2, class R2> vector& operator=(const vector<Q2, R2>& v) {
     x1 = v.x1;
     x2 = v.x2;
@@ -68,11 +84,15 @@ template <class Quantity, class Radian = double> struct vector {
   // vector arithmetic
   //
   // add and subtract vectors (units dimensions need to be compatible)
-  constexpr auto operator+(const vector& v) const {
-    return vector{x1 + v.x1, x2 + v.x2, x3 + v.x3};
+  template <class Q2, class R2>
+  constexpr auto operator+(const vector<Q2, R2>& v) const {
+    return vector<decltype(x1 + v.x1), radian_type>{x1 + v.x1, x2 + v.x2,
+                                                    x3 + v.x3};
   }
-  constexpr auto operator-(const vector& v) const {
-    return vector{x1 - v.x1, x2 - v.x2, x3 - v.x3};
+  template <class Q2, class R2>
+  constexpr auto operator-(const vector<Q2, R2>& v) const {
+    return vector<decltype(x1 - v.x1), radian_type>{x1 - v.x1, x2 - v.x2,
+                                                    x3 - v.x3};
   }
   // multiply/divide vector by scalar
   template <class Q2> constexpr auto operator*(Q2 q) const {
@@ -106,17 +126,42 @@ template <class Quantity, class Radian = double> struct vector {
   // multiplication and division-assigment only by doubles (and dimensionless
   // quantities)
   vector& operator*=(double d) {
-    *this = *this * d;
+    x1 *= d;
+    x2 *= d;
+    x3 *= d;
     return *this;
   }
   vector& operator/=(double d) {
-    *this = *this / d;
+    x1 /= d;
+    x2 /= d;
+    x3 /= d;
     return *this;
   }
   // magnitude squared
   constexpr auto mag2() const { return *this * *this; }
   // magnitude
   auto mag() const { return std::sqrt(mag2()); }
+  //
+  // spherical and cylindrical coordinates (with respect to the x3-axis)
+  //
+  // transverse magnitude (squared)
+  constexpr auto perp2() const { return x1 * x1 + x2 * x2; }
+  auto perp() const { return std::sqrt(perp2()); }
+  // azimuthal angle in [-pi, pi] and polar angle in [0, pi]
+  radian_type phi() const {
+    return radian_type{
+        std::atan2(vector_impl::raw(x2), vector_impl::raw(x1))};
+  }
+  radian_type theta() const {
+    const double y1{vector_impl::raw(x1)}, y2{vector_impl::raw(x2)};
+    return radian_type{
+        std::atan2(std::sqrt(y1 * y1 + y2 * y2), vector_impl::raw(x3))};
+  }
+  // pseudorapidity -ln(tan(theta/2))
+  double eta() const {
+    const double y1{vector_impl::raw(x1)}, y2{vector_impl::raw(x2)};
+    return std::asinh(vector_impl::raw(x3) / std::sqrt(y1 * y1 + y2 * y2));
+  }
 };
 // vector magnitude
 template <class Quantity, class Radian>
@@ -127,16 +172,34 @@ template <class Quantity, class Radian>
 constexpr auto mag(const vector<Quantity, Radian>& v) {
   return v.mag();
 }
+// vector coordinates
+template <class Quantity, class Radian>
+auto perp(const vector<Quantity, Radian>& v) {
+  return v.perp();
+}
+template <class Quantity, class Radian>
+Radian phi(const vector<Quantity, Radian>& v) {
+  return v.phi();
+}
+template <class Quantity, class Radian>
+Radian theta(const vector<Quantity, Radian>& v) {
+  return v.theta();
+}
+template <class Quantity, class Radian>
+double eta(const vector<Quantity, Radian>& v) {
+  return v.eta();
+}
 } // namespace physics
 // global vector multiplication operators with quantities and doubles
 // a little more explicit to prevent the operators from being too flexible
-template <class Unit, class Quantity, class Radian>
-constexpr auto operator*(physics::quantity<Unit> q,
+template <class Unit, class Rep, class Quantity, class Radian>
+constexpr auto operator*(physics::quantity<Unit, Rep> q,
                          const physics::vector<Quantity, Radian>& v) {
   return v * q;
 }
-template <class Quantity, class Radian>
-constexpr auto operator*(double d, const physics::vector<Quantity, Radian>& v) {
+template <class T, class Quantity, class Radian,
+          class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+constexpr auto operator*(T d, const physics::vector<Quantity, Radian>& v) {
   return v * d;
 }
 
@@ -159,10 +222,18 @@ template <class Quantity, class Radian = double> struct lorentzvector {
   constexpr lorentzvector(quantity_type y0, const vector_type& y)
       : x0{y0}, x{y} {}
 
-  // construction and assignment from a compatible lorentzvector
-  template <class Q2, class R2>
+  // construction and assignment from a compatible lorentzvector (explicit when
+  // the quantities are not implicitly convertible, e.g. for a different Rep)
+  template <class Q2, class R2,
+            typename std::enable_if<std::is_convertible<Q2, Quantity>::value>::
+                type* Dummy = nullptr>
   constexpr lorentzvector(const lorentzvector<Q2, R2>& v)
       : x0{v.x0}, x{v.x} {}
+  template <class Q2, class R2,
+            typename std::enable_if<!std::is_convertible<Q2, Quantity>::value>::
+                type* Dummy = nullptr>
+  explicit constexpr lorentzvector(const lorentzvector<Q2, R2>& v)
+      : x0{v.x0}, x{v.x} {}
   template <class Q2, class R2>
   lorentzvector& operator=(const lorentzvector<Q2, R2>& v) {
     x0 = v.x0;
@@ -182,11 +253,13 @@ template <class Quantity, class Radian = double> struct lorentzvector {
   // lorentzvector arithmetic
   //
   // add and subtract lorentzvectors (unit dimensions need to be compatible)
-  constexpr auto operator+(const lorentzvector& v) const {
-    return lorentzvector{x0 + v.x0, x + v.x};
+  template <class Q2, class R2>
+  constexpr auto operator+(const lorentzvector<Q2, R2>& v) const {
+    return lorentzvector<decltype(x0 + v.x0), radian_type>{x0 + v.x0, x + v.x};
   }
-  constexpr auto operator-(const lorentzvector& v) const {
-    return lorentzvector{x0 - v.x0, x - v.x};
+  template <class Q2, class R2>
+  constexpr auto operator-(const lorentzvector<Q2, R2>& v) const {
+    return lorentzvector<decltype(x0 - v.x0), radian_type>{x0 - v.x0, x - v.x};
   }
   // multiply/divide vector by scalar
   template <class Q2> constexpr auto operator*(Q2 q) const {
@@ -214,11 +287,13 @@ template <class Quantity, class Radian = double> struct lorentzvector {
   // multiplication and division-assignment only by doubles (and dimensionless
   // quantities)
   lorentzvector& operator*=(double d) {
-    *this = *this * d;
+    x0 *= d;
+    x *= d;
     return *this;
   }
   lorentzvector& operator/=(double d) {
-    *this = *this / d;
+    x0 /= d;
+    x /= d;
     return *this;
   }
   // magnitude squared
@@ -231,6 +306,23 @@ template <class Quantity, class Radian = double> struct lorentzvector {
   }
   // the relative velocity beta=v/c of this particle
   constexpr auto beta() const { return x / x0; }
+  // transverse magnitude and angles of the spatial part
+  auto perp() const { return x.perp(); }
+  radian_type phi() const { return x.phi(); }
+  radian_type theta() const { return x.theta(); }
+  double eta() const { return x.eta(); }
+  // rapidity 1/2 ln((x0 + x3) / (x0 - x3))
+  double rapidity() const {
+    return 0.5 * std::log(vector_impl::raw(x0 + x.x3) /
+                          vector_impl::raw(x0 - x.x3));
+  }
+  // transverse mass (squared), x0^2 - x3^2 = mag2 + perp2; negative like mag()
+  // if the transverse mass squared is negative
+  constexpr auto mt2() const { return x0 * x0 - x.x3 * x.x3; }
+  constexpr auto mt() const {
+    using mt2_type = decltype(mt2());
+    return (mt2() >= mt2_type{0}) ? std::sqrt(mt2()) : -std::sqrt(-mt2());
+  }
   // lorenz boost, transforming (x0, x) in O -> (x0', x') in O', where O' moves
   // relative to the O frame with relative velocity beta=v/c
   template <class Q2, class R2>
@@ -238,7 +330,8 @@ template <class Quantity, class Radian = double> struct lorentzvector {
     double gamma{1. / std::sqrt(1. - beta.mag2())};
     auto y = x + beta * ((gamma - 1) / beta.mag2() * (x * beta) - gamma * x0);
     auto y0 = gamma * (x0 - beta * x);
-    return {y0, y};
+    // (explicit conversion back to our own Rep)
+    return {quantity_type(y0), vector_type(y)};
   }
 };
 // vector magnitude
@@ -258,17 +351,42 @@ template <class Q1, class R1, class Q2, class R2>
 auto boost(const lorentzvector<Q1, R1>& v, const vector<Q2, R2>& beta) {
   return v.boost(beta);
 }
+template <class Quantity, class Radian>
+auto perp(const lorentzvector<Quantity, Radian>& v) {
+  return v.perp();
+}
+template <class Quantity, class Radian>
+Radian phi(const lorentzvector<Quantity, Radian>& v) {
+  return v.phi();
+}
+template <class Quantity, class Radian>
+Radian theta(const lorentzvector<Quantity, Radian>& v) {
+  return v.theta();
+}
+template <class Quantity, class Radian>
+double eta(const lorentzvector<Quantity, Radian>& v) {
+  return v.eta();
+}
+template <class Quantity, class Radian>
+double rapidity(const lorentzvector<Quantity, Radian>& v) {
+  return v.rapidity();
+}
+template <class Quantity, class Radian>
+constexpr auto mt(const lorentzvector<Quantity, Radian>& v) {
+  return v.mt();
+}
 } // namespace physics
 // global lorentzvector multiplication operators with quantities and doubles.
 // Similar as for the vector case, the definitions are explicit to prevent too
 // much flexibility of the operator
-template <class Unit, class Quantity, class Radian>
-constexpr auto operator*(physics::quantity<Unit> q,
+template <class Unit, class Rep, class Quantity, class Radian>
+constexpr auto operator*(physics::quantity<Unit, Rep> q,
                          const physics::lorentzvector<Quantity, Radian>& v) {
   return v * q;
 }
-template <class Quantity, class Radian>
-constexpr auto operator*(double d,
+template <class T, class Quantity, class Radian,
+          class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+constexpr auto operator*(T d,
                          const physics::lorentzvector<Quantity, Radian>& v) {
   return v * d;
 }
@@ -0,0 +1,696 @@
+#ifndef PHYSICS_VECTOR_ARRAY_LOADED
+#define PHYSICS_VECTOR_ARRAY_LOADED
+
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <physics/unit.hh>
+#include <physics/unit/array.hh>
+#include <physics/unit/expression.hh>
+#include <physics/util/aligned.hh>
+#include <physics/util/span.hh>
+#include <physics/vector.hh>
+
+// =============================================================================
+// vector_array<Quantity, Radian>: structure-of-arrays container of
+// physics::vector<Quantity, Radian>, with the x1, x2 and x3 components stored
+// in three separate PHYSICS_SIMD_ALIGNMENT aligned columns
+//
+// Notes:
+//  * Element access (operator[] and the iterators) returns a vector_reference
+//    proxy to the three components. The proxy behaves like a physics::vector
+//    (members x1, x2 and x3, arithmetic, mag2(), mag(), ...), can be assigned
+//    to, and converts implicitly to a physics::vector.
+//  * The batch operations (+, -, scaling, dot product *, cross product ^,
+//    mag2() and mag()) are simple loops over the aligned columns, which the
+//    compiler vectorizes (see PHYSICS_NATIVE_ARCH). The results have the same
+//    units as the corresponding physics::vector operations. The square root
+//    in mag() is only vectorized with -fno-math-errno, as std::sqrt has to
+//    set errno for negative arguments.
+//  * Scalar results (dot products, mag2() and mag()) are returned as a
+//    quantity_array (or an aligned_vector for raw doubles).
+//  * Batch operations on arrays with a different size throw an
+//    expression_error.
+//
+// lorentzvector_array<Quantity, Radian>: the same for physics::lorentzvector,
+// with an x0 column and a vector_array for the spatial components. Lorentz
+// boosts of a whole array are applied with a boost_transform (see
+// physics/vector/boost.hh).
+// =============================================================================
+namespace physics {
+
+template <class Quantity, class Radian = double> class vector_array;
+template <class Quantity, class Radian, class Element> class vector_reference;
+template <class Quantity, class Radian = double> class lorentzvector_array;
+template <class Quantity, class Radian, class Element>
+class lorentzvector_reference;
+
+namespace vector_array_impl {
+// container for the scalar results of a batch operation
+template <class T> struct column_array { using type = aligned_vector<T>; };
+template <class Unit> struct column_array<quantity<Unit, double>> {
+  using type = quantity_array<Unit>;
+};
+template <class T> using column_array_t = typename column_array<T>::type;
+// random access iterator over the vector_reference proxies of an array
+template <class Array, class Reference> class iterator;
+} // namespace vector_array_impl
+
+template <class Quantity, class Radian> class vector_array {
+public:
+  using quantity_type = Quantity;
+  using radian_type = Radian;
+  using value_type = vector<Quantity, Radian>;
+  using column_type = aligned_vector<Quantity>;
+  using size_type = std::size_t;
+  using reference = vector_reference<Quantity, Radian, Quantity>;
+  using const_reference = vector_reference<Quantity, Radian, const Quantity>;
+  using iterator = vector_array_impl::iterator<vector_array, reference>;
+  using const_iterator =
+      vector_array_impl::iterator<const vector_array, const_reference>;
+
+  // constructors
+  //
+  // 1. empty array, or n zero-initialized vectors
+  vector_array() = default;
+  explicit vector_array(size_type n)
+      : x1_(n, quantity_type{0})
+      , x2_(n, quantity_type{0})
+      , x3_(n, quantity_type{0}) {}
+  // 2. n copies of v
+  vector_array(size_type n, const value_type& v)
+      : x1_(n, v.x1), x2_(n, v.x2), x3_(n, v.x3) {}
+  // 3. from a list of vectors
+  vector_array(std::initializer_list<value_type> il) {
+    reserve(il.size());
+    for (const auto& v : il) {
+      push_back(v);
+    }
+  }
+
+  // size and capacity
+  size_type size() const { return x1_.size(); }
+  bool empty() const { return x1_.empty(); }
+  void resize(size_type n) {
+    x1_.resize(n, quantity_type{0});
+    x2_.resize(n, quantity_type{0});
+    x3_.resize(n, quantity_type{0});
+  }
+  void reserve(size_type n) {
+    x1_.reserve(n);
+    x2_.reserve(n);
+    x3_.reserve(n);
+  }
+  void clear() {
+    x1_.clear();
+    x2_.clear();
+    x3_.clear();
+  }
+  void push_back(const value_type& v) {
+    x1_.push_back(v.x1);
+    x2_.push_back(v.x2);
+    x3_.push_back(v.x3);
+  }
+
+  // element access
+  reference operator[](size_type i) { return {x1_[i], x2_[i], x3_[i]}; }
+  const_reference operator[](size_type i) const {
+    return {x1_[i], x2_[i], x3_[i]};
+  }
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, size()}; }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, size()}; }
+  // component columns
+  span<quantity_type> x1() { return {x1_.data(), x1_.size()}; }
+  span<quantity_type> x2() { return {x2_.data(), x2_.size()}; }
+  span<quantity_type> x3() { return {x3_.data(), x3_.size()}; }
+  span<const quantity_type> x1() const { return {x1_.data(), x1_.size()}; }
+  span<const quantity_type> x2() const { return {x2_.data(), x2_.size()}; }
+  span<const quantity_type> x3() const { return {x3_.data(), x3_.size()}; }
+
+  // batch arithmetic (see vector for the semantics)
+  //
+  // add and subtract arrays (unit dimensions need to be compatible)
+  template <class Q2, class R2>
+  auto operator+(const vector_array<Q2, R2>& v) const;
+  template <class Q2, class R2>
+  auto operator-(const vector_array<Q2, R2>& v) const;
+  // multiply/divide all vectors by a scalar
+  template <class Q2> auto operator*(Q2 q) const;
+  template <class Q2> auto operator/(Q2 q) const;
+  // element-wise scalar product (unit dimensions can differ)
+  template <class Q2, class R2>
+  auto operator*(const vector_array<Q2, R2>& v) const;
+  // element-wise cross product (unit dimensions can differ)
+  template <class Q2, class R2>
+  auto operator^(const vector_array<Q2, R2>& v) const;
+  // arithmetic assignment
+  template <class Q2, class R2>
+  vector_array& operator+=(const vector_array<Q2, R2>& v);
+  template <class Q2, class R2>
+  vector_array& operator-=(const vector_array<Q2, R2>& v);
+  vector_array& operator*=(double d);
+  vector_array& operator/=(double d);
+  // element-wise magnitude squared and magnitude
+  auto mag2() const { return *this * *this; }
+  auto mag() const;
+
+private:
+  column_type x1_;
+  column_type x2_;
+  column_type x3_;
+};
+
+// proxy reference to an element of a vector_array, Element is either Quantity
+// or const Quantity
+template <class Quantity, class Radian, class Element> class vector_reference {
+public:
+  using quantity_type = Quantity;
+  using radian_type = Radian;
+  using value_type = vector<Quantity, Radian>;
+
+  Element& x1;
+  Element& x2;
+  Element& x3;
+
+  constexpr vector_reference(Element& y1, Element& y2, Element& y3)
+      : x1(y1), x2(y2), x3(y3) {}
+  vector_reference(const vector_reference&) = default;
+
+  // assignment writes to the referenced components
+  vector_reference& operator=(const vector_reference& v) {
+    return *this = value_type(v);
+  }
+  template <class Q2, class R2>
+  vector_reference& operator=(const vector<Q2, R2>& v) {
+    x1 = v.x1;
+    x2 = v.x2;
+    x3 = v.x3;
+    return *this;
+  }
+  template <class Q2, class R2, class E2>
+  vector_reference& operator=(const vector_reference<Q2, R2, E2>& v) {
+    return *this = vector<Q2, R2>(v);
+  }
+  constexpr operator value_type() const { return {x1, x2, x3}; }
+
+  // comparison and arithmetic, evaluated as for vector
+  template <class T> constexpr bool operator==(const T& v) const {
+    return value_type(*this) == as_vector(v);
+  }
+  template <class T> constexpr bool operator!=(const T& v) const {
+    return !(*this == v);
+  }
+  template <class T> constexpr auto operator+(const T& v) const {
+    return value_type(*this) + as_vector(v);
+  }
+  template <class T> constexpr auto operator-(const T& v) const {
+    return value_type(*this) - as_vector(v);
+  }
+  template <class T> constexpr auto operator*(const T& v) const {
+    return value_type(*this) * as_vector(v);
+  }
+  template <class T> constexpr auto operator/(const T& v) const {
+    return value_type(*this) / v;
+  }
+  template <class T> constexpr auto operator^(const T& v) const {
+    return value_type(*this) ^ as_vector(v);
+  }
+  template <class T> vector_reference& operator+=(const T& v) {
+    return *this = *this + v;
+  }
+  template <class T> vector_reference& operator-=(const T& v) {
+    return *this = *this - v;
+  }
+  vector_reference& operator*=(double d) { return *this = *this * d; }
+  vector_reference& operator/=(double d) { return *this = *this / d; }
+  constexpr auto mag2() const { return value_type(*this).mag2(); }
+  auto mag() const { return value_type(*this).mag(); }
+  auto perp() const { return value_type(*this).perp(); }
+  Radian phi() const { return value_type(*this).phi(); }
+  Radian theta() const { return value_type(*this).theta(); }
+  double eta() const { return value_type(*this).eta(); }
+
+private:
+  // vector operands: proxies are converted to vectors, everything else
+  // (vectors and scalars) is passed on unchanged
+  template <class T> static constexpr const T& as_vector(const T& v) {
+    return v;
+  }
+  template <class Q2, class R2, class E2>
+  static constexpr vector<Q2, R2>
+  as_vector(const vector_reference<Q2, R2, E2>& v) {
+    return v;
+  }
+};
+
+template <class Quantity, class Radian> class lorentzvector_array {
+public:
+  using quantity_type = Quantity;
+  using radian_type = Radian;
+  using value_type = lorentzvector<Quantity, Radian>;
+  using vector_array_type = vector_array<Quantity, Radian>;
+  using column_type = aligned_vector<Quantity>;
+  using size_type = std::size_t;
+  using reference = lorentzvector_reference<Quantity, Radian, Quantity>;
+  using const_reference =
+      lorentzvector_reference<Quantity, Radian, const Quantity>;
+  using iterator = vector_array_impl::iterator<lorentzvector_array, reference>;
+  using const_iterator =
+      vector_array_impl::iterator<const lorentzvector_array, const_reference>;
+
+  // constructors
+  //
+  // 1. empty array, or n zero-initialized lorentzvectors
+  lorentzvector_array() = default;
+  explicit lorentzvector_array(size_type n)
+      : x0_(n, quantity_type{0}), x_(n) {}
+  // 2. n copies of v
+  lorentzvector_array(size_type n, const value_type& v)
+      : x0_(n, v.x0), x_(n, v.x) {}
+  // 3. from a list of lorentzvectors
+  lorentzvector_array(std::initializer_list<value_type> il) {
+    reserve(il.size());
+    for (const auto& v : il) {
+      push_back(v);
+    }
+  }
+
+  // size and capacity
+  size_type size() const { return x0_.size(); }
+  bool empty() const { return x0_.empty(); }
+  void resize(size_type n) {
+    x0_.resize(n, quantity_type{0});
+    x_.resize(n);
+  }
+  void reserve(size_type n) {
+    x0_.reserve(n);
+    x_.reserve(n);
+  }
+  void clear() {
+    x0_.clear();
+    x_.clear();
+  }
+  void push_back(const value_type& v) {
+    x0_.push_back(v.x0);
+    x_.push_back(v.x);
+  }
+
+  // element access
+  reference operator[](size_type i) { return {x0_[i], x_[i]}; }
+  const_reference operator[](size_type i) const { return {x0_[i], x_[i]}; }
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, size()}; }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, size()}; }
+  // the x0 column and the spatial components
+  span<quantity_type> x0() { return {x0_.data(), x0_.size()}; }
+  span<const quantity_type> x0() const { return {x0_.data(), x0_.size()}; }
+  vector_array_type& x() { return x_; }
+  const vector_array_type& x() const { return x_; }
+
+private:
+  column_type x0_;
+  vector_array_type x_;
+};
+
+// proxy reference to an element of a lorentzvector_array
+template <class Quantity, class Radian, class Element>
+class lorentzvector_reference {
+public:
+  using quantity_type = Quantity;
+  using radian_type = Radian;
+  using value_type = lorentzvector<Quantity, Radian>;
+
+  Element& x0;
+  vector_reference<Quantity, Radian, Element> x;
+
+  constexpr lorentzvector_reference(
+      Element& y0, const vector_reference<Quantity, Radian, Element>& y)
+      : x0(y0), x(y) {}
+  lorentzvector_reference(const lorentzvector_reference&) = default;
+
+  // assignment writes to the referenced components
+  lorentzvector_reference& operator=(const lorentzvector_reference& v) {
+    return *this = value_type(v);
+  }
+  template <class Q2, class R2>
+  lorentzvector_reference& operator=(const lorentzvector<Q2, R2>& v) {
+    x0 = v.x0;
+    x = v.x;
+    return *this;
+  }
+  constexpr operator value_type() const { return {x0, x}; }
+
+  // comparison and the common lorentzvector operations
+  template <class T> constexpr bool operator==(const T& v) const {
+    return value_type(*this) == as_lorentzvector(v);
+  }
+  template <class T> constexpr bool operator!=(const T& v) const {
+    return !(*this == v);
+  }
+  constexpr auto mag2() const { return value_type(*this).mag2(); }
+  constexpr auto mag() const { return value_type(*this).mag(); }
+  constexpr auto beta() const { return value_type(*this).beta(); }
+  auto perp() const { return value_type(*this).perp(); }
+  Radian phi() const { return value_type(*this).phi(); }
+  Radian theta() const { return value_type(*this).theta(); }
+  double eta() const { return value_type(*this).eta(); }
+  double rapidity() const { return value_type(*this).rapidity(); }
+  constexpr auto mt() const { return value_type(*this).mt(); }
+  template <class Q2, class R2>
+  value_type boost(const vector<Q2, R2>& beta) const {
+    return value_type(*this).boost(beta);
+  }
+
+private:
+  template <class T> static constexpr const T& as_lorentzvector(const T& v) {
+    return v;
+  }
+  template <class Q2, class R2, class E2>
+  static constexpr lorentzvector<Q2, R2>
+  as_lorentzvector(const lorentzvector_reference<Q2, R2, E2>& v) {
+    return v;
+  }
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: iterator
+// =============================================================================
+namespace physics {
+namespace vector_array_impl {
+template <class Array, class Reference> class iterator {
+public:
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = typename Array::value_type;
+  using difference_type = std::ptrdiff_t;
+  using reference = Reference;
+  using pointer = void;
+
+  constexpr iterator() : array_{nullptr}, i_{0} {}
+  constexpr iterator(Array* array, std::size_t i) : array_{array}, i_{i} {}
+
+  reference operator*() const { return (*array_)[i_]; }
+  reference operator[](difference_type n) const { return (*array_)[i_ + n]; }
+  iterator& operator++() {
+    ++i_;
+    return *this;
+  }
+  iterator& operator--() {
+    --i_;
+    return *this;
+  }
+  iterator operator++(int) { return {array_, i_++}; }
+  iterator operator--(int) { return {array_, i_--}; }
+  iterator& operator+=(difference_type n) {
+    i_ += n;
+    return *this;
+  }
+  iterator& operator-=(difference_type n) {
+    i_ -= n;
+    return *this;
+  }
+  iterator operator+(difference_type n) const { return {array_, i_ + n}; }
+  iterator operator-(difference_type n) const { return {array_, i_ - n}; }
+  difference_type operator-(const iterator& it) const {
+    return static_cast<difference_type>(i_) -
+           static_cast<difference_type>(it.i_);
+  }
+  bool operator==(const iterator& it) const { return i_ == it.i_; }
+  bool operator!=(const iterator& it) const { return i_ != it.i_; }
+  bool operator<(const iterator& it) const { return i_ < it.i_; }
+  bool operator>(const iterator& it) const { return i_ > it.i_; }
+  bool operator<=(const iterator& it) const { return i_ <= it.i_; }
+  bool operator>=(const iterator& it) const { return i_ >= it.i_; }
+
+private:
+  Array* array_;
+  std::size_t i_;
+};
+} // namespace vector_array_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: batch operations
+// =============================================================================
+namespace physics {
+namespace vector_array_impl {
+inline void check_size(std::size_t n1, std::size_t n2) {
+  if (n1 != n2) {
+    throw expression_error{"vector_array size mismatch (" +
+                               std::to_string(n1) + " vs. " +
+                               std::to_string(n2) + ")",
+                           "expression_size_error"};
+  }
+}
+template <class T> T* aligned(T* ptr) {
+  return PHYSICS_ASSUME_ALIGNED(ptr, PHYSICS_SIMD_ALIGNMENT);
+}
+} // namespace vector_array_impl
+
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+auto vector_array<Quantity, Radian>::
+operator+(const vector_array<Q2, R2>& v) const {
+  vector_array_impl::check_size(size(), v.size());
+  using result_type = decltype(x1_[0] + v.x1()[0]);
+  const std::size_t n{size()};
+  vector_array<result_type, Radian> result(n);
+  const column_type* a[3]{&x1_, &x2_, &x3_};
+  span<const Q2> b[3]{v.x1(), v.x2(), v.x3()};
+  span<result_type> out[3]{result.x1(), result.x2(), result.x3()};
+  for (std::size_t c = 0; c < 3; ++c) {
+    const Quantity* x{vector_array_impl::aligned(a[c]->data())};
+    const Q2* z{vector_array_impl::aligned(b[c].data())};
+    result_type* y{vector_array_impl::aligned(out[c].data())};
+    for (std::size_t i = 0; i < n; ++i) {
+      y[i] = x[i] + z[i];
+    }
+  }
+  return result;
+}
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+auto vector_array<Quantity, Radian>::
+operator-(const vector_array<Q2, R2>& v) const {
+  vector_array_impl::check_size(size(), v.size());
+  using result_type = decltype(x1_[0] - v.x1()[0]);
+  const std::size_t n{size()};
+  vector_array<result_type, Radian> result(n);
+  const column_type* a[3]{&x1_, &x2_, &x3_};
+  span<const Q2> b[3]{v.x1(), v.x2(), v.x3()};
+  span<result_type> out[3]{result.x1(), result.x2(), result.x3()};
+  for (std::size_t c = 0; c < 3; ++c) {
+    const Quantity* x{vector_array_impl::aligned(a[c]->data())};
+    const Q2* z{vector_array_impl::aligned(b[c].data())};
+    result_type* y{vector_array_impl::aligned(out[c].data())};
+    for (std::size_t i = 0; i < n; ++i) {
+      y[i] = x[i] - z[i];
+    }
+  }
+  return result;
+}
+template <class Quantity, class Radian>
+template <class Q2>
+auto vector_array<Quantity, Radian>::operator*(Q2 q) const {
+  using result_type = decltype(x1_[0] * q);
+  const std::size_t n{size()};
+  vector_array<result_type, Radian> result(n);
+  const column_type* in[3]{&x1_, &x2_, &x3_};
+  span<result_type> out[3]{result.x1(), result.x2(), result.x3()};
+  for (std::size_t c = 0; c < 3; ++c) {
+    const Quantity* x{vector_array_impl::aligned(in[c]->data())};
+    result_type* y{vector_array_impl::aligned(out[c].data())};
+    for (std::size_t i = 0; i < n; ++i) {
+      y[i] = x[i] * q;
+    }
+  }
+  return result;
+}
+template <class Quantity, class Radian>
+template <class Q2>
+auto vector_array<Quantity, Radian>::operator/(Q2 q) const {
+  using result_type = decltype(x1_[0] / q);
+  const std::size_t n{size()};
+  vector_array<result_type, Radian> result(n);
+  const column_type* in[3]{&x1_, &x2_, &x3_};
+  span<result_type> out[3]{result.x1(), result.x2(), result.x3()};
+  for (std::size_t c = 0; c < 3; ++c) {
+    const Quantity* x{vector_array_impl::aligned(in[c]->data())};
+    result_type* y{vector_array_impl::aligned(out[c].data())};
+    for (std::size_t i = 0; i < n; ++i) {
+      y[i] = x[i] / q;
+    }
+  }
+  return result;
+}
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+auto vector_array<Quantity, Radian>::
+operator*(const vector_array<Q2, R2>& v) const {
+  vector_array_impl::check_size(size(), v.size());
+  using result_type = decltype(x1_[0] * v.x1()[0]);
+  const std::size_t n{size()};
+  vector_array_impl::column_array_t<result_type> result(n);
+  const Quantity* a1{vector_array_impl::aligned(x1_.data())};
+  const Quantity* a2{vector_array_impl::aligned(x2_.data())};
+  const Quantity* a3{vector_array_impl::aligned(x3_.data())};
+  const Q2* b1{vector_array_impl::aligned(v.x1().data())};
+  const Q2* b2{vector_array_impl::aligned(v.x2().data())};
+  const Q2* b3{vector_array_impl::aligned(v.x3().data())};
+  result_type* y{vector_array_impl::aligned(result.data())};
+  for (std::size_t i = 0; i < n; ++i) {
+    y[i] = a1[i] * b1[i] + a2[i] * b2[i] + a3[i] * b3[i];
+  }
+  return result;
+}
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+auto vector_array<Quantity, Radian>::
+operator^(const vector_array<Q2, R2>& v) const {
+  vector_array_impl::check_size(size(), v.size());
+  using result_type = decltype(x1_[0] * v.x1()[0]);
+  const std::size_t n{size()};
+  vector_array<result_type, Radian> result(n);
+  const Quantity* a1{vector_array_impl::aligned(x1_.data())};
+  const Quantity* a2{vector_array_impl::aligned(x2_.data())};
+  const Quantity* a3{vector_array_impl::aligned(x3_.data())};
+  const Q2* b1{vector_array_impl::aligned(v.x1().data())};
+  const Q2* b2{vector_array_impl::aligned(v.x2().data())};
+  const Q2* b3{vector_array_impl::aligned(v.x3().data())};
+  result_type* y1{vector_array_impl::aligned(result.x1().data())};
+  result_type* y2{vector_array_impl::aligned(result.x2().data())};
+  result_type* y3{vector_array_impl::aligned(result.x3().data())};
+  // one loop per component, which keeps the number of streams per loop low
+  // enough for the vectorizer
+  for (std::size_t i = 0; i < n; ++i) {
+    y1[i] = a2[i] * b3[i] - a3[i] * b2[i];
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    y2[i] = a3[i] * b1[i] - a1[i] * b3[i];
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    y3[i] = a1[i] * b2[i] - a2[i] * b1[i];
+  }
+  return result;
+}
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+vector_array<Quantity, Radian>& vector_array<Quantity, Radian>::
+operator+=(const vector_array<Q2, R2>& v) {
+  vector_array_impl::check_size(size(), v.size());
+  const std::size_t n{size()};
+  column_type* out[3]{&x1_, &x2_, &x3_};
+  span<const Q2> in[3]{v.x1(), v.x2(), v.x3()};
+  for (std::size_t c = 0; c < 3; ++c) {
+    Quantity* y{vector_array_impl::aligned(out[c]->data())};
+    const Q2* x{vector_array_impl::aligned(in[c].data())};
+    for (std::size_t i = 0; i < n; ++i) {
+      y[i] += x[i];
+    }
+  }
+  return *this;
+}
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+vector_array<Quantity, Radian>& vector_array<Quantity, Radian>::
+operator-=(const vector_array<Q2, R2>& v) {
+  vector_array_impl::check_size(size(), v.size());
+  const std::size_t n{size()};
+  column_type* out[3]{&x1_, &x2_, &x3_};
+  span<const Q2> in[3]{v.x1(), v.x2(), v.x3()};
+  for (std::size_t c = 0; c < 3; ++c) {
+    Quantity* y{vector_array_impl::aligned(out[c]->data())};
+    const Q2* x{vector_array_impl::aligned(in[c].data())};
+    for (std::size_t i = 0; i < n; ++i) {
+      y[i] -= x[i];
+    }
+  }
+  return *this;
+}
+template <class Quantity, class Radian>
+vector_array<Quantity, Radian>& vector_array<Quantity, Radian>::
+operator*=(double d) {
+  for (column_type* column : {&x1_, &x2_, &x3_}) {
+    Quantity* y{vector_array_impl::aligned(column->data())};
+    for (std::size_t i = 0; i < column->size(); ++i) {
+      y[i] *= d;
+    }
+  }
+  return *this;
+}
+template <class Quantity, class Radian>
+vector_array<Quantity, Radian>& vector_array<Quantity, Radian>::
+operator/=(double d) {
+  for (column_type* column : {&x1_, &x2_, &x3_}) {
+    Quantity* y{vector_array_impl::aligned(column->data())};
+    for (std::size_t i = 0; i < column->size(); ++i) {
+      y[i] /= d;
+    }
+  }
+  return *this;
+}
+template <class Quantity, class Radian>
+auto vector_array<Quantity, Radian>::mag() const {
+  const auto m2 = mag2();
+  using mag2_type = typename decltype(m2)::value_type;
+  using result_type = decltype(std::sqrt(std::declval<mag2_type>()));
+  const std::size_t n{size()};
+  vector_array_impl::column_array_t<result_type> result(n);
+  const mag2_type* x{vector_array_impl::aligned(m2.data())};
+  result_type* y{vector_array_impl::aligned(result.data())};
+  for (std::size_t i = 0; i < n; ++i) {
+    y[i] = std::sqrt(x[i]);
+  }
+  return result;
+}
+} // namespace physics
+
+// global multiplication operators with quantities and doubles, and the
+// vector-proxy operators (as for vector)
+template <class Unit, class Rep, class Quantity, class Radian>
+auto operator*(physics::quantity<Unit, Rep> q,
+               const physics::vector_array<Quantity, Radian>& v) {
+  return v * q;
+}
+template <class T, class Quantity, class Radian,
+          class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+auto operator*(T d, const physics::vector_array<Quantity, Radian>& v) {
+  return v * d;
+}
+template <class Unit, class Rep, class Quantity, class Radian, class Element>
+constexpr auto
+operator*(physics::quantity<Unit, Rep> q,
+          const physics::vector_reference<Quantity, Radian, Element>& v) {
+  return v * q;
+}
+template <class T, class Quantity, class Radian, class Element,
+          class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+constexpr auto
+operator*(T d, const physics::vector_reference<Quantity, Radian, Element>& v) {
+  return v * d;
+}
+// vector (LHS) with a vector_reference (RHS)
+#define PHYSICS_VECTOR_REFERENCE_OPERATOR(op)                                  \
+  template <class Q1, class R1, class Q2, class R2, class E2>                  \
+  constexpr auto operator op(                                                  \
+      const physics::vector<Q1, R1>& v1,                                       \
+      const physics::vector_reference<Q2, R2, E2>& v2) {                       \
+    return v1 op physics::vector<Q2, R2>(v2);                                  \
+  }
+PHYSICS_VECTOR_REFERENCE_OPERATOR(+)
+PHYSICS_VECTOR_REFERENCE_OPERATOR(-)
+PHYSICS_VECTOR_REFERENCE_OPERATOR(*)
+PHYSICS_VECTOR_REFERENCE_OPERATOR(^)
+PHYSICS_VECTOR_REFERENCE_OPERATOR(==)
+PHYSICS_VECTOR_REFERENCE_OPERATOR(!=)
+#undef PHYSICS_VECTOR_REFERENCE_OPERATOR
+
+#endif
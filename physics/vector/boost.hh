@@ -0,0 +1,185 @@
+#ifndef PHYSICS_VECTOR_BOOST_LOADED
+#define PHYSICS_VECTOR_BOOST_LOADED
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include <physics/unit.hh>
+#include <physics/unit/type_traits.hh>
+#include <physics/vector.hh>
+#include <physics/vector/array.hh>
+
+// =============================================================================
+// boost_transform: a Lorentz boost with a fixed beta=v/c, precomputed once
+// and applied to many lorentzvectors
+//
+// boost_transform{beta} transforms (x0, x) in O -> (x0', x') in O', where O'
+// moves relative to O with velocity beta, exactly like
+// lorentzvector::boost(beta). boost_transform{p} boosts into the rest frame
+// of the lorentzvector p (beta = p.beta()).
+//
+// Notes:
+//  * gamma, (gamma - 1) / beta^2 and the 4x4 boost matrix are computed in the
+//    constructor. (gamma - 1) / beta^2 is evaluated as gamma^2 / (gamma + 1),
+//    which is also well-defined for beta = 0 (identity transform).
+//  * The transform is applied to a single lorentzvector with operator(), and
+//    to a whole lorentzvector_array (in place) with apply(). The batch kernel
+//    is a single loop over the four component columns, which the compiler
+//    vectorizes.
+//  * The transform only depends on beta, so the result keeps the Quantity
+//    (unit and Rep) of the input lorentzvector. The arithmetic is done in
+//    double precision.
+// =============================================================================
+namespace physics {
+class boost_transform {
+public:
+  // identity transform
+  boost_transform() : boost_transform{0., 0., 0.} {}
+  // boost with relative velocity beta (a dimensionless vector)
+  template <class Q, class R>
+  explicit boost_transform(const vector<Q, R>& beta)
+      : boost_transform{static_cast<double>(beta.x1),
+                        static_cast<double>(beta.x2),
+                        static_cast<double>(beta.x3)} {
+    static_assert(unit_impl::is_dimensionless_value<Q>::value,
+                  "beta has to be dimensionless");
+  }
+  // boost into the rest frame of p
+  template <class Q, class R>
+  explicit boost_transform(const lorentzvector<Q, R>& p)
+      : boost_transform{p.beta()} {}
+
+  // precomputed quantities
+  vector<double> beta() const { return {beta_[0], beta_[1], beta_[2]}; }
+  double gamma() const { return gamma_; }
+  double gamma_factor() const { return gamma_factor_; }
+  // boost matrix, row-major with x0 as the first coordinate
+  const double (&matrix() const)[4][4] { return matrix_; }
+  // the inverse transform (a boost with -beta)
+  boost_transform inverse() const {
+    return boost_transform{-beta_[0], -beta_[1], -beta_[2]};
+  }
+
+  // transform a single lorentzvector
+  template <class Q, class R>
+  lorentzvector<Q, R> operator()(const lorentzvector<Q, R>& v) const;
+  template <class Q, class R, class Element>
+  lorentzvector<Q, R>
+  operator()(const lorentzvector_reference<Q, R, Element>& v) const {
+    return (*this)(lorentzvector<Q, R>{v});
+  }
+  // transform a whole array in place, and a copy of an array
+  template <class Q, class R> void apply(lorentzvector_array<Q, R>& v) const;
+  template <class Q, class R>
+  lorentzvector_array<Q, R> operator()(lorentzvector_array<Q, R> v) const {
+    apply(v);
+    return v;
+  }
+
+private:
+  boost_transform(double b1, double b2, double b3);
+
+  double beta_[3];
+  double gamma_;
+  // (gamma - 1) / beta^2
+  double gamma_factor_;
+  double matrix_[4][4];
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: boost_transform
+// =============================================================================
+namespace physics {
+namespace transform_impl {
+// raw numerical value of a quantity (or double), and the reverse
+template <class T> constexpr double raw(T x) {
+  return static_cast<double>(x);
+}
+template <class Unit, class Rep> constexpr double raw(quantity<Unit, Rep> q) {
+  return static_cast<double>(q.raw_value());
+}
+template <class Q, class = void> struct from_raw {
+  static constexpr Q get(double x) { return static_cast<Q>(x); }
+};
+template <class Q>
+struct from_raw<Q, typename std::enable_if<
+                       unit_impl::is_quantity<Q>::value>::type> {
+  static constexpr Q get(double x) {
+    return Q{static_cast<typename Q::rep>(x)};
+  }
+};
+// x <- m * x for the N aligned columns x[0], ..., x[N-1] of length n. The
+// matrix is copied to the stack first, so the compiler knows it does not
+// alias the columns.
+template <std::size_t N, class Q>
+void transform_columns(const double (&matrix)[N][N], Q* const (&x)[N],
+                       std::size_t n) {
+  double m[N][N];
+  Q* y[N];
+  for (std::size_t r = 0; r < N; ++r) {
+    for (std::size_t c = 0; c < N; ++c) {
+      m[r][c] = matrix[r][c];
+    }
+    y[r] = vector_array_impl::aligned(x[r]);
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    double in[N];
+    for (std::size_t c = 0; c < N; ++c) {
+      in[c] = raw(y[c][i]);
+    }
+    for (std::size_t r = 0; r < N; ++r) {
+      double out{0.};
+      for (std::size_t c = 0; c < N; ++c) {
+        out += m[r][c] * in[c];
+      }
+      y[r][i] = from_raw<Q>::get(out);
+    }
+  }
+}
+// m * v for a single lorentzvector
+template <class Q, class R>
+lorentzvector<Q, R> transform_lorentzvector(const double (&m)[4][4],
+                                            const lorentzvector<Q, R>& v) {
+  const double x[4]{raw(v.x0), raw(v.x.x1), raw(v.x.x2), raw(v.x.x3)};
+  double y[4];
+  for (int i = 0; i < 4; ++i) {
+    y[i] = m[i][0] * x[0] + m[i][1] * x[1] + m[i][2] * x[2] + m[i][3] * x[3];
+  }
+  return {from_raw<Q>::get(y[0]),
+          {from_raw<Q>::get(y[1]), from_raw<Q>::get(y[2]),
+           from_raw<Q>::get(y[3])}};
+}
+} // namespace transform_impl
+
+inline boost_transform::boost_transform(double b1, double b2, double b3)
+    : beta_{b1, b2, b3} {
+  const double b2_sum{b1 * b1 + b2 * b2 + b3 * b3};
+  gamma_ = 1. / std::sqrt(1. - b2_sum);
+  gamma_factor_ = gamma_ * gamma_ / (gamma_ + 1.);
+  matrix_[0][0] = gamma_;
+  for (int i = 0; i < 3; ++i) {
+    matrix_[0][i + 1] = -gamma_ * beta_[i];
+    matrix_[i + 1][0] = -gamma_ * beta_[i];
+    for (int j = 0; j < 3; ++j) {
+      matrix_[i + 1][j + 1] =
+          (i == j ? 1. : 0.) + gamma_factor_ * beta_[i] * beta_[j];
+    }
+  }
+}
+template <class Q, class R>
+lorentzvector<Q, R> boost_transform::
+operator()(const lorentzvector<Q, R>& v) const {
+  return transform_impl::transform_lorentzvector(matrix_, v);
+}
+template <class Q, class R>
+void boost_transform::apply(lorentzvector_array<Q, R>& v) const {
+  transform_impl::transform_columns(
+      matrix_, {v.x0().data(), v.x().x1().data(), v.x().x2().data(),
+                v.x().x3().data()},
+      v.size());
+}
+} // namespace physics
+
+#endif
@@ -0,0 +1,347 @@
+#ifndef PHYSICS_VECTOR_COMBINATORICS_LOADED
+#define PHYSICS_VECTOR_COMBINATORICS_LOADED
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <future>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <physics/util/aligned.hh>
+#include <physics/util/exception.hh>
+#include <physics/util/thread_pool.hh>
+#include <physics/vector.hh>
+#include <physics/vector/array.hh>
+
+// =============================================================================
+// combinations<K>: the K-combinations of the particles in an event (a
+// lorentzvector_array), with their invariant masses
+//
+// combinations<K>(particles) returns a combination_list with the index tuple
+// (i1 < i2 < ... < iK) and the invariant mass (the mag() of the sum of the
+// lorentzvectors) of every K-combination, in lexicographic order.
+//
+// Notes:
+//  * An optional per-particle mask (any container with size() and an
+//    operator[] that converts to bool, e.g. std::vector<bool>) restricts the
+//    combinations to the selected particles. The index tuples still refer to
+//    the positions in the full array.
+//  * An optional mass_window keeps only the combinations with
+//    low <= mass <= high. The window is applied to the squared masses, so the
+//    square root is only evaluated for the survivors.
+//  * The selected particles are first copied into aligned columns of raw
+//    values. The first K-1 indices are enumerated recursively, and for every
+//    partial sum the squared masses with all candidates for the last index are
+//    computed and counted in a single loop, followed by a branch-free
+//    compaction of the survivors (if there are any). The loop over the last
+//    index is vectorized when compiling for AVX (e.g. with
+//    PHYSICS_NATIVE_ARCH) or with -fno-trapping-math, as for the fast
+//    kinematics.
+//  * The versions for many events take a std::vector of events (and of
+//    masks) and a thread_pool, and process blocks of events in parallel. The
+//    result holds one combination_list per event, in the order of the events,
+//    and does not depend on the size of the pool.
+//  * A mask with a different size than its event (or a different number of
+//    masks and events) throws a combinatorics_error.
+// =============================================================================
+namespace physics {
+
+class combinatorics_error;
+
+namespace combinatorics_impl {
+template <class Q, class R>
+using mass_t = decltype(std::declval<lorentzvector<Q, R>>().mag());
+} // namespace combinatorics_impl
+
+// closed mass interval [low, high], unbounded by default
+template <class Mass> class mass_window {
+public:
+  mass_window()
+      : low_{-std::numeric_limits<double>::infinity()}
+      , high_{std::numeric_limits<double>::infinity()} {}
+  mass_window(Mass low, Mass high) : low_{low}, high_{high} {}
+
+  Mass low() const { return low_; }
+  Mass high() const { return high_; }
+  bool contains(Mass m) const { return low_ <= m && m <= high_; }
+
+private:
+  Mass low_;
+  Mass high_;
+};
+
+// index tuples and invariant masses of the selected combinations
+template <std::size_t K, class Mass> struct combination_list {
+  using index_type = std::array<std::size_t, K>;
+  using mass_type = Mass;
+
+  std::vector<index_type> indices;
+  vector_array_impl::column_array_t<Mass> mass;
+
+  std::size_t size() const { return indices.size(); }
+  bool empty() const { return indices.empty(); }
+};
+
+namespace combinatorics_impl {
+template <class T> struct is_mass_window : std::false_type {};
+template <class Mass>
+struct is_mass_window<mass_window<Mass>> : std::true_type {};
+template <class Mask>
+using enable_if_mask =
+    typename std::enable_if<!is_mass_window<Mask>::value>::type;
+template <std::size_t K, class Q, class R>
+using combination_list_t = combination_list<K, mass_t<Q, R>>;
+} // namespace combinatorics_impl
+
+// 1. single event
+template <std::size_t K, class Q, class R>
+auto combinations(const lorentzvector_array<Q, R>& particles,
+                  const mass_window<combinatorics_impl::mass_t<Q, R>>&
+                      window = {});
+template <std::size_t K, class Q, class R, class Mask,
+          class = combinatorics_impl::enable_if_mask<Mask>>
+auto combinations(const lorentzvector_array<Q, R>& particles,
+                  const Mask& mask,
+                  const mass_window<combinatorics_impl::mass_t<Q, R>>&
+                      window = {});
+// 2. many events, in parallel
+template <std::size_t K, class Q, class R>
+auto combinations(const std::vector<lorentzvector_array<Q, R>>& events,
+                  thread_pool& pool,
+                  const mass_window<combinatorics_impl::mass_t<Q, R>>&
+                      window = {});
+template <std::size_t K, class Q, class R, class Mask>
+auto combinations(const std::vector<lorentzvector_array<Q, R>>& events,
+                  const std::vector<Mask>& masks, thread_pool& pool,
+                  const mass_window<combinatorics_impl::mass_t<Q, R>>&
+                      window = {});
+
+class combinatorics_error : public physics::exception {
+public:
+  combinatorics_error(const std::string& msg,
+                      const std::string& type = "combinatorics_error")
+      : physics::exception{msg, type} {}
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: combination kernels
+// =============================================================================
+namespace physics {
+namespace combinatorics_impl {
+// masks that select everything
+struct select_all {
+  constexpr bool operator[](std::size_t) const { return true; }
+};
+struct select_all_events {
+  constexpr select_all operator[](std::size_t) const { return {}; }
+};
+
+// scratch space for one event: the selected particles as raw (x0, x1, x2, x3)
+// columns with their original indices, and the per-candidate buffers
+struct workspace {
+  aligned_vector<double> x[4];
+  std::vector<std::size_t> index;
+  aligned_vector<double> mass2;
+  std::vector<std::size_t> survivors;
+};
+
+template <class Q, class R, class Mask>
+void select(const lorentzvector_array<Q, R>& particles, const Mask& mask,
+            workspace& w) {
+  for (auto& column : w.x) {
+    column.clear();
+  }
+  w.index.clear();
+  for (std::size_t i = 0; i < particles.size(); ++i) {
+    if (mask[i]) {
+      w.x[0].push_back(vector_impl::raw(particles.x0()[i]));
+      w.x[1].push_back(vector_impl::raw(particles.x().x1()[i]));
+      w.x[2].push_back(vector_impl::raw(particles.x().x2()[i]));
+      w.x[3].push_back(vector_impl::raw(particles.x().x3()[i]));
+      w.index.push_back(i);
+    }
+  }
+  w.mass2.resize(w.index.size());
+  w.survivors.resize(w.index.size());
+}
+
+// squared masses of s + p[j] for the candidates j in [first, n), followed by
+// the compaction of the candidates with lo2 <= mass2 <= hi2 into
+// w.survivors. Returns the number of survivors.
+inline std::size_t last_index(workspace& w, const double (&s)[4],
+                              std::size_t first, double lo2, double hi2) {
+  const std::size_t n{w.index.size()};
+  const double* x0{vector_array_impl::aligned(w.x[0].data())};
+  const double* x1{vector_array_impl::aligned(w.x[1].data())};
+  const double* x2{vector_array_impl::aligned(w.x[2].data())};
+  const double* x3{vector_array_impl::aligned(w.x[3].data())};
+  double* m2{vector_array_impl::aligned(w.mass2.data())};
+  const double s0{s[0]}, s1{s[1]}, s2{s[2]}, s3{s[3]};
+  std::size_t count{0};
+  for (std::size_t j = first; j < n; ++j) {
+    const double y0{s0 + x0[j]};
+    const double y1{s1 + x1[j]};
+    const double y2{s2 + x2[j]};
+    const double y3{s3 + x3[j]};
+    m2[j] = y0 * y0 - (y1 * y1 + y2 * y2 + y3 * y3);
+    count += (lo2 <= m2[j]) & (m2[j] <= hi2);
+  }
+  // (the compaction is scalar, and skipped if nothing survives)
+  if (count == 0) {
+    return 0;
+  }
+  std::size_t* survivors{w.survivors.data()};
+  count = 0;
+  for (std::size_t j = first; j < n; ++j) {
+    survivors[count] = j;
+    count += (lo2 <= m2[j]) & (m2[j] <= hi2);
+  }
+  return count;
+}
+
+// enumerate the indices from depth on, with s the sum of the particles that
+// are already part of the combination
+template <std::size_t K, class Mass>
+void enumerate(workspace& w, std::size_t depth, std::size_t first,
+               const double (&s)[4], std::array<std::size_t, K>& idx,
+               double lo2, double hi2, combination_list<K, Mass>& result) {
+  const std::size_t n{w.index.size()};
+  if (depth + 1 == K) {
+    const std::size_t count{last_index(w, s, first, lo2, hi2)};
+    for (std::size_t k = 0; k < count; ++k) {
+      const std::size_t j{w.survivors[k]};
+      const double m2{w.mass2[j]};
+      idx[K - 1] = w.index[j];
+      result.indices.push_back(idx);
+      result.mass.push_back(
+          Mass{m2 >= 0 ? std::sqrt(m2) : -std::sqrt(-m2)});
+    }
+    return;
+  }
+  for (std::size_t i = first; i + K - depth <= n; ++i) {
+    idx[depth] = w.index[i];
+    const double t[4]{s[0] + w.x[0][i], s[1] + w.x[1][i], s[2] + w.x[2][i],
+                      s[3] + w.x[3][i]};
+    enumerate(w, depth + 1, i + 1, t, idx, lo2, hi2, result);
+  }
+}
+
+// signed square, monotonic like the signed mag() of a lorentzvector
+inline double signed_square(double m) { return m < 0 ? -m * m : m * m; }
+
+template <std::size_t K, class Q, class R, class Mask>
+auto combine(const lorentzvector_array<Q, R>& particles, const Mask& mask,
+             const mass_window<mass_t<Q, R>>& window, workspace& w) {
+  static_assert(K > 0, "Combinations need at least one particle.");
+  combination_list_t<K, Q, R> result;
+  select(particles, mask, w);
+  if (w.index.size() < K) {
+    return result;
+  }
+  std::array<std::size_t, K> idx{};
+  const double s[4]{0., 0., 0., 0.};
+  enumerate(w, 0, 0, s, idx, signed_square(vector_impl::raw(window.low())),
+            signed_square(vector_impl::raw(window.high())), result);
+  return result;
+}
+
+template <class Mask>
+void check_mask(const Mask& mask, std::size_t n, std::size_t event) {
+  if (mask.size() != n) {
+    throw combinatorics_error{"mask size mismatch for event " +
+                                  std::to_string(event) + " (" +
+                                  std::to_string(mask.size()) + " vs. " +
+                                  std::to_string(n) + " particles)",
+                              "combinatorics_size_error"};
+  }
+}
+
+// blocks of events per thread, to balance events with very different numbers
+// of combinations
+constexpr std::size_t blocks_per_thread{4};
+
+template <std::size_t K, class Q, class R, class Masks>
+auto combine_events(const std::vector<lorentzvector_array<Q, R>>& events,
+                    const Masks& masks, thread_pool& pool,
+                    const mass_window<mass_t<Q, R>>& window) {
+  const std::size_t n{events.size()};
+  std::vector<combination_list_t<K, Q, R>> results(n);
+  const std::size_t n_blocks{std::max<std::size_t>(
+      1, std::min(n, blocks_per_thread * pool.size()))};
+  std::vector<std::future<void>> blocks;
+  blocks.reserve(n_blocks);
+  for (std::size_t b = 0; b < n_blocks; ++b) {
+    const std::size_t begin{n * b / n_blocks};
+    const std::size_t end{n * (b + 1) / n_blocks};
+    blocks.push_back(pool.submit([&, begin, end] {
+      workspace w;
+      for (std::size_t e = begin; e < end; ++e) {
+        results[e] = combine<K>(events[e], masks[e], window, w);
+      }
+    }));
+  }
+  // wait for all blocks before re-throwing any exception, as they write to
+  // results
+  for (auto& block : blocks) {
+    block.wait();
+  }
+  for (auto& block : blocks) {
+    block.get();
+  }
+  return results;
+}
+} // namespace combinatorics_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: combinations
+// =============================================================================
+namespace physics {
+template <std::size_t K, class Q, class R>
+auto combinations(
+    const lorentzvector_array<Q, R>& particles,
+    const mass_window<combinatorics_impl::mass_t<Q, R>>& window) {
+  combinatorics_impl::workspace w;
+  return combinatorics_impl::combine<K>(
+      particles, combinatorics_impl::select_all{}, window, w);
+}
+template <std::size_t K, class Q, class R, class Mask, class>
+auto combinations(
+    const lorentzvector_array<Q, R>& particles, const Mask& mask,
+    const mass_window<combinatorics_impl::mass_t<Q, R>>& window) {
+  combinatorics_impl::check_mask(mask, particles.size(), 0);
+  combinatorics_impl::workspace w;
+  return combinatorics_impl::combine<K>(particles, mask, window, w);
+}
+template <std::size_t K, class Q, class R>
+auto combinations(
+    const std::vector<lorentzvector_array<Q, R>>& events, thread_pool& pool,
+    const mass_window<combinatorics_impl::mass_t<Q, R>>& window) {
+  return combinatorics_impl::combine_events<K>(
+      events, combinatorics_impl::select_all_events{}, pool, window);
+}
+template <std::size_t K, class Q, class R, class Mask>
+auto combinations(
+    const std::vector<lorentzvector_array<Q, R>>& events,
+    const std::vector<Mask>& masks, thread_pool& pool,
+    const mass_window<combinatorics_impl::mass_t<Q, R>>& window) {
+  if (masks.size() != events.size()) {
+    throw combinatorics_error{
+        "number of masks and events differ (" + std::to_string(masks.size()) +
+            " vs. " + std::to_string(events.size()) + ")",
+        "combinatorics_size_error"};
+  }
+  for (std::size_t e = 0; e < events.size(); ++e) {
+    combinatorics_impl::check_mask(masks[e], events[e].size(), e);
+  }
+  return combinatorics_impl::combine_events<K>(events, masks, pool, window);
+}
+} // namespace physics
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef PHYSICS_VECTOR_GRID_HASH_LOADED
+#define PHYSICS_VECTOR_GRID_HASH_LOADED
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <physics/util/exception.hh>
+#include <physics/util/span.hh>
+#include <physics/vector.hh>
+#include <physics/vector/array.hh>
+
+// =============================================================================
+// grid_hash<Quantity, Radian>: uniform 3D grid of cubic cells over
+// physics::vector positions, hashed into buckets, for neighbour searches in
+// data that is rebuilt for every event
+//
+// grid_hash<Q> grid{cell_size} creates an empty grid, grid.build(points)
+// sorts the points (a span of vector<Q>, or a vector_array<Q>) into the
+// cells, and replaces the points of the previous build.
+// grid.for_each_within(center, radius, f) calls f(i) for every point i with
+// |point - center| <= radius, grid.within(center, radius) returns these
+// indices, and grid.for_each_pair(cutoff, f) calls f(i, j) once for every pair
+// of points i < j with |point_i - point_j| <= cutoff.
+//
+// Notes:
+//  * build() is O(N): a counting sort of the points by bucket, into arrays
+//    that keep their memory across builds (a build with at most as many
+//    points as before does not allocate). The grid does not refer to the
+//    points after build().
+//  * The cells are not bounded: the cell coordinates are hashed into (at
+//    least N) buckets, and the points store the coordinates of their cell, so
+//    points of different cells in the same bucket are skipped. Cell
+//    coordinates beyond +-2^20 are clamped to the outermost cells, which only
+//    makes these cells larger.
+//  * A query visits the cells that overlap the cube around the sphere, so the
+//    cost grows with (radius / cell size)^3; a cell size close to the typical
+//    search radius is best. Queries that would visit more cells than there
+//    are points check all points instead.
+//  * The radius and the cell size are Quantities, a cell size that is not
+//    positive throws a grid_hash_error.
+//  * within() and for_each_within() report the points in bucket order.
+// =============================================================================
+namespace physics {
+template <class Quantity, class Radian = double> class grid_hash;
+
+class grid_hash_error : public physics::exception {
+public:
+  grid_hash_error(const std::string& msg,
+                  const std::string& type = "grid_hash_error")
+      : physics::exception{msg, type} {}
+};
+
+namespace grid_hash_impl {
+struct entry {
+  double x[3];
+  std::uint64_t cell;
+  std::size_t index;
+};
+
+// the grid on raw values, see grid_hash
+class index {
+public:
+  explicit index(double cell_size);
+
+  double cell_size() const { return cell_size_; }
+  std::size_t size() const { return entries_.size(); }
+  // start a build with n points, then add all of them, and sort them into
+  // the buckets
+  void reset(std::size_t n);
+  void add(std::size_t i, double x1, double x2, double x3);
+  void sort();
+
+  template <class F>
+  void visit(const double* center, double radius, F&& f) const;
+  template <class F> void visit_pairs(double cutoff, F&& f) const;
+
+private:
+  std::int64_t coordinate(double x) const;
+  std::uint64_t bucket(std::uint64_t cell) const;
+
+  double cell_size_;
+  unsigned shift_{63};
+  // entries in input order while building, and sorted by bucket
+  std::vector<entry> unsorted_;
+  std::vector<entry> entries_;
+  std::vector<std::uint64_t> bucket_;
+  // entries of bucket b: entries_[start_[b]] ... entries_[start_[b+1]]
+  std::vector<std::size_t> start_;
+};
+} // namespace grid_hash_impl
+
+template <class Quantity, class Radian> class grid_hash {
+public:
+  using quantity_type = Quantity;
+  using radian_type = Radian;
+  using value_type = vector<Quantity, Radian>;
+  using size_type = std::size_t;
+
+  explicit grid_hash(quantity_type cell_size);
+
+  quantity_type cell_size() const { return quantity_type{index_.cell_size()}; }
+  size_type size() const { return index_.size(); }
+  bool empty() const { return index_.size() == 0; }
+
+  // sort the points into the grid
+  void build(span<const value_type> points);
+  void build(const vector_array<Quantity, Radian>& points);
+
+  // f(i) for the points with |point - center| <= radius
+  template <class F>
+  void for_each_within(const value_type& center, quantity_type radius,
+                       F&& f) const;
+  std::vector<size_type> within(const value_type& center,
+                                quantity_type radius) const;
+  void within(const value_type& center, quantity_type radius,
+              std::vector<size_type>& out) const;
+  // f(i, j) for the pairs i < j with |point_i - point_j| <= cutoff
+  template <class F> void for_each_pair(quantity_type cutoff, F&& f) const;
+
+private:
+  grid_hash_impl::index index_;
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: grid_hash_impl
+// =============================================================================
+namespace physics {
+namespace grid_hash_impl {
+// cell coordinates are stored in 21 bits each
+constexpr std::int64_t max_coordinate{(std::int64_t{1} << 20) - 1};
+
+inline index::index(double cell_size) : cell_size_{cell_size} {
+  if (!(cell_size > 0) || !std::isfinite(cell_size)) {
+    throw grid_hash_error{"invalid grid cell size " +
+                              std::to_string(cell_size) +
+                              " (has to be positive)",
+                          "grid_hash_size_error"};
+  }
+}
+inline std::int64_t index::coordinate(double x) const {
+  // (the comparisons also map NaN to the lowest cell)
+  const double c{std::floor(x / cell_size_)};
+  return !(c > -max_coordinate)
+             ? -max_coordinate
+             : c >= max_coordinate ? max_coordinate
+                                   : static_cast<std::int64_t>(c);
+}
+// Fibonacci hashing of the packed cell coordinates
+inline std::uint64_t index::bucket(std::uint64_t cell) const {
+  return (cell * std::uint64_t{0x9E3779B97F4A7C15}) >> shift_;
+}
+inline std::uint64_t pack(std::int64_t i1, std::int64_t i2, std::int64_t i3) {
+  const auto bits = [](std::int64_t i) {
+    return static_cast<std::uint64_t>(i + max_coordinate);
+  };
+  return bits(i1) << 42 | bits(i2) << 21 | bits(i3);
+}
+
+inline void index::reset(std::size_t n) {
+  unsigned bits{1};
+  while ((std::size_t{1} << bits) < n) {
+    ++bits;
+  }
+  shift_ = 64 - bits;
+  unsorted_.resize(n);
+  bucket_.resize(n);
+}
+inline void index::add(std::size_t i, double x1, double x2, double x3) {
+  const std::uint64_t cell{
+      pack(coordinate(x1), coordinate(x2), coordinate(x3))};
+  unsorted_[i] = {{x1, x2, x3}, cell, i};
+  bucket_[i] = bucket(cell);
+}
+inline void index::sort() {
+  const std::size_t n{unsorted_.size()};
+  const std::size_t n_buckets{std::size_t{1} << (64 - shift_)};
+  // count, then the start of every bucket, then place the entries: this
+  // moves the start of every bucket to the start of the next one
+  start_.assign(n_buckets + 1, 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    ++start_[bucket_[i]];
+  }
+  std::size_t sum{0};
+  for (std::size_t b = 0; b <= n_buckets; ++b) {
+    const std::size_t count{start_[b]};
+    start_[b] = sum;
+    sum += count;
+  }
+  entries_.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    entries_[start_[bucket_[i]]++] = unsorted_[i];
+  }
+  for (std::size_t b = n_buckets; b > 0; --b) {
+    start_[b] = start_[b - 1];
+  }
+  start_[0] = 0;
+}
+
+template <class F>
+void index::visit(const double* center, double radius, F&& f) const {
+  if (!(radius >= 0) || entries_.empty()) {
+    return;
+  }
+  const double r2{radius * radius};
+  const auto check = [&](const entry& e) {
+    const double d0{e.x[0] - center[0]}, d1{e.x[1] - center[1]},
+        d2{e.x[2] - center[2]};
+    if (d0 * d0 + d1 * d1 + d2 * d2 <= r2) {
+      f(e);
+    }
+  };
+  std::int64_t lo[3], hi[3];
+  double n_cells{1};
+  for (std::size_t a = 0; a < 3; ++a) {
+    lo[a] = coordinate(center[a] - radius);
+    hi[a] = coordinate(center[a] + radius);
+    n_cells *= static_cast<double>(hi[a] - lo[a] + 1);
+  }
+  if (n_cells >= static_cast<double>(entries_.size())) {
+    for (const entry& e : entries_) {
+      check(e);
+    }
+    return;
+  }
+  for (std::int64_t i1 = lo[0]; i1 <= hi[0]; ++i1) {
+    for (std::int64_t i2 = lo[1]; i2 <= hi[1]; ++i2) {
+      for (std::int64_t i3 = lo[2]; i3 <= hi[2]; ++i3) {
+        const std::uint64_t cell{pack(i1, i2, i3)};
+        const std::uint64_t b{bucket(cell)};
+        for (std::size_t k = start_[b]; k < start_[b + 1]; ++k) {
+          if (entries_[k].cell == cell) {
+            check(entries_[k]);
+          }
+        }
+      }
+    }
+  }
+}
+template <class F> void index::visit_pairs(double cutoff, F&& f) const {
+  for (const entry& e : entries_) {
+    visit(e.x, cutoff, [&](const entry& other) {
+      if (e.index < other.index) {
+        f(e.index, other.index);
+      }
+    });
+  }
+}
+} // namespace grid_hash_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: grid_hash
+// =============================================================================
+namespace physics {
+template <class Q, class R>
+grid_hash<Q, R>::grid_hash(quantity_type cell_size)
+    : index_{vector_impl::raw(cell_size)} {}
+
+template <class Q, class R>
+void grid_hash<Q, R>::build(span<const value_type> points) {
+  index_.reset(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    index_.add(i, vector_impl::raw(points[i].x1),
+               vector_impl::raw(points[i].x2), vector_impl::raw(points[i].x3));
+  }
+  index_.sort();
+}
+template <class Q, class R>
+void grid_hash<Q, R>::build(const vector_array<Q, R>& points) {
+  index_.reset(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    index_.add(i, vector_impl::raw(points.x1()[i]),
+               vector_impl::raw(points.x2()[i]),
+               vector_impl::raw(points.x3()[i]));
+  }
+  index_.sort();
+}
+
+template <class Q, class R>
+template <class F>
+void grid_hash<Q, R>::for_each_within(const value_type& center,
+                                      quantity_type radius, F&& f) const {
+  const double c[3]{vector_impl::raw(center.x1), vector_impl::raw(center.x2),
+                    vector_impl::raw(center.x3)};
+  index_.visit(c, vector_impl::raw(radius),
+               [&f](const grid_hash_impl::entry& e) { f(e.index); });
+}
+template <class Q, class R>
+std::vector<std::size_t> grid_hash<Q, R>::within(const value_type& center,
+                                                 quantity_type radius) const {
+  std::vector<size_type> out;
+  within(center, radius, out);
+  return out;
+}
+template <class Q, class R>
+void grid_hash<Q, R>::within(const value_type& center, quantity_type radius,
+                             std::vector<size_type>& out) const {
+  out.clear();
+  for_each_within(center, radius, [&out](size_type i) { out.push_back(i); });
+}
+template <class Q, class R>
+template <class F>
+void grid_hash<Q, R>::for_each_pair(quantity_type cutoff, F&& f) const {
+  index_.visit_pairs(vector_impl::raw(cutoff), f);
+}
+} // namespace physics
+
+#endif
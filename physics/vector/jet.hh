@@ -0,0 +1,723 @@
+#ifndef PHYSICS_VECTOR_JET_LOADED
+#define PHYSICS_VECTOR_JET_LOADED
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <physics/util/exception.hh>
+#include <physics/util/span.hh>
+#include <physics/vector.hh>
+#include <physics/vector/array.hh>
+
+// =============================================================================
+// cluster(): sequential recombination jet clustering with the generalized-kt
+// family of algorithms (kt, Cambridge/Aachen and anti-kt)
+//
+// The distances are d_ij = min(k_i, k_j) dR_ij^2 / R^2 and d_iB = k_i, with
+// k = pt^2 (kt), 1 (Cambridge/Aachen) or 1 / pt^2 (anti-kt), and dR_ij^2 =
+// (y_i - y_j)^2 + (phi_i - phi_j)^2 in rapidity and azimuth. The pair with the
+// smallest d_ij is merged by adding the lorentzvectors (E-scheme), a particle
+// with the smallest d_iB becomes a jet.
+//
+// cluster(particles, jet_definition{algorithm, R}) takes a lorentzvector_array
+// or a std::vector of lorentzvectors, and returns a jet_list with the
+// (inclusive) jets, ordered by decreasing pt, and the indices of the particles
+// in every jet.
+//
+// Notes:
+//  * The smallest distance is found with the geometric nearest neighbour of
+//    every jet: the pair with the smallest d_ij is also a pair of geometric
+//    nearest neighbours, and only neighbours with dR < R can merge. The
+//    (y, phi) plane is divided into tiles of a few particles each (and at
+//    least R / 4 wide), and a search only visits the tiles closer than the
+//    best distance found so far. Every jet keeps the list of the jets that
+//    have it as their nearest neighbour, and every tile an upper bound of the
+//    nearest neighbour distances of its jets, so a recombination only
+//    searches again for the jets that lost their neighbour, and only checks
+//    the tiles with a jet that can be closer to the merged jet than to its
+//    neighbour. The d_ij of all jets are kept in a tournament tree, so the
+//    smallest one is found in O(1) and updated in O(log N).
+//  * The lorentzvectors are processed in their raw values, the jets have the
+//    same Quantity as the particles.
+//  * Particles without transverse momentum (and their rapidity, if they have
+//    no mass either) follow the conventions of FastJet: phi = 0, and the
+//    rapidity of a massless particle along the beam is +-(1e5 + |x3|).
+//  * A jet_definition with a radius that is not positive throws a jet_error.
+// =============================================================================
+namespace physics {
+
+class jet_error;
+
+enum class jet_algorithm { kt, cambridge_aachen, antikt };
+
+class jet_definition {
+public:
+  jet_definition(jet_algorithm algorithm, double radius);
+
+  jet_algorithm algorithm() const { return algorithm_; }
+  double radius() const { return radius_; }
+
+private:
+  jet_algorithm algorithm_;
+  double radius_;
+};
+
+// jets and the indices of their constituents
+template <class Quantity, class Radian = double> struct jet_list {
+  using value_type = lorentzvector<Quantity, Radian>;
+
+  std::vector<value_type> jets;
+  // the constituents of jet i are indices[offsets[i]] ... indices[offsets[i+1]]
+  std::vector<std::size_t> offsets{0};
+  std::vector<std::size_t> indices;
+
+  std::size_t size() const { return jets.size(); }
+  bool empty() const { return jets.empty(); }
+  const value_type& operator[](std::size_t i) const { return jets[i]; }
+  // sorted particle indices of jet i
+  span<const std::size_t> constituents(std::size_t i) const {
+    return {indices.data() + offsets[i], offsets[i + 1] - offsets[i]};
+  }
+};
+
+template <class Q, class R>
+jet_list<Q, R> cluster(const lorentzvector_array<Q, R>& particles,
+                       const jet_definition& definition);
+template <class Q, class R>
+jet_list<Q, R> cluster(const std::vector<lorentzvector<Q, R>>& particles,
+                       const jet_definition& definition);
+
+class jet_error : public physics::exception {
+public:
+  jet_error(const std::string& msg, const std::string& type = "jet_error")
+      : physics::exception{msg, type} {}
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: tiled clustering
+// =============================================================================
+namespace physics {
+namespace jet_impl {
+constexpr std::size_t none{std::numeric_limits<std::size_t>::max()};
+constexpr double pi{3.14159265358979323846};
+// rapidity of massless particles along the beam (as in FastJet)
+constexpr double max_rapidity{1e5};
+// rapidity range covered by the tiles, the outer tiles extend to infinity
+constexpr double max_tiled_rapidity{10.};
+// average number of particles per tile, and the smallest tiles (R /
+// max_tiles_per_radius, which limits the tiles searched within R)
+constexpr double tile_occupancy{8.};
+constexpr double max_tiles_per_radius{4.};
+
+// four-momentum in raw values
+struct momentum {
+  double e;
+  double px;
+  double py;
+  double pz;
+};
+
+// complete binary tree over the values, every node holds the smallest value
+// below it and its index (the first one for equal values)
+class min_tree {
+public:
+  explicit min_tree(const std::vector<double>& values);
+
+  std::size_t min_index() const { return node_[1].index; }
+  void update(std::size_t i, double value);
+
+private:
+  struct node {
+    double value;
+    std::size_t index;
+  };
+  std::size_t n_leaves_;
+  std::vector<node> node_;
+};
+
+// the clustering state: pseudojets (the particles, followed by all
+// recombinations) and the active jets, by slot
+class tiled_clustering {
+public:
+  tiled_clustering(const jet_definition& definition,
+                   std::vector<momentum> particles);
+
+  // cluster all particles, returns the pseudojets of the final jets
+  std::vector<std::size_t> run();
+  const momentum& pseudojet(std::size_t i) const { return pseudojets_[i]; }
+  // append the particle indices of pseudojet i to out
+  void constituents(std::size_t i, std::vector<std::size_t>& out) const;
+
+private:
+  using slot_type = std::uint32_t;
+  static constexpr slot_type no_slot{std::numeric_limits<slot_type>::max()};
+
+  void set_kinematics(slot_type slot);
+  void make_tiles();
+  void layout_tiles();
+  std::size_t tile_index(double y, double phi) const;
+  void insert(slot_type slot);
+  void remove(slot_type slot);
+  template <class Visit>
+  void visit_tiles(double y, double phi, std::size_t tile, const double& limit,
+                   Visit visit) const;
+  void set_neighbour(slot_type slot, slot_type nn, double dist);
+  void unlink(slot_type slot);
+  void find_neighbour(slot_type slot, slot_type nn, double nn_dist);
+  double dij(slot_type slot) const;
+
+  // an active jet: rapidity, azimuth, momentum factor k, nearest neighbour
+  // and its distance dR^2, pseudojet, tile and position in the tile, and the
+  // jets that have it as their nearest neighbour, as a linked list (in one
+  // cache line)
+  struct active_jet {
+    double y;
+    double phi;
+    double k;
+    double nn_dist;
+    slot_type nn;
+    slot_type pseudojet;
+    slot_type tile;
+    slot_type position;
+    slot_type rnn_first;
+    slot_type rnn_next;
+    slot_type rnn_prev;
+  };
+  // entry of a jet in its tile
+  struct tile_entry {
+    double y;
+    double phi;
+    slot_type slot;
+  };
+  // the entries of a tile, with room for capacity entries from begin, and an
+  // upper bound of the nearest neighbour distance of its jets
+  struct tile {
+    std::size_t begin;
+    std::size_t size;
+    std::size_t capacity;
+    double max;
+  };
+
+  jet_algorithm algorithm_;
+  double r2_;
+  // largest momentum factor, so that every d_ij (times R^2) is finite, and
+  // below the infinite d_ij of the removed jets
+  double k_max_;
+  std::vector<momentum> pseudojets_;
+  std::vector<std::size_t> parent1_;
+  std::vector<std::size_t> parent2_;
+  std::vector<active_jet> jets_;
+  // tiles: (y, phi) grid, and the jets of every tile in one array
+  double y_min_;
+  double tile_y_;
+  double tile_phi_;
+  // (margin of the distance bounds of the tiles, for rounding)
+  double slack_;
+  std::size_t n_y_;
+  std::size_t n_phi_;
+  std::vector<tile> tiles_;
+  std::vector<tile_entry> entries_;
+  // jets that had a removed jet as their nearest neighbour
+  std::vector<slot_type> pending_;
+};
+
+inline min_tree::min_tree(const std::vector<double>& values) {
+  n_leaves_ = 1;
+  while (n_leaves_ < values.size()) {
+    n_leaves_ *= 2;
+  }
+  node_.resize(2 * n_leaves_);
+  for (std::size_t i = 0; i < n_leaves_; ++i) {
+    node_[n_leaves_ + i] = {i < values.size()
+                                ? values[i]
+                                : std::numeric_limits<double>::infinity(),
+                            i};
+  }
+  for (std::size_t p = n_leaves_ - 1; p > 0; --p) {
+    const node& a{node_[2 * p]};
+    const node& b{node_[2 * p + 1]};
+    node_[p] = b.value < a.value ? b : a;
+  }
+}
+inline void min_tree::update(std::size_t i, double value) {
+  node_[n_leaves_ + i].value = value;
+  for (std::size_t p = (n_leaves_ + i) / 2; p > 0; p /= 2) {
+    const node& a{node_[2 * p]};
+    const node& b{node_[2 * p + 1]};
+    const node& smallest{b.value < a.value ? b : a};
+    // (the nodes above can only change if this one does, or holds i)
+    if (smallest.index == node_[p].index && smallest.index != i) {
+      break;
+    }
+    node_[p] = smallest;
+  }
+}
+
+constexpr tiled_clustering::slot_type tiled_clustering::no_slot;
+
+inline tiled_clustering::tiled_clustering(const jet_definition& definition,
+                                          std::vector<momentum> particles)
+    : algorithm_{definition.algorithm()}
+    , r2_{definition.radius() * definition.radius()}
+    , k_max_{std::numeric_limits<double>::max() / (2 * std::max(r2_, 1.))}
+    , pseudojets_(std::move(particles)) {
+  const std::size_t n{pseudojets_.size()};
+  // (the pseudojets of the active jets are stored as slot_type)
+  if (n > no_slot / 2) {
+    throw jet_error{"too many particles (" + std::to_string(n) + ")",
+                    "jet_size_error"};
+  }
+  pseudojets_.reserve(2 * n);
+  parent1_.assign(n, none);
+  parent2_.assign(n, none);
+  parent1_.reserve(2 * n);
+  parent2_.reserve(2 * n);
+  jets_.resize(n);
+  for (slot_type i = 0; i < n; ++i) {
+    active_jet& j = jets_[i];
+    j.pseudojet = i;
+    j.nn = no_slot;
+    j.rnn_first = no_slot;
+    j.rnn_next = no_slot;
+    j.rnn_prev = no_slot;
+    set_kinematics(i);
+  }
+  make_tiles();
+}
+// rapidity, azimuth and momentum factor of the jet in slot
+inline void tiled_clustering::set_kinematics(slot_type slot) {
+  active_jet& j = jets_[slot];
+  const momentum& p{pseudojets_[j.pseudojet]};
+  const double pt2{p.px * p.px + p.py * p.py};
+  if (p.e == std::fabs(p.pz) && pt2 == 0) {
+    const double y{max_rapidity + std::fabs(p.pz)};
+    j.y = p.pz < 0 ? -y : y;
+  } else {
+    const double m2{std::max(0., (p.e + p.pz) * (p.e - p.pz) - pt2)};
+    const double e_plus_pz{p.e + std::fabs(p.pz)};
+    const double y{0.5 * std::log((pt2 + m2) / (e_plus_pz * e_plus_pz))};
+    j.y = p.pz > 0 ? -y : y;
+  }
+  double phi{pt2 == 0 ? 0. : std::atan2(p.py, p.px)};
+  if (phi < 0) {
+    phi += 2 * pi;
+  }
+  if (phi >= 2 * pi) {
+    phi -= 2 * pi;
+  }
+  j.phi = phi;
+  switch (algorithm_) {
+  case jet_algorithm::kt:
+    j.k = std::min(pt2, k_max_);
+    break;
+  case jet_algorithm::cambridge_aachen:
+    j.k = 1.;
+    break;
+  case jet_algorithm::antikt:
+    j.k = pt2 > 0 ? std::min(1. / pt2, k_max_) : k_max_;
+    break;
+  }
+}
+// tiles of about tile_occupancy particles over the rapidity range of the
+// particles, with room for the particles in every tile
+inline void tiled_clustering::make_tiles() {
+  const double r{std::sqrt(r2_)};
+  double y_lo{max_tiled_rapidity}, y_hi{-max_tiled_rapidity};
+  for (const active_jet& j : jets_) {
+    y_lo = std::min(y_lo, j.y);
+    y_hi = std::max(y_hi, j.y);
+  }
+  y_lo = std::max(y_lo, -max_tiled_rapidity);
+  y_hi = std::min(y_hi, max_tiled_rapidity);
+  const double area{std::max(y_hi - y_lo, r) * 2 * pi};
+  const double size{std::max(
+      std::sqrt(tile_occupancy * area / std::max<std::size_t>(jets_.size(), 1)),
+      r / max_tiles_per_radius)};
+  n_y_ = y_hi - y_lo >= 2 * size
+             ? static_cast<std::size_t>(std::floor((y_hi - y_lo) / size))
+             : 1;
+  y_min_ = y_lo;
+  tile_y_ = n_y_ > 1 ? (y_hi - y_lo) / n_y_ : 1.;
+  n_phi_ = std::max<std::size_t>(
+      1, static_cast<std::size_t>(std::floor(2 * pi / size)));
+  tile_phi_ = 2 * pi / n_phi_;
+  slack_ = 1e-9 * size;
+  tiles_.assign(n_y_ * n_phi_, {0, 0, 0, 0.});
+  for (const active_jet& j : jets_) {
+    ++tiles_[tile_index(j.y, j.phi)].capacity;
+  }
+  std::size_t first{0};
+  for (tile& t : tiles_) {
+    t.begin = first;
+    t.capacity += t.capacity / 2 + 2;
+    first += t.capacity;
+  }
+  entries_.resize(first);
+}
+// new room in every tile, when a tile is full
+inline void tiled_clustering::layout_tiles() {
+  std::size_t total{0};
+  for (const tile& t : tiles_) {
+    total += t.size + t.size / 2 + 2;
+  }
+  std::vector<tile_entry> entries(total);
+  std::size_t first{0};
+  for (tile& t : tiles_) {
+    std::copy(entries_.begin() + t.begin, entries_.begin() + t.begin + t.size,
+              entries.begin() + first);
+    t.begin = first;
+    t.capacity = t.size + t.size / 2 + 2;
+    first += t.capacity;
+  }
+  entries_.swap(entries);
+}
+inline std::size_t tiled_clustering::tile_index(double y, double phi) const {
+  // (the comparisons also map NaN to the first tile)
+  const double ty{(y - y_min_) / tile_y_};
+  const double tphi{phi / tile_phi_};
+  const std::size_t iy{!(ty >= 1) ? 0 : ty >= n_y_ - 1
+                                             ? n_y_ - 1
+                                             : static_cast<std::size_t>(ty)};
+  const std::size_t iphi{!(tphi >= 1) ? 0 : tphi >= n_phi_ - 1
+                                                ? n_phi_ - 1
+                                                : static_cast<std::size_t>(tphi)};
+  return iy * n_phi_ + iphi;
+}
+inline void tiled_clustering::insert(slot_type slot) {
+  active_jet& j = jets_[slot];
+  const std::size_t t{tile_index(j.y, j.phi)};
+  if (tiles_[t].size == tiles_[t].capacity) {
+    layout_tiles();
+  }
+  tile& current{tiles_[t]};
+  j.tile = static_cast<slot_type>(t);
+  j.position = static_cast<slot_type>(current.size);
+  entries_[current.begin + current.size++] = {j.y, j.phi, slot};
+}
+inline void tiled_clustering::remove(slot_type slot) {
+  const active_jet& j = jets_[slot];
+  tile& current{tiles_[j.tile]};
+  tile_entry* entries{&entries_[current.begin]};
+  const tile_entry last{entries[--current.size]};
+  entries[j.position] = last;
+  jets_[last.slot].position = j.position;
+}
+// dR^2, with the distance in phi folded into [0, pi] without a branch
+inline double distance(double y1, double phi1, double y2, double phi2) {
+  const double dy{y1 - y2};
+  const double dphi{pi - std::fabs(pi - std::fabs(phi1 - phi2))};
+  return dy * dy + dphi * dphi;
+}
+// call visit(tile, gap2) for the tiles that can have jets with dR^2 < limit
+// to (y, phi), with a lower bound gap2 of their dR^2. The rows are visited
+// outwards from the tile of (y, phi), and within a row the columns outwards
+// in both directions up to half way round, so the bounds only grow, and
+// the search stops at the first tile that is too far.
+template <class Visit>
+inline void tiled_clustering::visit_tiles(double y, double phi,
+                                          std::size_t tile,
+                                          const double& limit,
+                                          Visit visit) const {
+  const std::size_t iy{tile / n_phi_}, iphi{tile % n_phi_};
+  const std::size_t right{n_phi_ / 2}, left{n_phi_ - 1 - right};
+  // distance to the edges of the column of (y, phi)
+  const double hi{(iphi + 1) * tile_phi_ - phi}, lo{phi - iphi * tile_phi_};
+  const auto row = [&](std::size_t jy, double gap) {
+    const double gap2{gap * gap};
+    if (!(gap2 < limit)) {
+      return false;
+    }
+    const std::size_t first{jy * n_phi_};
+    visit(first + iphi, gap2);
+    // (the other way round is shorter for the columns beyond pi)
+    for (std::size_t j = 1; j <= right; ++j) {
+      const std::size_t column{iphi + j < n_phi_ ? iphi + j
+                                                 : iphi + j - n_phi_};
+      const double g{std::max(
+          0., std::min((j - 1) * tile_phi_ + hi, 2 * pi - j * tile_phi_ - hi) -
+                  slack_)};
+      if (!(gap2 + g * g < limit)) {
+        break;
+      }
+      visit(first + column, gap2 + g * g);
+    }
+    for (std::size_t j = 1; j <= left; ++j) {
+      const std::size_t column{iphi >= j ? iphi - j : iphi + n_phi_ - j};
+      const double g{std::max(
+          0., std::min((j - 1) * tile_phi_ + lo, 2 * pi - j * tile_phi_ - lo) -
+                  slack_)};
+      if (!(gap2 + g * g < limit)) {
+        break;
+      }
+      visit(first + column, gap2 + g * g);
+    }
+    return true;
+  };
+  // (the first and last rows extend to infinity)
+  row(iy, 0.);
+  for (std::size_t jy = iy + 1;
+       jy < n_y_ && row(jy, std::max(0., y_min_ + jy * tile_y_ - y - slack_));
+       ++jy) {
+  }
+  for (std::size_t jy = iy;
+       jy > 0 && row(jy - 1, std::max(0., y - y_min_ - jy * tile_y_ - slack_));
+       --jy) {
+  }
+}
+// set the nearest neighbour of slot, and move it to the list of the
+// neighbour
+inline void tiled_clustering::set_neighbour(slot_type slot, slot_type nn,
+                                            double dist) {
+  active_jet& j = jets_[slot];
+  if (nn != j.nn) {
+    unlink(slot);
+    j.nn = nn;
+    if (nn != no_slot) {
+      active_jet& neighbour = jets_[nn];
+      j.rnn_prev = no_slot;
+      j.rnn_next = neighbour.rnn_first;
+      if (neighbour.rnn_first != no_slot) {
+        jets_[neighbour.rnn_first].rnn_prev = slot;
+      }
+      neighbour.rnn_first = slot;
+    }
+  }
+  j.nn_dist = dist;
+  tile& t{tiles_[j.tile]};
+  t.max = std::max(t.max, dist);
+}
+// remove slot from the list of its nearest neighbour (it has none after)
+inline void tiled_clustering::unlink(slot_type slot) {
+  active_jet& j = jets_[slot];
+  if (j.nn == no_slot) {
+    return;
+  }
+  (j.rnn_prev == no_slot ? jets_[j.nn].rnn_first
+                         : jets_[j.rnn_prev].rnn_next) = j.rnn_next;
+  if (j.rnn_next != no_slot) {
+    jets_[j.rnn_next].rnn_prev = j.rnn_prev;
+  }
+  j.nn = no_slot;
+}
+// nearest neighbour with dR < R, or the candidate nn at nn_dist if there is
+// none closer
+inline void tiled_clustering::find_neighbour(slot_type slot, slot_type nn,
+                                             double nn_dist) {
+  const double y{jets_[slot].y}, phi{jets_[slot].phi};
+  visit_tiles(y, phi, jets_[slot].tile, nn_dist, [&](std::size_t t, double) {
+    const tile_entry* e{&entries_[tiles_[t].begin]};
+    for (const tile_entry* end = e + tiles_[t].size; e != end; ++e) {
+      const double d{distance(y, phi, e->y, e->phi)};
+      if (d < nn_dist && e->slot != slot) {
+        nn_dist = d;
+        nn = e->slot;
+      }
+    }
+  });
+  set_neighbour(slot, nn, nn_dist);
+}
+// d_ij with the nearest neighbour (or d_iB), times R^2
+inline double tiled_clustering::dij(slot_type slot) const {
+  const active_jet& j = jets_[slot];
+  return j.nn_dist * (j.nn == no_slot ? j.k : std::min(j.k, jets_[j.nn].k));
+}
+
+inline std::vector<std::size_t> tiled_clustering::run() {
+  const slot_type n{static_cast<slot_type>(jets_.size())};
+  std::vector<std::size_t> jets;
+  if (n == 0) {
+    return jets;
+  }
+  for (slot_type i = 0; i < n; ++i) {
+    insert(i);
+  }
+  for (slot_type i = 0; i < n; ++i) {
+    find_neighbour(i, no_slot, r2_);
+  }
+  std::vector<double> d(n);
+  for (slot_type i = 0; i < n; ++i) {
+    d[i] = dij(i);
+  }
+  min_tree tree{d};
+  for (std::size_t n_active = n; n_active > 0; --n_active) {
+    const slot_type a{static_cast<slot_type>(tree.min_index())};
+    const slot_type b{jets_[a].nn};
+    // the jets that had a or b as their nearest neighbour need a new one
+    // (the slot of a is reused for the merged jet, its d_ij is only updated
+    // at the end of the step)
+    unlink(a);
+    remove(a);
+    if (b != no_slot) {
+      unlink(b);
+      remove(b);
+      tree.update(b, std::numeric_limits<double>::infinity());
+    }
+    pending_.clear();
+    for (slot_type k = jets_[a].rnn_first; k != no_slot;
+         k = jets_[k].rnn_next) {
+      pending_.push_back(k);
+    }
+    if (b == no_slot) {
+      // a is a jet
+      tree.update(a, std::numeric_limits<double>::infinity());
+      jets.push_back(jets_[a].pseudojet);
+      for (slot_type k : pending_) {
+        find_neighbour(k, no_slot, r2_);
+        tree.update(k, dij(k));
+      }
+      continue;
+    }
+    for (slot_type k = jets_[b].rnn_first; k != no_slot;
+         k = jets_[k].rnn_next) {
+      pending_.push_back(k);
+    }
+    // merge b into a, in the slot of a
+    const momentum& p{pseudojets_[jets_[a].pseudojet]};
+    const momentum& q{pseudojets_[jets_[b].pseudojet]};
+    pseudojets_.push_back({p.e + q.e, p.px + q.px, p.py + q.py, p.pz + q.pz});
+    parent1_.push_back(jets_[a].pseudojet);
+    parent2_.push_back(jets_[b].pseudojet);
+    jets_[a].pseudojet = static_cast<slot_type>(pseudojets_.size() - 1);
+    set_kinematics(a);
+    insert(a);
+    // the nearest neighbour of the merged jet, and the jets that are closer
+    // to the merged jet than to their nearest neighbour: only the tiles with
+    // a jet closer than the bound of the tile are searched, and the bound of
+    // a searched tile is updated
+    slot_type nn{no_slot};
+    double nn_dist{r2_};
+    const double y{jets_[a].y}, phi{jets_[a].phi};
+    visit_tiles(y, phi, jets_[a].tile, r2_, [&](std::size_t t, double gap2) {
+      tile& current{tiles_[t]};
+      if (!(gap2 < std::max(nn_dist, current.max))) {
+        return;
+      }
+      double max_dist{0.};
+      const tile_entry* e{&entries_[current.begin]};
+      for (const tile_entry* end = e + current.size; e != end; ++e) {
+        const slot_type k{e->slot};
+        if (k == a) {
+          continue;
+        }
+        const double dist{distance(y, phi, e->y, e->phi)};
+        if (dist < nn_dist) {
+          nn_dist = dist;
+          nn = k;
+        }
+        const active_jet& j = jets_[k];
+        if (dist < j.nn_dist && j.nn != a && j.nn != b) {
+          set_neighbour(k, a, dist);
+          tree.update(k, dij(k));
+        }
+        max_dist = std::max(max_dist, j.nn_dist);
+      }
+      current.max = max_dist;
+    });
+    set_neighbour(a, nn, nn_dist);
+    // (the merged jet is close to the pending jets, and limits their search)
+    for (slot_type k : pending_) {
+      const double dist{distance(jets_[k].y, jets_[k].phi, y, phi)};
+      if (dist < r2_) {
+        find_neighbour(k, a, dist);
+      } else {
+        find_neighbour(k, no_slot, r2_);
+      }
+      tree.update(k, dij(k));
+    }
+    tree.update(a, dij(a));
+  }
+  return jets;
+}
+inline void tiled_clustering::constituents(std::size_t i,
+                                           std::vector<std::size_t>& out) const {
+  std::vector<std::size_t> stack{i};
+  while (!stack.empty()) {
+    const std::size_t p{stack.back()};
+    stack.pop_back();
+    if (parent1_[p] == none) {
+      out.push_back(p);
+    } else {
+      stack.push_back(parent1_[p]);
+      stack.push_back(parent2_[p]);
+    }
+  }
+}
+
+// jets ordered by decreasing pt (and by the order of completion for equal pt)
+template <class Q, class R>
+jet_list<Q, R> make_jets(const jet_definition& definition,
+                         std::vector<momentum> particles) {
+  tiled_clustering clustering{definition, std::move(particles)};
+  std::vector<std::size_t> jets{clustering.run()};
+  std::vector<std::pair<double, std::size_t>> order;
+  order.reserve(jets.size());
+  for (std::size_t i : jets) {
+    const momentum& p{clustering.pseudojet(i)};
+    order.emplace_back(-(p.px * p.px + p.py * p.py), i);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const std::pair<double, std::size_t>& a,
+                      const std::pair<double, std::size_t>& b) {
+                     return a.first < b.first;
+                   });
+  jet_list<Q, R> result;
+  result.jets.reserve(jets.size());
+  result.offsets.reserve(jets.size() + 1);
+  for (const auto& o : order) {
+    const momentum& p{clustering.pseudojet(o.second)};
+    result.jets.push_back({Q{p.e}, {Q{p.px}, Q{p.py}, Q{p.pz}}});
+    const std::size_t begin{result.indices.size()};
+    clustering.constituents(o.second, result.indices);
+    std::sort(result.indices.begin() + begin, result.indices.end());
+    result.offsets.push_back(result.indices.size());
+  }
+  return result;
+}
+} // namespace jet_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: cluster
+// =============================================================================
+namespace physics {
+inline jet_definition::jet_definition(jet_algorithm algorithm, double radius)
+    : algorithm_{algorithm}, radius_{radius} {
+  if (!(radius > 0) || !std::isfinite(radius)) {
+    throw jet_error{"invalid jet radius " + std::to_string(radius) +
+                        " (has to be positive)",
+                    "jet_radius_error"};
+  }
+}
+template <class Q, class R>
+jet_list<Q, R> cluster(const lorentzvector_array<Q, R>& particles,
+                       const jet_definition& definition) {
+  std::vector<jet_impl::momentum> p(particles.size());
+  for (std::size_t i = 0; i < particles.size(); ++i) {
+    p[i] = {vector_impl::raw(particles.x0()[i]),
+            vector_impl::raw(particles.x().x1()[i]),
+            vector_impl::raw(particles.x().x2()[i]),
+            vector_impl::raw(particles.x().x3()[i])};
+  }
+  return jet_impl::make_jets<Q, R>(definition, std::move(p));
+}
+template <class Q, class R>
+jet_list<Q, R> cluster(const std::vector<lorentzvector<Q, R>>& particles,
+                       const jet_definition& definition) {
+  std::vector<jet_impl::momentum> p(particles.size());
+  for (std::size_t i = 0; i < particles.size(); ++i) {
+    const lorentzvector<Q, R>& v{particles[i]};
+    p[i] = {vector_impl::raw(v.x0), vector_impl::raw(v.x.x1),
+            vector_impl::raw(v.x.x2), vector_impl::raw(v.x.x3)};
+  }
+  return jet_impl::make_jets<Q, R>(definition, std::move(p));
+}
+} // namespace physics
+
+#endif
@@ -0,0 +1,430 @@
+#ifndef PHYSICS_VECTOR_KDTREE_LOADED
+#define PHYSICS_VECTOR_KDTREE_LOADED
+
+#include <algorithm>
+#include <cstddef>
+#include <future>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <physics/util/span.hh>
+#include <physics/util/thread_pool.hh>
+#include <physics/vector.hh>
+#include <physics/vector/array.hh>
+
+// =============================================================================
+// kdtree<Quantity, Radian>: static k-d tree over physics::vector positions,
+// for radius, k-nearest-neighbour and box queries
+//
+// kdtree<Q> tree{points} builds the tree from a span of vector<Q> (or from a
+// vector_array<Q>), tree.within(center, radius) returns the indices of the
+// points with |point - center| <= radius, tree.nearest(point, k) the indices
+// of the k closest points (ordered by increasing distance) and
+// tree.in_box(low, high) the indices of the points with low <= point <= high
+// in every component.
+//
+// Notes:
+//  * The radius is a Quantity, so a radius in an incompatible unit (or a raw
+//    double for a tree of quantities) does not compile.
+//  * The tree is a flat array of nodes (the position in raw values and the
+//    index of the point) in median order: the node in the middle of a range
+//    splits it along the axis with the largest spread, and the nodes before
+//    (after) it are not larger (not smaller) along that axis. Ranges of up to
+//    kdtree_impl::leaf_size nodes are scanned linearly. There are no child
+//    pointers, and the tree does not refer to the points after construction.
+//  * kdtree<Q> tree{points, pool} splits the upper levels in the calling
+//    thread, and builds the subtrees below them in parallel in the
+//    thread_pool. The tree does not depend on the size of the pool.
+//  * within() and in_box() return the indices in tree order, nearest() breaks
+//    ties in the distance by the index. The overloads with an output vector
+//    replace its contents, and can reuse its memory across queries.
+// =============================================================================
+namespace physics {
+template <class Quantity, class Radian = double> class kdtree;
+
+namespace kdtree_impl {
+struct node {
+  double x[3];
+  std::size_t index;
+  std::size_t axis;
+};
+
+// the tree on raw values, see kdtree
+class index {
+public:
+  index() = default;
+  index(std::vector<node> nodes, thread_pool* pool);
+
+  std::size_t size() const { return nodes_.size(); }
+  void within(const double* center, double radius,
+              std::vector<std::size_t>& out) const;
+  void nearest(const double* point, std::size_t k,
+               std::vector<std::size_t>& out) const;
+  void in_box(const double* low, const double* high,
+              std::vector<std::size_t>& out) const;
+
+private:
+  using candidate = std::pair<double, std::size_t>;
+
+  std::size_t split(std::size_t begin, std::size_t end);
+  void build(std::size_t begin, std::size_t end);
+  void within(std::size_t begin, std::size_t end, const double* center,
+              double radius, std::vector<std::size_t>& out) const;
+  void nearest(std::size_t begin, std::size_t end, const double* point,
+               std::size_t k, std::vector<candidate>& heap) const;
+  void in_box(std::size_t begin, std::size_t end, const double* low,
+              const double* high, std::vector<std::size_t>& out) const;
+
+  std::vector<node> nodes_;
+};
+} // namespace kdtree_impl
+
+template <class Quantity, class Radian> class kdtree {
+public:
+  using quantity_type = Quantity;
+  using radian_type = Radian;
+  using value_type = vector<Quantity, Radian>;
+  using size_type = std::size_t;
+
+  // constructors
+  //
+  // 1. empty tree
+  kdtree() = default;
+  // 2. from a span of vectors (or any contiguous container of them)
+  explicit kdtree(span<const value_type> points);
+  kdtree(span<const value_type> points, thread_pool& pool);
+  // 3. from a vector_array
+  explicit kdtree(const vector_array<Quantity, Radian>& points);
+  kdtree(const vector_array<Quantity, Radian>& points, thread_pool& pool);
+
+  size_type size() const { return index_.size(); }
+  bool empty() const { return index_.size() == 0; }
+
+  // indices of the points with |point - center| <= radius
+  std::vector<size_type> within(const value_type& center,
+                                quantity_type radius) const;
+  void within(const value_type& center, quantity_type radius,
+              std::vector<size_type>& out) const;
+  // indices of the (up to) k closest points, the closest first
+  std::vector<size_type> nearest(const value_type& point, size_type k) const;
+  void nearest(const value_type& point, size_type k,
+               std::vector<size_type>& out) const;
+  // indices of the points with low.xi <= point.xi <= high.xi
+  std::vector<size_type> in_box(const value_type& low,
+                                const value_type& high) const;
+  void in_box(const value_type& low, const value_type& high,
+              std::vector<size_type>& out) const;
+
+private:
+  static std::vector<kdtree_impl::node>
+  make_nodes(span<const value_type> points);
+  static std::vector<kdtree_impl::node>
+  make_nodes(const vector_array<Quantity, Radian>& points);
+  static void raw(const value_type& v, double* x) {
+    x[0] = vector_impl::raw(v.x1);
+    x[1] = vector_impl::raw(v.x2);
+    x[2] = vector_impl::raw(v.x3);
+  }
+
+  kdtree_impl::index index_;
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: kdtree_impl
+// =============================================================================
+namespace physics {
+namespace kdtree_impl {
+constexpr std::size_t leaf_size{8};
+constexpr std::size_t blocks_per_thread{4};
+
+inline double distance2(const double* a, const double* b) {
+  const double d0{a[0] - b[0]}, d1{a[1] - b[1]}, d2{a[2] - b[2]};
+  return d0 * d0 + d1 * d1 + d2 * d2;
+}
+
+inline index::index(std::vector<node> nodes, thread_pool* pool)
+    : nodes_(std::move(nodes)) {
+  const std::size_t n_blocks{pool ? blocks_per_thread * pool->size() : 0};
+  if (n_blocks <= 1) {
+    build(0, nodes_.size());
+    return;
+  }
+  // split the upper levels until there are enough subtrees, the subtrees
+  // cover disjoint ranges of the nodes
+  std::vector<std::pair<std::size_t, std::size_t>> ranges{{0, nodes_.size()}};
+  bool split_any{true};
+  while (ranges.size() < n_blocks && split_any) {
+    split_any = false;
+    std::vector<std::pair<std::size_t, std::size_t>> next;
+    for (const auto& r : ranges) {
+      if (r.second - r.first <= leaf_size) {
+        next.push_back(r);
+        continue;
+      }
+      const std::size_t mid{split(r.first, r.second)};
+      next.emplace_back(r.first, mid);
+      next.emplace_back(mid + 1, r.second);
+      split_any = true;
+    }
+    ranges.swap(next);
+  }
+  std::vector<std::future<void>> blocks;
+  blocks.reserve(ranges.size());
+  for (const auto& r : ranges) {
+    blocks.push_back(pool->submit([this, r] { build(r.first, r.second); }));
+  }
+  // wait for all blocks before re-throwing any exception, as they write to
+  // the nodes
+  for (auto& block : blocks) {
+    block.wait();
+  }
+  for (auto& block : blocks) {
+    block.get();
+  }
+}
+// partition [begin, end) around its median along the axis with the largest
+// spread, returns the position of the median
+inline std::size_t index::split(std::size_t begin, std::size_t end) {
+  double lo[3], hi[3];
+  std::copy(nodes_[begin].x, nodes_[begin].x + 3, lo);
+  std::copy(nodes_[begin].x, nodes_[begin].x + 3, hi);
+  for (std::size_t i = begin + 1; i < end; ++i) {
+    for (std::size_t a = 0; a < 3; ++a) {
+      lo[a] = std::min(lo[a], nodes_[i].x[a]);
+      hi[a] = std::max(hi[a], nodes_[i].x[a]);
+    }
+  }
+  std::size_t axis{0};
+  for (std::size_t a = 1; a < 3; ++a) {
+    if (hi[a] - lo[a] > hi[axis] - lo[axis]) {
+      axis = a;
+    }
+  }
+  const std::size_t mid{begin + (end - begin) / 2};
+  std::nth_element(
+      nodes_.begin() + begin, nodes_.begin() + mid, nodes_.begin() + end,
+      [axis](const node& a, const node& b) { return a.x[axis] < b.x[axis]; });
+  nodes_[mid].axis = axis;
+  return mid;
+}
+inline void index::build(std::size_t begin, std::size_t end) {
+  while (end - begin > leaf_size) {
+    const std::size_t mid{split(begin, end)};
+    build(begin, mid);
+    begin = mid + 1;
+  }
+}
+
+inline void index::within(const double* center, double radius,
+                          std::vector<std::size_t>& out) const {
+  out.clear();
+  if (radius >= 0) {
+    within(0, nodes_.size(), center, radius, out);
+  }
+}
+inline void index::within(std::size_t begin, std::size_t end,
+                          const double* center, double radius,
+                          std::vector<std::size_t>& out) const {
+  const double r2{radius * radius};
+  while (end - begin > leaf_size) {
+    const std::size_t mid{begin + (end - begin) / 2};
+    const node& m{nodes_[mid]};
+    const double d{center[m.axis] - m.x[m.axis]};
+    if (distance2(center, m.x) <= r2) {
+      out.push_back(m.index);
+    }
+    if (d <= radius) {
+      within(begin, mid, center, radius, out);
+    }
+    if (!(d >= -radius)) {
+      return;
+    }
+    begin = mid + 1;
+  }
+  for (std::size_t i = begin; i < end; ++i) {
+    if (distance2(center, nodes_[i].x) <= r2) {
+      out.push_back(nodes_[i].index);
+    }
+  }
+}
+
+inline void index::nearest(const double* point, std::size_t k,
+                           std::vector<std::size_t>& out) const {
+  out.clear();
+  if (k == 0) {
+    return;
+  }
+  std::vector<candidate> heap;
+  heap.reserve(std::min(k, nodes_.size()));
+  nearest(0, nodes_.size(), point, k, heap);
+  std::sort_heap(heap.begin(), heap.end());
+  for (const candidate& c : heap) {
+    out.push_back(c.second);
+  }
+}
+// heap holds the k closest points so far, the furthest first
+inline void index::nearest(std::size_t begin, std::size_t end,
+                           const double* point, std::size_t k,
+                           std::vector<candidate>& heap) const {
+  const auto add = [&](const node& n) {
+    const candidate c{distance2(point, n.x), n.index};
+    if (heap.size() < k) {
+      heap.push_back(c);
+      std::push_heap(heap.begin(), heap.end());
+    } else if (c < heap.front()) {
+      std::pop_heap(heap.begin(), heap.end());
+      heap.back() = c;
+      std::push_heap(heap.begin(), heap.end());
+    }
+  };
+  if (end - begin <= leaf_size) {
+    for (std::size_t i = begin; i < end; ++i) {
+      add(nodes_[i]);
+    }
+    return;
+  }
+  const std::size_t mid{begin + (end - begin) / 2};
+  const node& m{nodes_[mid]};
+  const double d{point[m.axis] - m.x[m.axis]};
+  add(m);
+  // the side of the point first, the other side only if it can hold a point
+  // that is not further than the k-th closest one (equal distances can still
+  // replace it by a smaller index)
+  if (d < 0) {
+    nearest(begin, mid, point, k, heap);
+    if (heap.size() < k || d * d <= heap.front().first) {
+      nearest(mid + 1, end, point, k, heap);
+    }
+  } else {
+    nearest(mid + 1, end, point, k, heap);
+    if (heap.size() < k || d * d <= heap.front().first) {
+      nearest(begin, mid, point, k, heap);
+    }
+  }
+}
+
+inline void index::in_box(const double* low, const double* high,
+                          std::vector<std::size_t>& out) const {
+  out.clear();
+  in_box(0, nodes_.size(), low, high, out);
+}
+inline void index::in_box(std::size_t begin, std::size_t end,
+                          const double* low, const double* high,
+                          std::vector<std::size_t>& out) const {
+  const auto inside = [low, high](const node& n) {
+    return low[0] <= n.x[0] && n.x[0] <= high[0] && low[1] <= n.x[1] &&
+           n.x[1] <= high[1] && low[2] <= n.x[2] && n.x[2] <= high[2];
+  };
+  while (end - begin > leaf_size) {
+    const std::size_t mid{begin + (end - begin) / 2};
+    const node& m{nodes_[mid]};
+    if (inside(m)) {
+      out.push_back(m.index);
+    }
+    if (low[m.axis] <= m.x[m.axis]) {
+      in_box(begin, mid, low, high, out);
+    }
+    if (!(high[m.axis] >= m.x[m.axis])) {
+      return;
+    }
+    begin = mid + 1;
+  }
+  for (std::size_t i = begin; i < end; ++i) {
+    if (inside(nodes_[i])) {
+      out.push_back(nodes_[i].index);
+    }
+  }
+}
+} // namespace kdtree_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: kdtree
+// =============================================================================
+namespace physics {
+template <class Q, class R>
+kdtree<Q, R>::kdtree(span<const value_type> points)
+    : index_{make_nodes(points), nullptr} {}
+template <class Q, class R>
+kdtree<Q, R>::kdtree(span<const value_type> points, thread_pool& pool)
+    : index_{make_nodes(points), &pool} {}
+template <class Q, class R>
+kdtree<Q, R>::kdtree(const vector_array<Q, R>& points)
+    : index_{make_nodes(points), nullptr} {}
+template <class Q, class R>
+kdtree<Q, R>::kdtree(const vector_array<Q, R>& points, thread_pool& pool)
+    : index_{make_nodes(points), &pool} {}
+
+template <class Q, class R>
+std::vector<kdtree_impl::node>
+kdtree<Q, R>::make_nodes(span<const value_type> points) {
+  std::vector<kdtree_impl::node> nodes(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    raw(points[i], nodes[i].x);
+    nodes[i].index = i;
+    nodes[i].axis = 0;
+  }
+  return nodes;
+}
+template <class Q, class R>
+std::vector<kdtree_impl::node>
+kdtree<Q, R>::make_nodes(const vector_array<Q, R>& points) {
+  std::vector<kdtree_impl::node> nodes(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    nodes[i] = {{vector_impl::raw(points.x1()[i]),
+                 vector_impl::raw(points.x2()[i]),
+                 vector_impl::raw(points.x3()[i])},
+                i,
+                0};
+  }
+  return nodes;
+}
+
+template <class Q, class R>
+std::vector<std::size_t> kdtree<Q, R>::within(const value_type& center,
+                                              quantity_type radius) const {
+  std::vector<size_type> out;
+  within(center, radius, out);
+  return out;
+}
+template <class Q, class R>
+void kdtree<Q, R>::within(const value_type& center, quantity_type radius,
+                          std::vector<size_type>& out) const {
+  double c[3];
+  raw(center, c);
+  index_.within(c, vector_impl::raw(radius), out);
+}
+template <class Q, class R>
+std::vector<std::size_t> kdtree<Q, R>::nearest(const value_type& point,
+                                               size_type k) const {
+  std::vector<size_type> out;
+  nearest(point, k, out);
+  return out;
+}
+template <class Q, class R>
+void kdtree<Q, R>::nearest(const value_type& point, size_type k,
+                           std::vector<size_type>& out) const {
+  double p[3];
+  raw(point, p);
+  index_.nearest(p, k, out);
+}
+template <class Q, class R>
+std::vector<std::size_t> kdtree<Q, R>::in_box(const value_type& low,
+                                              const value_type& high) const {
+  std::vector<size_type> out;
+  in_box(low, high, out);
+  return out;
+}
+template <class Q, class R>
+void kdtree<Q, R>::in_box(const value_type& low, const value_type& high,
+                          std::vector<size_type>& out) const {
+  double lo[3], hi[3];
+  raw(low, lo);
+  raw(high, hi);
+  index_.in_box(lo, hi, out);
+}
+} // namespace physics
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef PHYSICS_VECTOR_KINEMATICS_LOADED
+#define PHYSICS_VECTOR_KINEMATICS_LOADED
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <physics/vector.hh>
+#include <physics/vector/array.hh>
+
+// =============================================================================
+// kinematics: batch versions of the vector/lorentzvector coordinate accessors
+// (perp, phi, theta, eta, rapidity and mt) over vector_array and
+// lorentzvector_array
+//
+// Every function returns a column with one result per element, in the same
+// type as the corresponding vector/lorentzvector accessor.
+//
+// Notes:
+//  * The angular functions take an optional approximation mode:
+//      - approximation::exact evaluates std::atan2, std::log and std::asinh
+//        for every element, identical to the scalar accessors;
+//      - approximation::fast uses branch-free polynomial approximations:
+//          * phi and theta: maximum absolute error 1e-8 rad;
+//          * eta and rapidity: maximum absolute error 1e-9 (relative to the
+//            exact result, on top of the rounding of the inputs).
+//        The fast logarithm is only valid for finite, positive, normal
+//        arguments: eta is not defined for perp = 0, and the rapidity not for
+//        |x3| >= x0.
+//  * The fast loops are vectorized when compiling for AVX (e.g. with
+//    PHYSICS_NATIVE_ARCH) or with -fno-trapping-math, otherwise they run as
+//    branch-free scalar code. perp, theta, eta and mt also take a square root,
+//    which is only vectorized with -fno-math-errno (as for
+//    vector_array::mag()).
+// =============================================================================
+namespace physics {
+enum class approximation { exact, fast };
+
+template <class Q, class R> auto perp(const vector_array<Q, R>& v);
+template <class Q, class R>
+auto phi(const vector_array<Q, R>& v,
+         approximation mode = approximation::exact);
+template <class Q, class R>
+auto theta(const vector_array<Q, R>& v,
+           approximation mode = approximation::exact);
+template <class Q, class R>
+auto eta(const vector_array<Q, R>& v,
+         approximation mode = approximation::exact);
+
+template <class Q, class R> auto perp(const lorentzvector_array<Q, R>& v) {
+  return perp(v.x());
+}
+template <class Q, class R>
+auto phi(const lorentzvector_array<Q, R>& v,
+         approximation mode = approximation::exact) {
+  return phi(v.x(), mode);
+}
+template <class Q, class R>
+auto theta(const lorentzvector_array<Q, R>& v,
+           approximation mode = approximation::exact) {
+  return theta(v.x(), mode);
+}
+template <class Q, class R>
+auto eta(const lorentzvector_array<Q, R>& v,
+         approximation mode = approximation::exact) {
+  return eta(v.x(), mode);
+}
+template <class Q, class R>
+auto rapidity(const lorentzvector_array<Q, R>& v,
+              approximation mode = approximation::exact);
+template <class Q, class R> auto mt(const lorentzvector_array<Q, R>& v);
+
+namespace kinematics_impl {
+// branch-free approximations used by approximation::fast
+inline double fast_atan2(double y, double x);
+inline double fast_log(double x);
+} // namespace kinematics_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: fast approximations
+// =============================================================================
+namespace physics {
+namespace kinematics_impl {
+// atan2 is reduced to atan(t) with t in [0, 1], and further to
+// |t| <= tan(pi/8) using atan(t) = pi/4 + atan((t - 1) / (t + 1)). The odd
+// polynomial is the Cephes single precision minimax fit on that interval.
+inline double fast_atan2(double y, double x) {
+  constexpr double pi{3.14159265358979323846};
+  const double ay{std::fabs(y)}, ax{std::fabs(x)};
+  const double hi{ay > ax ? ay : ax}, lo{ay > ax ? ax : ay};
+  // (branch-free: all selections pick between constants or values that are
+  // already computed)
+  const double t{lo / (hi > 0 ? hi : 1.)};
+  // u = (t - 1) / (t + 1) for t > tan(pi/8), t otherwise
+  const bool large{t > 0.41421356237309503};
+  const double k{large ? 1. : 0.};
+  const double u{(t - k) / (t * k + 1.)};
+  const double z{u * u};
+  double r{(((8.05374449538e-2 * z - 1.38776856032e-1) * z +
+             1.99777106478e-1) *
+                z -
+            3.33329491539e-1) *
+               z * u +
+           u};
+  r += large ? pi / 4 : 0.;
+  r = (ay > ax ? -1. : 1.) * r + (ay > ax ? pi / 2 : 0.);
+  r = (x < 0 ? -1. : 1.) * r + (x < 0 ? pi : 0.);
+  return std::copysign(r, y);
+}
+// x = m * 2^e with m in [sqrt(1/2), sqrt(2)), and
+// ln(m) = 2 atanh(s) with s = (m - 1) / (m + 1), |s| < 0.172, evaluated as a
+// truncated series. The exponent is extracted from the bits with integer
+// operations only, so that the whole function vectorizes.
+inline double fast_log(double x) {
+  constexpr double ln2{0.69314718055994530942};
+  std::uint64_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  // exponent as a double: 2^52 + e_biased, minus (2^52 + bias)
+  std::uint64_t e_bits{(bits >> 52) | 0x4330000000000000ULL};
+  double e;
+  std::memcpy(&e, &e_bits, sizeof(e));
+  e -= 4503599627370496. + 1023.;
+  // m in [1, 2), rescaled to [sqrt(1/2), sqrt(2))
+  const std::uint64_t m_bits{(bits & 0x000fffffffffffffULL) |
+                             0x3ff0000000000000ULL};
+  double m;
+  std::memcpy(&m, &m_bits, sizeof(m));
+  const bool large{m > 1.41421356237309504880};
+  m *= large ? 0.5 : 1.;
+  e += large ? 1. : 0.;
+  const double s{(m - 1.) / (m + 1.)};
+  const double z{s * s};
+  return e * ln2 +
+         2. * s *
+             (1. + z * (1. / 3 + z * (1. / 5 + z * (1. / 7 + z * (1. / 9)))));
+}
+} // namespace kinematics_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: batch kinematics
+// =============================================================================
+namespace physics {
+namespace kinematics_impl {
+// result columns
+template <class T> using column_t = vector_array_impl::column_array_t<T>;
+template <class Q, class R>
+using perp_t = decltype(std::declval<vector<Q, R>>().perp());
+// pointer to the aligned data of a column
+template <class Column> auto data(Column&& c) {
+  return vector_array_impl::aligned(c.data());
+}
+} // namespace kinematics_impl
+
+template <class Q, class R> auto perp(const vector_array<Q, R>& v) {
+  using result_type = kinematics_impl::perp_t<Q, R>;
+  const std::size_t n{v.size()};
+  kinematics_impl::column_t<result_type> result(n);
+  const Q* x1{kinematics_impl::data(v.x1())};
+  const Q* x2{kinematics_impl::data(v.x2())};
+  result_type* y{kinematics_impl::data(result)};
+  for (std::size_t i = 0; i < n; ++i) {
+    y[i] = std::sqrt(x1[i] * x1[i] + x2[i] * x2[i]);
+  }
+  return result;
+}
+template <class Q, class R>
+auto phi(const vector_array<Q, R>& v, approximation mode) {
+  const std::size_t n{v.size()};
+  kinematics_impl::column_t<R> result(n);
+  const Q* x1{kinematics_impl::data(v.x1())};
+  const Q* x2{kinematics_impl::data(v.x2())};
+  R* y{kinematics_impl::data(result)};
+  if (mode == approximation::fast) {
+    for (std::size_t i = 0; i < n; ++i) {
+      y[i] = R{kinematics_impl::fast_atan2(vector_impl::raw(x2[i]),
+                                           vector_impl::raw(x1[i]))};
+    }
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      y[i] = R{std::atan2(vector_impl::raw(x2[i]),
+                          vector_impl::raw(x1[i]))};
+    }
+  }
+  return result;
+}
+template <class Q, class R>
+auto theta(const vector_array<Q, R>& v, approximation mode) {
+  const std::size_t n{v.size()};
+  kinematics_impl::column_t<R> result(n);
+  const Q* x1{kinematics_impl::data(v.x1())};
+  const Q* x2{kinematics_impl::data(v.x2())};
+  const Q* x3{kinematics_impl::data(v.x3())};
+  R* y{kinematics_impl::data(result)};
+  for (std::size_t i = 0; i < n; ++i) {
+    const double y1{vector_impl::raw(x1[i])};
+    const double y2{vector_impl::raw(x2[i])};
+    const double pt{std::sqrt(y1 * y1 + y2 * y2)};
+    const double z{vector_impl::raw(x3[i])};
+    y[i] = R{mode == approximation::fast ? kinematics_impl::fast_atan2(pt, z)
+                                         : std::atan2(pt, z)};
+  }
+  return result;
+}
+template <class Q, class R>
+auto eta(const vector_array<Q, R>& v, approximation mode) {
+  const std::size_t n{v.size()};
+  kinematics_impl::column_t<double> result(n);
+  const Q* x1{kinematics_impl::data(v.x1())};
+  const Q* x2{kinematics_impl::data(v.x2())};
+  const Q* x3{kinematics_impl::data(v.x3())};
+  double* y{kinematics_impl::data(result)};
+  if (mode == approximation::fast) {
+    // eta = sgn(x3) 1/2 ln((|x3| + mag)^2 / perp2), avoiding the cancellation
+    // in (mag - |x3|) for large eta
+    for (std::size_t i = 0; i < n; ++i) {
+      const double y1{vector_impl::raw(x1[i])};
+      const double y2{vector_impl::raw(x2[i])};
+      const double z{vector_impl::raw(x3[i])};
+      const double pt2{y1 * y1 + y2 * y2};
+      const double w{std::fabs(z) + std::sqrt(pt2 + z * z)};
+      const double a{0.5 * kinematics_impl::fast_log(w * w / pt2)};
+      y[i] = z < 0 ? -a : a;
+    }
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      const double y1{vector_impl::raw(x1[i])};
+      const double y2{vector_impl::raw(x2[i])};
+      y[i] = std::asinh(vector_impl::raw(x3[i]) /
+                        std::sqrt(y1 * y1 + y2 * y2));
+    }
+  }
+  return result;
+}
+template <class Q, class R>
+auto rapidity(const lorentzvector_array<Q, R>& v, approximation mode) {
+  const std::size_t n{v.size()};
+  kinematics_impl::column_t<double> result(n);
+  const Q* x0{kinematics_impl::data(v.x0())};
+  const Q* x3{kinematics_impl::data(v.x().x3())};
+  double* y{kinematics_impl::data(result)};
+  if (mode == approximation::fast) {
+    for (std::size_t i = 0; i < n; ++i) {
+      const double e{vector_impl::raw(x0[i])};
+      const double z{vector_impl::raw(x3[i])};
+      y[i] = 0.5 * kinematics_impl::fast_log((e + z) / (e - z));
+    }
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      const double e{vector_impl::raw(x0[i])};
+      const double z{vector_impl::raw(x3[i])};
+      y[i] = 0.5 * std::log((e + z) / (e - z));
+    }
+  }
+  return result;
+}
+template <class Q, class R> auto mt(const lorentzvector_array<Q, R>& v) {
+  using result_type =
+      decltype(std::declval<lorentzvector<Q, R>>().mt());
+  const std::size_t n{v.size()};
+  kinematics_impl::column_t<result_type> result(n);
+  const Q* x0{kinematics_impl::data(v.x0())};
+  const Q* x3{kinematics_impl::data(v.x().x3())};
+  result_type* y{kinematics_impl::data(result)};
+  for (std::size_t i = 0; i < n; ++i) {
+    y[i] = lorentzvector<Q, R>{x0[i], {Q{0}, Q{0}, x3[i]}}.mt();
+  }
+  return result;
+}
+} // namespace physics
+
+#endif
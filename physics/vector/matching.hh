@@ -0,0 +1,424 @@
+#ifndef PHYSICS_VECTOR_MATCHING_LOADED
+#define PHYSICS_VECTOR_MATCHING_LOADED
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <physics/util/aligned.hh>
+#include <physics/util/exception.hh>
+#include <physics/vector.hh>
+#include <physics/vector/array.hh>
+
+// =============================================================================
+// delta_r(): batch deltaR = sqrt(deta^2 + dphi^2) in pseudorapidity and
+// azimuth, between the elements of two arrays of equal size, or between one
+// lorentzvector and every element of an array
+//
+// match_delta_r(first, second, max_delta_r, strategy): one-to-one matching of
+// two collections with deltaR <= max_delta_r, returns the matched pairs
+// (indices in first and second, and their deltaR), ordered by the index in
+// first
+//  * match_strategy::greedy takes the closest pair, removes both objects, and
+//    repeats;
+//  * match_strategy::optimal finds the largest number of matches, and among
+//    these the one with the smallest sum of deltaR.
+//
+// Notes:
+//  * The collections are lorentzvector_arrays, vector_arrays or std::vectors
+//    of lorentzvectors, of any (and possibly different) quantity type. Only
+//    the spatial components are used.
+//  * The objects of second are binned in (eta, phi) cells of at least
+//    max_delta_r, so only the objects in the 3 x 3 cells around an object of
+//    first (with phi wrapping around) are candidates. The optimal matching
+//    runs the Hungarian algorithm (O(n^3)) on every connected group of
+//    candidate pairs separately, not on all objects.
+//  * Objects without transverse momentum have an infinite eta and are never
+//    matched. Pairs with equal deltaR are taken in the order of the indices.
+//  * The delta_r loops are vectorized with the same restrictions as the
+//    vector_array batch operations (the square root needs -fno-math-errno).
+//    delta_r of two arrays with a different size throws an expression_error.
+//  * A max_delta_r that is not positive and finite throws a matching_error.
+// =============================================================================
+namespace physics {
+
+enum class match_strategy { greedy, optimal };
+
+struct match {
+  std::size_t first;
+  std::size_t second;
+  double delta_r;
+};
+
+template <class Q1, class R1, class Q2, class R2>
+aligned_vector<double> delta_r(const lorentzvector_array<Q1, R1>& a,
+                               const lorentzvector_array<Q2, R2>& b);
+template <class Q1, class R1, class Q2, class R2>
+aligned_vector<double> delta_r(const lorentzvector<Q1, R1>& a,
+                               const lorentzvector_array<Q2, R2>& b);
+
+template <class First, class Second>
+std::vector<match>
+match_delta_r(const First& first, const Second& second, double max_delta_r,
+              match_strategy strategy = match_strategy::greedy);
+
+class matching_error : public physics::exception {
+public:
+  matching_error(const std::string& msg,
+                 const std::string& type = "matching_error")
+      : physics::exception{msg, type} {}
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: deltaR
+// =============================================================================
+namespace physics {
+namespace matching_impl {
+constexpr double pi{3.14159265358979323846};
+
+// eta and phi columns of a collection
+struct coordinates {
+  aligned_vector<double> eta;
+  aligned_vector<double> phi;
+
+  std::size_t size() const { return eta.size(); }
+  void push_back(double x1, double x2, double x3) {
+    eta.push_back(std::asinh(x3 / std::sqrt(x1 * x1 + x2 * x2)));
+    phi.push_back(std::atan2(x2, x1));
+  }
+};
+template <class Q, class R>
+coordinates make_coordinates(const vector_array<Q, R>& v) {
+  coordinates c;
+  c.eta.reserve(v.size());
+  c.phi.reserve(v.size());
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    c.push_back(vector_impl::raw(v.x1()[i]), vector_impl::raw(v.x2()[i]),
+                vector_impl::raw(v.x3()[i]));
+  }
+  return c;
+}
+template <class Q, class R>
+coordinates make_coordinates(const lorentzvector_array<Q, R>& v) {
+  return make_coordinates(v.x());
+}
+template <class Q, class R>
+coordinates make_coordinates(const std::vector<lorentzvector<Q, R>>& v) {
+  coordinates c;
+  c.eta.reserve(v.size());
+  c.phi.reserve(v.size());
+  for (const auto& p : v) {
+    c.push_back(vector_impl::raw(p.x.x1), vector_impl::raw(p.x.x2),
+                vector_impl::raw(p.x.x3));
+  }
+  return c;
+}
+
+// dphi folded into [0, pi] without a branch (phi in [-pi, pi])
+inline double delta_r(double eta1, double phi1, double eta2, double phi2) {
+  const double deta{eta1 - eta2};
+  const double dphi{pi - std::fabs(pi - std::fabs(phi1 - phi2))};
+  return std::sqrt(deta * deta + dphi * dphi);
+}
+inline void delta_r(const double* eta1, const double* phi1,
+                    const double* eta2, const double* phi2, std::size_t n,
+                    double* out) {
+  eta1 = vector_array_impl::aligned(eta1);
+  phi1 = vector_array_impl::aligned(phi1);
+  eta2 = vector_array_impl::aligned(eta2);
+  phi2 = vector_array_impl::aligned(phi2);
+  out = vector_array_impl::aligned(out);
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = delta_r(eta1[i], phi1[i], eta2[i], phi2[i]);
+  }
+}
+inline void delta_r(double eta1, double phi1, const double* eta2,
+                    const double* phi2, std::size_t n, double* out) {
+  eta2 = vector_array_impl::aligned(eta2);
+  phi2 = vector_array_impl::aligned(phi2);
+  out = vector_array_impl::aligned(out);
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = delta_r(eta1, phi1, eta2[i], phi2[i]);
+  }
+}
+} // namespace matching_impl
+
+template <class Q1, class R1, class Q2, class R2>
+aligned_vector<double> delta_r(const lorentzvector_array<Q1, R1>& a,
+                               const lorentzvector_array<Q2, R2>& b) {
+  vector_array_impl::check_size(a.size(), b.size());
+  const auto ca = matching_impl::make_coordinates(a);
+  const auto cb = matching_impl::make_coordinates(b);
+  aligned_vector<double> result(a.size());
+  matching_impl::delta_r(ca.eta.data(), ca.phi.data(), cb.eta.data(),
+                         cb.phi.data(), a.size(), result.data());
+  return result;
+}
+template <class Q1, class R1, class Q2, class R2>
+aligned_vector<double> delta_r(const lorentzvector<Q1, R1>& a,
+                               const lorentzvector_array<Q2, R2>& b) {
+  const auto cb = matching_impl::make_coordinates(b);
+  const double x1{vector_impl::raw(a.x.x1)}, x2{vector_impl::raw(a.x.x2)};
+  aligned_vector<double> result(b.size());
+  matching_impl::delta_r(
+      std::asinh(vector_impl::raw(a.x.x3) / std::sqrt(x1 * x1 + x2 * x2)),
+      std::atan2(x2, x1), cb.eta.data(), cb.phi.data(), b.size(),
+      result.data());
+  return result;
+}
+} // namespace physics
+
+// =============================================================================
+// implementation: matching
+// =============================================================================
+namespace physics {
+namespace matching_impl {
+// maximum number of (eta, phi) cells per axis
+constexpr std::size_t max_cells{64};
+
+// candidate pairs with deltaR <= cut, the objects of b are binned in cells of
+// at least cut x cut
+inline std::vector<match> candidates(const coordinates& a,
+                                     const coordinates& b, double cut) {
+  std::vector<match> result;
+  if (a.size() == 0 || b.size() == 0) {
+    return result;
+  }
+  double eta_lo{std::numeric_limits<double>::max()};
+  double eta_hi{std::numeric_limits<double>::lowest()};
+  for (double eta : b.eta) {
+    if (std::isfinite(eta)) {
+      eta_lo = std::min(eta_lo, eta);
+      eta_hi = std::max(eta_hi, eta);
+    }
+  }
+  const auto n_cells = [cut](double range) {
+    return range >= 2 * cut ? std::min(max_cells, static_cast<std::size_t>(
+                                                      std::floor(range / cut)))
+                            : std::size_t{1};
+  };
+  const std::size_t n_eta{eta_hi > eta_lo ? n_cells(eta_hi - eta_lo) : 1};
+  const std::size_t n_phi{n_cells(2 * pi)};
+  const double cell_eta{n_eta > 1 ? (eta_hi - eta_lo) / n_eta : 1.};
+  const double cell_phi{2 * pi / n_phi};
+  // (the comparisons also map NaN and infinities to the outer cells)
+  const auto index = [](double t, std::size_t n) -> std::size_t {
+    return !(t >= 1) ? 0 : t >= n - 1 ? n - 1 : static_cast<std::size_t>(t);
+  };
+  const auto cell_of = [&](double eta, double phi) {
+    return index((eta - eta_lo) / cell_eta, n_eta) * n_phi +
+           index((phi + pi) / cell_phi, n_phi);
+  };
+  // counting sort of b by cell
+  std::vector<std::size_t> start(n_eta * n_phi + 1, 0);
+  std::vector<std::size_t> cell(b.size());
+  for (std::size_t j = 0; j < b.size(); ++j) {
+    cell[j] = cell_of(b.eta[j], b.phi[j]);
+    ++start[cell[j] + 1];
+  }
+  std::partial_sum(start.begin(), start.end(), start.begin());
+  std::vector<std::size_t> sorted(b.size());
+  {
+    std::vector<std::size_t> next(start.begin(), start.end() - 1);
+    for (std::size_t j = 0; j < b.size(); ++j) {
+      sorted[next[cell[j]]++] = j;
+    }
+  }
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (!std::isfinite(a.eta[i])) {
+      continue;
+    }
+    const std::size_t c{cell_of(a.eta[i], a.phi[i])};
+    const std::size_t ie{c / n_phi}, ip{c % n_phi};
+    // the adjacent phi cells, without duplicates for less than 3 cells
+    const std::size_t phi_cells[3]{ip, (ip + 1) % n_phi,
+                                   (ip + n_phi - 1) % n_phi};
+    const std::size_t n_phi_cells{std::min<std::size_t>(n_phi, 3)};
+    for (std::size_t je = (ie > 0 ? ie - 1 : 0);
+         je <= std::min(ie + 1, n_eta - 1); ++je) {
+      for (std::size_t k = 0; k < n_phi_cells; ++k) {
+        const std::size_t cb{je * n_phi + phi_cells[k]};
+        for (std::size_t s = start[cb]; s < start[cb + 1]; ++s) {
+          const std::size_t j{sorted[s]};
+          const double d{delta_r(a.eta[i], a.phi[i], b.eta[j], b.phi[j])};
+          if (d <= cut) {
+            result.push_back({i, j, d});
+          }
+        }
+      }
+    }
+  }
+  return result;
+}
+
+inline std::vector<match> greedy(std::vector<match> pairs, std::size_t n_a,
+                                 std::size_t n_b) {
+  std::sort(pairs.begin(), pairs.end(), [](const match& x, const match& y) {
+    return std::tie(x.delta_r, x.first, x.second) <
+           std::tie(y.delta_r, y.first, y.second);
+  });
+  std::vector<bool> used_a(n_a, false), used_b(n_b, false);
+  std::vector<match> result;
+  for (const match& m : pairs) {
+    if (!used_a[m.first] && !used_b[m.second]) {
+      used_a[m.first] = used_b[m.second] = true;
+      result.push_back(m);
+    }
+  }
+  return result;
+}
+
+// minimum cost assignment of the n rows to distinct columns of the n x m
+// (n <= m, row-major) cost matrix, returns the column of every row
+inline std::vector<std::size_t> hungarian(const std::vector<double>& cost,
+                                          std::size_t n, std::size_t m) {
+  // potentials u (rows) and v (columns), and the row assigned to every
+  // column, with a virtual column 0 (1-based rows and columns)
+  const double inf{std::numeric_limits<double>::infinity()};
+  std::vector<double> u(n + 1, 0), v(m + 1, 0), min_v(m + 1);
+  std::vector<std::size_t> row(m + 1, 0), way(m + 1, 0);
+  std::vector<bool> used(m + 1);
+  for (std::size_t i = 1; i <= n; ++i) {
+    row[0] = i;
+    std::size_t j0{0};
+    std::fill(min_v.begin(), min_v.end(), inf);
+    std::fill(used.begin(), used.end(), false);
+    do {
+      used[j0] = true;
+      const std::size_t i0{row[j0]};
+      double delta{inf};
+      std::size_t j1{0};
+      for (std::size_t j = 1; j <= m; ++j) {
+        if (!used[j]) {
+          const double c{cost[(i0 - 1) * m + j - 1] - u[i0] - v[j]};
+          if (c < min_v[j]) {
+            min_v[j] = c;
+            way[j] = j0;
+          }
+          if (min_v[j] < delta) {
+            delta = min_v[j];
+            j1 = j;
+          }
+        }
+      }
+      for (std::size_t j = 0; j <= m; ++j) {
+        if (used[j]) {
+          u[row[j]] += delta;
+          v[j] -= delta;
+        } else {
+          min_v[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (row[j0] != 0);
+    do {
+      const std::size_t j1{way[j0]};
+      row[j0] = row[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+  std::vector<std::size_t> column(n);
+  for (std::size_t j = 1; j <= m; ++j) {
+    if (row[j] != 0) {
+      column[row[j] - 1] = j - 1;
+    }
+  }
+  return column;
+}
+
+inline std::size_t find(std::vector<std::size_t>& parent, std::size_t x) {
+  while (parent[x] != x) {
+    x = parent[x] = parent[parent[x]];
+  }
+  return x;
+}
+
+inline std::vector<match> optimal(const std::vector<match>& pairs,
+                                  std::size_t n_a, std::size_t n_b,
+                                  double cut) {
+  // connected groups of candidate pairs (objects of a, then objects of b)
+  std::vector<std::size_t> parent(n_a + n_b);
+  std::iota(parent.begin(), parent.end(), std::size_t{0});
+  for (const match& m : pairs) {
+    parent[find(parent, m.first)] = find(parent, n_a + m.second);
+  }
+  std::vector<std::vector<std::size_t>> groups(n_a + n_b);
+  for (std::size_t p = 0; p < pairs.size(); ++p) {
+    groups[find(parent, pairs[p].first)].push_back(p);
+  }
+  std::vector<match> result;
+  std::vector<std::size_t> local(n_a + n_b);
+  for (const auto& group : groups) {
+    if (group.empty()) {
+      continue;
+    }
+    // the objects of the group in the order of their indices
+    std::vector<std::size_t> rows, columns;
+    for (std::size_t p : group) {
+      rows.push_back(pairs[p].first);
+      columns.push_back(pairs[p].second);
+    }
+    for (auto* v : {&rows, &columns}) {
+      std::sort(v->begin(), v->end());
+      v->erase(std::unique(v->begin(), v->end()), v->end());
+    }
+    for (std::size_t r = 0; r < rows.size(); ++r) {
+      local[rows[r]] = r;
+    }
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+      local[n_a + columns[c]] = c;
+    }
+    // pairs that are not candidates cost more than any set of candidates, so
+    // the assignment has as many candidates as possible
+    const bool transpose{rows.size() > columns.size()};
+    const std::size_t n{transpose ? columns.size() : rows.size()};
+    const std::size_t m{transpose ? rows.size() : columns.size()};
+    const double forbidden{(n + 1) * (cut + 1)};
+    std::vector<double> cost(n * m, forbidden);
+    for (std::size_t p : group) {
+      const std::size_t r{local[pairs[p].first]};
+      const std::size_t c{local[n_a + pairs[p].second]};
+      cost[transpose ? c * m + r : r * m + c] = pairs[p].delta_r;
+    }
+    const std::vector<std::size_t> column{hungarian(cost, n, m)};
+    for (std::size_t k = 0; k < n; ++k) {
+      const double d{cost[k * m + column[k]]};
+      if (d < forbidden) {
+        const std::size_t i{transpose ? rows[column[k]] : rows[k]};
+        const std::size_t j{transpose ? columns[k] : columns[column[k]]};
+        result.push_back({i, j, d});
+      }
+    }
+  }
+  return result;
+}
+} // namespace matching_impl
+
+template <class First, class Second>
+std::vector<match> match_delta_r(const First& first, const Second& second,
+                                 double max_delta_r, match_strategy strategy) {
+  if (!(max_delta_r > 0) || !std::isfinite(max_delta_r)) {
+    throw matching_error{"invalid deltaR cut " + std::to_string(max_delta_r) +
+                             " (has to be positive)",
+                         "matching_cut_error"};
+  }
+  const auto a = matching_impl::make_coordinates(first);
+  const auto b = matching_impl::make_coordinates(second);
+  std::vector<match> pairs{matching_impl::candidates(a, b, max_delta_r)};
+  std::vector<match> result{
+      strategy == match_strategy::greedy
+          ? matching_impl::greedy(std::move(pairs), a.size(), b.size())
+          : matching_impl::optimal(pairs, a.size(), b.size(), max_delta_r)};
+  std::sort(result.begin(), result.end(),
+            [](const match& x, const match& y) { return x.first < y.first; });
+  return result;
+}
+} // namespace physics
+
+#endif
@@ -0,0 +1,378 @@
+#ifndef PHYSICS_VECTOR_PADDED_LOADED
+#define PHYSICS_VECTOR_PADDED_LOADED
+
+#include <cmath>
+#include <type_traits>
+
+#include <physics/unit.hh>
+#include <physics/vector.hh>
+
+// =============================================================================
+// padded_vector and padded_lorentzvector: opt-in 4-lane layouts of vector and
+// lorentzvector
+//
+// A vector<double> is 24 bytes, so in an array it straddles SIMD registers and
+// cache lines. padded_vector stores (x1, x2, x3, 0) in 32 bytes with 32-byte
+// alignment, padded_lorentzvector stores (x0, x1, x2, x3), the natural 4-lane
+// fit of a lorentzvector. The arithmetic is written with 256-bit GCC/clang
+// vector extensions: a single AVX instruction per operation when compiling
+// for AVX (e.g. with PHYSICS_NATIVE_ARCH), two SSE2 instructions otherwise.
+//
+// Notes:
+//  * Only quantities with a double Rep (and plain doubles) are supported, as
+//    the lanes hold the raw values. Products and quotients of quantities are
+//    products and quotients of their raw values, so the unit bookkeeping
+//    happens entirely in the types, as for vector/lorentzvector.
+//  * The components are accessed through x1(), x2(), x3() (and x0()), and
+//    both types convert to and from vector/lorentzvector.
+//  * Arrays of padded vectors need over-aligned storage, e.g. an
+//    aligned_vector from physics/util/aligned.hh.
+//  * The padding costs a third more memory bandwidth than vector<double>,
+//    and the horizontal sums of dot products are not free: bench/bench_padded
+//    compares both layouts for mag() and boost(). For batch work over many
+//    vectors, the SoA vector_array is the faster layout.
+// =============================================================================
+namespace physics {
+namespace padded_impl {
+// four double lanes
+typedef double lanes __attribute__((vector_size(32)));
+} // namespace padded_impl
+
+template <class Quantity, class Radian = double> class padded_vector;
+template <class Quantity, class Radian = double> class padded_lorentzvector;
+
+template <class Quantity, class Radian> class alignas(32) padded_vector {
+public:
+  using quantity_type = Quantity;
+  using radian_type = Radian;
+  using vector_type = vector<Quantity, Radian>;
+  using lanes = padded_impl::lanes;
+
+  constexpr padded_vector() : x_{0., 0., 0., 0.} {}
+  explicit padded_vector(quantity_type x123)
+      : padded_vector{x123, x123, x123} {}
+  padded_vector(quantity_type y1, quantity_type y2, quantity_type y3);
+  padded_vector(const vector_type& v) : padded_vector{v.x1, v.x2, v.x3} {}
+  // from the raw lanes (the fourth lane has to be zero)
+  explicit constexpr padded_vector(const lanes& x) : x_(x) {}
+
+  operator vector_type() const { return {x1(), x2(), x3()}; }
+  quantity_type x1() const;
+  quantity_type x2() const;
+  quantity_type x3() const;
+  constexpr const lanes& raw() const { return x_; }
+
+  // comparison
+  bool operator==(const padded_vector& v) const;
+  bool operator!=(const padded_vector& v) const { return !(*this == v); }
+
+  // vector arithmetic (see vector)
+  padded_vector operator+(const padded_vector& v) const {
+    return padded_vector{x_ + v.x_};
+  }
+  padded_vector operator-(const padded_vector& v) const {
+    return padded_vector{x_ - v.x_};
+  }
+  template <class Q2> auto operator*(Q2 q) const;
+  template <class Q2> auto operator/(Q2 q) const;
+  template <class Q2, class R2>
+  auto operator*(const padded_vector<Q2, R2>& v) const;
+  template <class Q2, class R2>
+  auto operator^(const padded_vector<Q2, R2>& v) const;
+  padded_vector& operator+=(const padded_vector& v) {
+    x_ += v.x_;
+    return *this;
+  }
+  padded_vector& operator-=(const padded_vector& v) {
+    x_ -= v.x_;
+    return *this;
+  }
+  padded_vector& operator*=(double d) {
+    x_ *= d;
+    return *this;
+  }
+  padded_vector& operator/=(double d) {
+    x_ /= d;
+    return *this;
+  }
+  auto mag2() const { return *this * *this; }
+  auto mag() const { return std::sqrt(mag2()); }
+
+private:
+  lanes x_;
+};
+
+template <class Quantity, class Radian> class alignas(32) padded_lorentzvector {
+public:
+  using quantity_type = Quantity;
+  using radian_type = Radian;
+  using vector_type = vector<Quantity, Radian>;
+  using lorentzvector_type = lorentzvector<Quantity, Radian>;
+  using lanes = padded_impl::lanes;
+
+  constexpr padded_lorentzvector() : x_{0., 0., 0., 0.} {}
+  padded_lorentzvector(quantity_type y0, const vector_type& y);
+  padded_lorentzvector(const lorentzvector_type& v)
+      : padded_lorentzvector{v.x0, v.x} {}
+  explicit constexpr padded_lorentzvector(const lanes& x) : x_(x) {}
+
+  operator lorentzvector_type() const { return {x0(), x()}; }
+  quantity_type x0() const;
+  vector_type x() const;
+  constexpr const lanes& raw() const { return x_; }
+
+  // comparison
+  bool operator==(const padded_lorentzvector& v) const;
+  bool operator!=(const padded_lorentzvector& v) const {
+    return !(*this == v);
+  }
+
+  // lorentzvector arithmetic (see lorentzvector)
+  padded_lorentzvector operator+(const padded_lorentzvector& v) const {
+    return padded_lorentzvector{x_ + v.x_};
+  }
+  padded_lorentzvector operator-(const padded_lorentzvector& v) const {
+    return padded_lorentzvector{x_ - v.x_};
+  }
+  template <class Q2> auto operator*(Q2 q) const;
+  template <class Q2> auto operator/(Q2 q) const;
+  template <class Q2, class R2>
+  auto operator*(const padded_lorentzvector<Q2, R2>& v) const;
+  padded_lorentzvector& operator+=(const padded_lorentzvector& v) {
+    x_ += v.x_;
+    return *this;
+  }
+  padded_lorentzvector& operator-=(const padded_lorentzvector& v) {
+    x_ -= v.x_;
+    return *this;
+  }
+  padded_lorentzvector& operator*=(double d) {
+    x_ *= d;
+    return *this;
+  }
+  padded_lorentzvector& operator/=(double d) {
+    x_ /= d;
+    return *this;
+  }
+  auto mag2() const { return *this * *this; }
+  auto mag() const;
+  auto beta() const;
+  template <class Q2, class R2>
+  padded_lorentzvector boost(const padded_vector<Q2, R2>& beta) const;
+
+private:
+  lanes x_;
+};
+} // namespace physics
+
+// =============================================================================
+// implementation: helpers
+// =============================================================================
+namespace physics {
+namespace padded_impl {
+template <class T> struct layout {
+  static_assert(std::is_same<T, double>::value,
+                "padded vectors require double lanes.");
+  static constexpr T from_raw(double x) { return x; }
+};
+template <class Unit, class Rep> struct layout<quantity<Unit, Rep>> {
+  static_assert(std::is_same<Rep, double>::value,
+                "padded vectors require quantities with a double Rep.");
+  static constexpr quantity<Unit, Rep> from_raw(double x) {
+    return quantity<Unit, Rep>{x};
+  }
+};
+template <class T> constexpr T from_raw(double x) {
+  return layout<T>::from_raw(x);
+}
+// raw value of a quantity or scalar
+template <class T> constexpr double raw(T x) { return static_cast<double>(x); }
+template <class Unit, class Rep> constexpr double raw(quantity<Unit, Rep> q) {
+  return static_cast<double>(q.raw_value());
+}
+// lane permutations (a macro rather than a function, as GCC warns about the
+// changed ABI of functions returning 256-bit vectors when AVX is disabled)
+typedef long long index_lanes __attribute__((vector_size(32)));
+#if defined(__clang__)
+#define PHYSICS_PADDED_SHUFFLE(x, i0, i1, i2, i3)                              \
+  __builtin_shufflevector(x, x, i0, i1, i2, i3)
+#else
+#define PHYSICS_PADDED_SHUFFLE(x, i0, i1, i2, i3)                              \
+  __builtin_shuffle(x, physics::padded_impl::index_lanes{i0, i1, i2, i3})
+#endif
+inline double hsum(const lanes& x) { return (x[0] + x[1]) + (x[2] + x[3]); }
+inline bool all_equal(const lanes& x, const lanes& y) {
+  return x[0] == y[0] && x[1] == y[1] && x[2] == y[2] && x[3] == y[3];
+}
+} // namespace padded_impl
+} // namespace physics
+
+// =============================================================================
+// implementation: padded_vector
+// =============================================================================
+namespace physics {
+template <class Quantity, class Radian>
+padded_vector<Quantity, Radian>::padded_vector(quantity_type y1,
+                                               quantity_type y2,
+                                               quantity_type y3)
+    : x_{padded_impl::raw(y1), padded_impl::raw(y2), padded_impl::raw(y3),
+         0.} {}
+template <class Quantity, class Radian>
+Quantity padded_vector<Quantity, Radian>::x1() const {
+  return padded_impl::from_raw<Quantity>(x_[0]);
+}
+template <class Quantity, class Radian>
+Quantity padded_vector<Quantity, Radian>::x2() const {
+  return padded_impl::from_raw<Quantity>(x_[1]);
+}
+template <class Quantity, class Radian>
+Quantity padded_vector<Quantity, Radian>::x3() const {
+  return padded_impl::from_raw<Quantity>(x_[2]);
+}
+template <class Quantity, class Radian>
+bool padded_vector<Quantity, Radian>::
+operator==(const padded_vector& v) const {
+  return padded_impl::all_equal(x_, v.x_);
+}
+template <class Quantity, class Radian>
+template <class Q2>
+auto padded_vector<Quantity, Radian>::operator*(Q2 q) const {
+  using result_type = decltype(std::declval<Quantity>() * q);
+  return padded_vector<result_type, Radian>{x_ * padded_impl::raw(q)};
+}
+template <class Quantity, class Radian>
+template <class Q2>
+auto padded_vector<Quantity, Radian>::operator/(Q2 q) const {
+  using result_type = decltype(std::declval<Quantity>() / q);
+  return padded_vector<result_type, Radian>{x_ / padded_impl::raw(q)};
+}
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+auto padded_vector<Quantity, Radian>::
+operator*(const padded_vector<Q2, R2>& v) const {
+  using result_type = decltype(std::declval<Quantity>() * std::declval<Q2>());
+  return padded_impl::from_raw<result_type>(padded_impl::hsum(x_ * v.raw()));
+}
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+auto padded_vector<Quantity, Radian>::
+operator^(const padded_vector<Q2, R2>& v) const {
+  using result_type = decltype(std::declval<Quantity>() * std::declval<Q2>());
+  // (x2 y3 - x3 y2, x3 y1 - x1 y3, x1 y2 - x2 y1, 0)
+  const lanes y{v.raw()};
+  return padded_vector<result_type, Radian>{
+      PHYSICS_PADDED_SHUFFLE(x_, 1, 2, 0, 3) *
+          PHYSICS_PADDED_SHUFFLE(y, 2, 0, 1, 3) -
+      PHYSICS_PADDED_SHUFFLE(x_, 2, 0, 1, 3) *
+          PHYSICS_PADDED_SHUFFLE(y, 1, 2, 0, 3)};
+}
+} // namespace physics
+
+// =============================================================================
+// implementation: padded_lorentzvector
+// =============================================================================
+namespace physics {
+template <class Quantity, class Radian>
+padded_lorentzvector<Quantity, Radian>::padded_lorentzvector(
+    quantity_type y0, const vector_type& y)
+    : x_{padded_impl::raw(y0), padded_impl::raw(y.x1), padded_impl::raw(y.x2),
+         padded_impl::raw(y.x3)} {}
+template <class Quantity, class Radian>
+Quantity padded_lorentzvector<Quantity, Radian>::x0() const {
+  return padded_impl::from_raw<Quantity>(x_[0]);
+}
+template <class Quantity, class Radian>
+vector<Quantity, Radian> padded_lorentzvector<Quantity, Radian>::x() const {
+  return {padded_impl::from_raw<Quantity>(x_[1]),
+          padded_impl::from_raw<Quantity>(x_[2]),
+          padded_impl::from_raw<Quantity>(x_[3])};
+}
+template <class Quantity, class Radian>
+bool padded_lorentzvector<Quantity, Radian>::
+operator==(const padded_lorentzvector& v) const {
+  return padded_impl::all_equal(x_, v.x_);
+}
+template <class Quantity, class Radian>
+template <class Q2>
+auto padded_lorentzvector<Quantity, Radian>::operator*(Q2 q) const {
+  using result_type = decltype(std::declval<Quantity>() * q);
+  return padded_lorentzvector<result_type, Radian>{x_ * padded_impl::raw(q)};
+}
+template <class Quantity, class Radian>
+template <class Q2>
+auto padded_lorentzvector<Quantity, Radian>::operator/(Q2 q) const {
+  using result_type = decltype(std::declval<Quantity>() / q);
+  return padded_lorentzvector<result_type, Radian>{x_ / padded_impl::raw(q)};
+}
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+auto padded_lorentzvector<Quantity, Radian>::
+operator*(const padded_lorentzvector<Q2, R2>& v) const {
+  using result_type = decltype(std::declval<Quantity>() * std::declval<Q2>());
+  const lanes metric{1., -1., -1., -1.};
+  return padded_impl::from_raw<result_type>(
+      padded_impl::hsum(x_ * v.raw() * metric));
+}
+template <class Quantity, class Radian>
+auto padded_lorentzvector<Quantity, Radian>::mag() const {
+  using mag2_type = decltype(mag2());
+  const mag2_type m2{mag2()};
+  return (m2 >= mag2_type{0}) ? std::sqrt(m2) : -std::sqrt(-m2);
+}
+template <class Quantity, class Radian>
+auto padded_lorentzvector<Quantity, Radian>::beta() const {
+  using result_type = decltype(std::declval<Quantity>() / x0());
+  // (x1, x2, x3, 0) / x0
+  const lanes mask{1., 1., 1., 0.};
+  return padded_vector<result_type, Radian>{
+      PHYSICS_PADDED_SHUFFLE(x_, 1, 2, 3, 0) * mask / x_[0]};
+}
+template <class Quantity, class Radian>
+template <class Q2, class R2>
+padded_lorentzvector<Quantity, Radian>
+padded_lorentzvector<Quantity, Radian>::boost(
+    const padded_vector<Q2, R2>& beta) const {
+  static_assert(unit_impl::is_dimensionless_value<Q2>::value,
+                "beta has to be dimensionless");
+  // beta in the lanes of x (0, b1, b2, b3), in its numerical value
+  const lanes b{PHYSICS_PADDED_SHUFFLE(beta.raw(), 3, 0, 1, 2) *
+                static_cast<double>(padded_impl::from_raw<Q2>(1.))};
+  const double b2{padded_impl::hsum(b * b)};
+  const double bx{padded_impl::hsum(b * x_)};
+  const double gamma{1. / std::sqrt(1. - b2)};
+  // (gamma - 1) / b2, also well-defined for b2 = 0
+  const double factor{gamma * gamma / (gamma + 1.)};
+  // x' = x + b (factor bx - gamma x0) and x0' = gamma (x0 - bx), with the
+  // x0 lane written through e0 = (1, 0, 0, 0) instead of a lane insertion
+  const lanes e0{1., 0., 0., 0.};
+  const double x0{x_[0]};
+  return padded_lorentzvector{x_ + b * (factor * bx - gamma * x0) +
+                              e0 * (gamma * (x0 - bx) - x0)};
+}
+} // namespace physics
+
+// global multiplication operators with quantities and doubles
+template <class Unit, class Rep, class Quantity, class Radian>
+auto operator*(physics::quantity<Unit, Rep> q,
+               const physics::padded_vector<Quantity, Radian>& v) {
+  return v * q;
+}
+template <class T, class Quantity, class Radian,
+          class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+auto operator*(T d, const physics::padded_vector<Quantity, Radian>& v) {
+  return v * d;
+}
+template <class Unit, class Rep, class Quantity, class Radian>
+auto operator*(physics::quantity<Unit, Rep> q,
+               const physics::padded_lorentzvector<Quantity, Radian>& v) {
+  return v * q;
+}
+template <class T, class Quantity, class Radian,
+          class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+auto operator*(T d, const physics::padded_lorentzvector<Quantity, Radian>& v) {
+  return v * d;
+}
+
+#undef PHYSICS_PADDED_SHUFFLE
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef PHYSICS_VECTOR_TRANSFORM_LOADED
+#define PHYSICS_VECTOR_TRANSFORM_LOADED
+
+#include <cmath>
+#include <cstddef>
+
+#include <physics/vector.hh>
+#include <physics/vector/array.hh>
+#include <physics/vector/boost.hh>
+
+// =============================================================================
+// rotation3 and lorentz_transform: composable rotations and general Lorentz
+// transformations
+//
+// rotation3 is a proper rotation in 3D, stored both as a unit quaternion
+// (w, x, y, z) and as the corresponding 3x3 matrix. lorentz_transform is a
+// general Lorentz transformation, stored as a 4x4 matrix acting on (x0, x).
+//
+// Notes:
+//  * Transformations compose with operator*: (a * b)(v) == a(b(v)), i.e. b is
+//    applied first. A chain of rotations and boosts therefore collapses into
+//    a single matrix before it is applied to any vector. rotation3 * rotation3
+//    is a rotation3 (composed through the quaternions), any product involving
+//    a boost_transform or a lorentz_transform is a lorentz_transform.
+//  * rotation3 applies to vectors and to the spatial part of lorentzvectors,
+//    lorentz_transform applies to lorentzvectors. Both apply to single
+//    vectors with operator(), and to vector_array/lorentzvector_array batches
+//    (in place) with apply(), using the same column kernel as boost_transform.
+//  * The transformations are unit-agnostic: the result keeps the Quantity of
+//    the input, and the arithmetic is done in double precision. Dimensionless
+//    inputs (e.g. beta) are checked with unit_impl::is_dimensionless_value.
+// =============================================================================
+namespace physics {
+class rotation3 {
+public:
+  // identity rotation
+  rotation3() : rotation3{1., 0., 0., 0.} {}
+  // right-handed rotation by angle around axis (the axis can have any unit,
+  // only its direction matters)
+  template <class Q, class R, class Angle>
+  rotation3(const vector<Q, R>& axis, Angle angle);
+  // rotation from a quaternion (w, x, y, z), normalized on construction
+  rotation3(double w, double x, double y, double z);
+
+  const double (&quaternion() const)[4] { return q_; }
+  const double (&matrix() const)[3][3] { return matrix_; }
+  rotation3 inverse() const { return {q_[0], -q_[1], -q_[2], -q_[3]}; }
+
+  // composition: (*this * r)(v) == (*this)(r(v))
+  rotation3 operator*(const rotation3& r) const;
+
+  // rotate single vectors (for lorentzvectors, only the spatial part)
+  template <class Q, class R>
+  vector<Q, R> operator()(const vector<Q, R>& v) const;
+  template <class Q, class R, class Element>
+  vector<Q, R> operator()(const vector_reference<Q, R, Element>& v) const {
+    return (*this)(vector<Q, R>{v});
+  }
+  template <class Q, class R>
+  lorentzvector<Q, R> operator()(const lorentzvector<Q, R>& v) const {
+    return {v.x0, (*this)(v.x)};
+  }
+  template <class Q, class R, class Element>
+  lorentzvector<Q, R>
+  operator()(const lorentzvector_reference<Q, R, Element>& v) const {
+    return (*this)(lorentzvector<Q, R>{v});
+  }
+  // rotate whole arrays in place, and copies of arrays
+  template <class Q, class R> void apply(vector_array<Q, R>& v) const;
+  template <class Q, class R> void apply(lorentzvector_array<Q, R>& v) const {
+    apply(v.x());
+  }
+  template <class Q, class R>
+  vector_array<Q, R> operator()(vector_array<Q, R> v) const {
+    apply(v);
+    return v;
+  }
+  template <class Q, class R>
+  lorentzvector_array<Q, R> operator()(lorentzvector_array<Q, R> v) const {
+    apply(v);
+    return v;
+  }
+
+private:
+  double q_[4];
+  double matrix_[3][3];
+};
+
+class lorentz_transform {
+public:
+  // identity transformation
+  lorentz_transform();
+  // (implicit) conversion from rotations and boosts
+  lorentz_transform(const rotation3& r);
+  lorentz_transform(const boost_transform& b)
+      : lorentz_transform{b.matrix()} {}
+  // from a 4x4 matrix acting on (x0, x1, x2, x3)
+  explicit lorentz_transform(const double (&matrix)[4][4]);
+
+  const double (&matrix() const)[4][4] { return matrix_; }
+  // the inverse, using the metric: inverse = eta * transpose * eta
+  lorentz_transform inverse() const;
+
+  // transform single lorentzvectors
+  template <class Q, class R>
+  lorentzvector<Q, R> operator()(const lorentzvector<Q, R>& v) const;
+  template <class Q, class R, class Element>
+  lorentzvector<Q, R>
+  operator()(const lorentzvector_reference<Q, R, Element>& v) const {
+    return (*this)(lorentzvector<Q, R>{v});
+  }
+  // transform whole arrays in place, and copies of arrays
+  template <class Q, class R> void apply(lorentzvector_array<Q, R>& v) const;
+  template <class Q, class R>
+  lorentzvector_array<Q, R> operator()(lorentzvector_array<Q, R> v) const {
+    apply(v);
+    return v;
+  }
+
+private:
+  double matrix_[4][4];
+};
+
+// composition: (a * b)(v) == a(b(v)). Any combination of rotation3,
+// boost_transform and lorentz_transform (except rotation3 * rotation3) yields
+// a lorentz_transform.
+lorentz_transform operator*(const lorentz_transform& a,
+                            const lorentz_transform& b);
+} // namespace physics
+
+// =============================================================================
+// implementation: rotation3
+// =============================================================================
+namespace physics {
+template <class Q, class R, class Angle>
+rotation3::rotation3(const vector<Q, R>& axis, Angle angle)
+    : rotation3{} {
+  using std::cos;
+  using std::sin;
+  const double u[3]{transform_impl::raw(axis.x1), transform_impl::raw(axis.x2),
+                    transform_impl::raw(axis.x3)};
+  const double norm{std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2])};
+  if (norm > 0) {
+    const double s{static_cast<double>(sin(angle * 0.5)) / norm};
+    *this = rotation3{static_cast<double>(cos(angle * 0.5)), s * u[0],
+                      s * u[1], s * u[2]};
+  }
+}
+inline rotation3::rotation3(double w, double x, double y, double z) {
+  const double norm{std::sqrt(w * w + x * x + y * y + z * z)};
+  q_[0] = w / norm;
+  q_[1] = x / norm;
+  q_[2] = y / norm;
+  q_[3] = z / norm;
+  w = q_[0];
+  x = q_[1];
+  y = q_[2];
+  z = q_[3];
+  matrix_[0][0] = 1. - 2. * (y * y + z * z);
+  matrix_[0][1] = 2. * (x * y - z * w);
+  matrix_[0][2] = 2. * (x * z + y * w);
+  matrix_[1][0] = 2. * (x * y + z * w);
+  matrix_[1][1] = 1. - 2. * (x * x + z * z);
+  matrix_[1][2] = 2. * (y * z - x * w);
+  matrix_[2][0] = 2. * (x * z - y * w);
+  matrix_[2][1] = 2. * (y * z + x * w);
+  matrix_[2][2] = 1. - 2. * (x * x + y * y);
+}
+inline rotation3 rotation3::operator*(const rotation3& r) const {
+  // Hamilton product q_ * r.q_
+  const double(&a)[4] = q_;
+  const double(&b)[4] = r.q_;
+  return {a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+          a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+          a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+          a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0]};
+}
+template <class Q, class R>
+vector<Q, R> rotation3::operator()(const vector<Q, R>& v) const {
+  using transform_impl::raw;
+  using transform_impl::from_raw;
+  const double x[3]{raw(v.x1), raw(v.x2), raw(v.x3)};
+  double y[3];
+  for (int i = 0; i < 3; ++i) {
+    y[i] = matrix_[i][0] * x[0] + matrix_[i][1] * x[1] + matrix_[i][2] * x[2];
+  }
+  return {from_raw<Q>::get(y[0]), from_raw<Q>::get(y[1]),
+          from_raw<Q>::get(y[2])};
+}
+template <class Q, class R>
+void rotation3::apply(vector_array<Q, R>& v) const {
+  transform_impl::transform_columns(
+      matrix_, {v.x1().data(), v.x2().data(), v.x3().data()}, v.size());
+}
+} // namespace physics
+
+// =============================================================================
+// implementation: lorentz_transform
+// =============================================================================
+namespace physics {
+inline lorentz_transform::lorentz_transform()
+    : lorentz_transform{rotation3{}} {}
+inline lorentz_transform::lorentz_transform(const rotation3& r) {
+  matrix_[0][0] = 1.;
+  for (int i = 0; i < 3; ++i) {
+    matrix_[0][i + 1] = 0.;
+    matrix_[i + 1][0] = 0.;
+    for (int j = 0; j < 3; ++j) {
+      matrix_[i + 1][j + 1] = r.matrix()[i][j];
+    }
+  }
+}
+inline lorentz_transform::lorentz_transform(const double (&matrix)[4][4]) {
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      matrix_[i][j] = matrix[i][j];
+    }
+  }
+}
+inline lorentz_transform lorentz_transform::inverse() const {
+  double m[4][4];
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      m[i][j] = ((i == 0) == (j == 0) ? 1. : -1.) * matrix_[j][i];
+    }
+  }
+  return lorentz_transform{m};
+}
+template <class Q, class R>
+lorentzvector<Q, R> lorentz_transform::
+operator()(const lorentzvector<Q, R>& v) const {
+  return transform_impl::transform_lorentzvector(matrix_, v);
+}
+template <class Q, class R>
+void lorentz_transform::apply(lorentzvector_array<Q, R>& v) const {
+  transform_impl::transform_columns(
+      matrix_, {v.x0().data(), v.x().x1().data(), v.x().x2().data(),
+                v.x().x3().data()},
+      v.size());
+}
+inline lorentz_transform operator*(const lorentz_transform& a,
+                                   const lorentz_transform& b) {
+  double m[4][4];
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      m[i][j] = 0.;
+      for (int k = 0; k < 4; ++k) {
+        m[i][j] += a.matrix()[i][k] * b.matrix()[k][j];
+      }
+    }
+  }
+  return lorentz_transform{m};
+}
+} // namespace physics
+
+#endif
@@ -0,0 +1,177 @@
+// Kernels for the codegen regression test (test_codegen.cc).
+//
+// Every kernel is written twice: kernel_<name>_double with raw doubles, and
+// kernel_<name>_quantity with physics::quantity, vector and lorentzvector.
+// This file is compiled at -O2 into an object file, and test_codegen compares
+// the disassembly of both versions. It is compiled with -fno-math-errno, so
+// that sqrt() is a single instruction in both versions, and any remaining
+// libm call (e.g. pow or cbrt from pow_impl) stands out.
+//
+// The kernels are marked noipa so that the compiler keeps each one as a
+// separate function with the regular calling convention (the quantity
+// versions have internal linkage, through the unit names).
+
+#include "physics/unit.hh"
+#include "physics/unit/standard.hh"
+#include "physics/vector.hh"
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__clang__)
+#define CODEGEN_KERNEL __attribute__((used, noinline))
+#else
+#define CODEGEN_KERNEL __attribute__((used, noipa))
+#endif
+
+namespace su = physics::standard_units;
+
+// =============================================================================
+// unit conversions (rescale_value)
+// =============================================================================
+// prefixed units
+CODEGEN_KERNEL double kernel_convert_double(double cm) { return cm * 10.; }
+CODEGEN_KERNEL su::distance::mm kernel_convert_quantity(su::distance::cm cm) {
+  return cm;
+}
+// units with a factor (inch to mm)
+CODEGEN_KERNEL double kernel_convert_factor_double(double in) {
+  return in * 25.4;
+}
+CODEGEN_KERNEL su::distance::mm
+kernel_convert_factor_quantity(su::distance::inch in) {
+  return in;
+}
+// units with fractional powers of 10 (sqrt(km) to sqrt(mm))
+using sqrt_km = decltype(su::distance::km{}.sqrt());
+using sqrt_mm = decltype(su::distance::mm{}.sqrt());
+CODEGEN_KERNEL double kernel_convert_fractional_double(double x) {
+  return x * 1000.;
+}
+CODEGEN_KERNEL sqrt_mm kernel_convert_fractional_quantity(sqrt_km x) {
+  return x;
+}
+// angles (factors of pi)
+CODEGEN_KERNEL double kernel_convert_degree_double(double deg) {
+  return deg * 0.017453292519943295;
+}
+CODEGEN_KERNEL su::angle::rad
+kernel_convert_degree_quantity(su::angle::degree deg) {
+  return deg;
+}
+// fixed point counts
+using tdc_time = physics::fixed_quantity<su::time::ns, std::ratio<25, 1024>>;
+CODEGEN_KERNEL double kernel_convert_fixed_double(int tdc) {
+  return tdc * 0.0244140625;
+}
+CODEGEN_KERNEL su::time::ns kernel_convert_fixed_quantity(tdc_time tdc) {
+  return su::time::ns{tdc};
+}
+
+// =============================================================================
+// arithmetic
+// =============================================================================
+CODEGEN_KERNEL double kernel_velocity_double(double x, double t) {
+  return x / t;
+}
+CODEGEN_KERNEL auto kernel_velocity_quantity(su::distance::m x,
+                                             su::time::s t) {
+  return x / t;
+}
+CODEGEN_KERNEL double kernel_energy_double(double p, double m) {
+  return std::sqrt(p * p + m * m);
+}
+CODEGEN_KERNEL su::energy::MeV kernel_energy_quantity(su::energy::MeV p,
+                                                      su::energy::MeV m) {
+  return sqrt(p * p + m * m);
+}
+CODEGEN_KERNEL double kernel_pow_double(double x) { return x * x * x; }
+CODEGEN_KERNEL auto kernel_pow_quantity(su::distance::mm x) {
+  return x.pow<3>();
+}
+
+// =============================================================================
+// dimensionless specialization
+// =============================================================================
+CODEGEN_KERNEL double kernel_dimensionless_double(double mm, double cm) {
+  return mm / cm * 0.1 + 1.;
+}
+CODEGEN_KERNEL double kernel_dimensionless_quantity(su::distance::mm mm,
+                                                    su::distance::cm cm) {
+  return mm / cm + 1.;
+}
+
+// =============================================================================
+// vector and lorentzvector
+// =============================================================================
+struct double3 {
+  double x, y, z;
+};
+struct double4 {
+  double t, x, y, z;
+};
+using momentum_vector = physics::vector<su::energy::MeV>;
+using momentum_lorentzvector = physics::lorentzvector<su::energy::MeV>;
+
+CODEGEN_KERNEL double kernel_dot_double(const double3& a, const double3& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+CODEGEN_KERNEL auto kernel_dot_quantity(const momentum_vector& a,
+                                        const momentum_vector& b) {
+  return a * b;
+}
+CODEGEN_KERNEL double kernel_mag_double(const double3& a) {
+  return std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
+}
+CODEGEN_KERNEL auto kernel_mag_quantity(const momentum_vector& a) {
+  return a.mag();
+}
+CODEGEN_KERNEL void kernel_cross_double(const double3& a, const double3& b,
+                                        double3& c) {
+  c = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+CODEGEN_KERNEL void kernel_cross_quantity(const momentum_vector& a,
+                                          const momentum_vector& b,
+                                          physics::vector<decltype(
+                                              su::energy::MeV{} *
+                                              su::energy::MeV{})>& c) {
+  c = a ^ b;
+}
+CODEGEN_KERNEL double kernel_mass2_double(const double4& a) {
+  return a.t * a.t - (a.x * a.x + a.y * a.y + a.z * a.z);
+}
+CODEGEN_KERNEL auto kernel_mass2_quantity(const momentum_lorentzvector& a) {
+  return a.mag2();
+}
+
+// =============================================================================
+// loops
+// =============================================================================
+CODEGEN_KERNEL double kernel_sum_double(const double* x, std::size_t n) {
+  double sum{0};
+  for (std::size_t i = 0; i < n; ++i) {
+    sum += x[i];
+  }
+  return sum * 1000.;
+}
+CODEGEN_KERNEL su::energy::MeV kernel_sum_quantity(const su::energy::GeV* x,
+                                                   std::size_t n) {
+  su::energy::GeV sum{0};
+  for (std::size_t i = 0; i < n; ++i) {
+    sum += x[i];
+  }
+  return sum;
+}
+CODEGEN_KERNEL void kernel_scale_double(double* x, const double* y,
+                                        std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    x[i] = y[i] * 1e-3;
+  }
+}
+CODEGEN_KERNEL void kernel_scale_quantity(su::energy::GeV* x,
+                                          const su::energy::MeV* y,
+                                          std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    x[i] = y[i];
+  }
+}
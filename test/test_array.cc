@@ -0,0 +1,289 @@
+#include <iostream>
+#include <vector>
+
+#define BOOST_TEST_MODULE test_array
+#include <boost/test/unit_test.hpp>
+
+#include "physics/unit.hh"
+#include "physics/unit/array.hh"
+#include "physics/unit/constants.hh"
+#include "physics/unit/standard.hh"
+
+#include <cmath>
+#include <cstdint>
+
+using std::fabs;
+
+namespace su = physics::standard_units;
+
+BOOST_AUTO_TEST_CASE(test_span) {
+  std::vector<double> v{1., 2., 3., 4.};
+  // span from container
+  physics::span<double> s1{v};
+  BOOST_CHECK((s1.size() == 4 && s1.data() == v.data()));
+  BOOST_CHECK((s1[2] == 3. && s1.front() == 1. && s1.back() == 4.));
+  s1[2] = 5.;
+  BOOST_CHECK((v[2] == 5.));
+  // implicit conversion to const span
+  physics::span<const double> s2{s1};
+  BOOST_CHECK((s2.size() == 4 && s2[2] == 5.));
+  // sub-views
+  BOOST_CHECK((s1.first(2).size() == 2 && s1.first(2)[1] == 2.));
+  BOOST_CHECK((s1.last(1)[0] == 4.));
+  BOOST_CHECK((s1.subspan(1, 2)[0] == 2. && s1.subspan(1, 2).size() == 2));
+  // range-for
+  double sum{0};
+  for (auto x : physics::make_span(v)) {
+    sum += x;
+  }
+  BOOST_CHECK((sum == 12.));
+}
+
+BOOST_AUTO_TEST_CASE(test_quantity_array) {
+  using mm_array = physics::quantity_array<su::distance::mm::unit>;
+  using m_array = physics::quantity_array<su::distance::m::unit>;
+
+  // construction, alignment and element access
+  {
+    mm_array a(100);
+    BOOST_CHECK((a.size() == 100));
+    BOOST_CHECK((reinterpret_cast<std::uintptr_t>(a.data()) %
+                     PHYSICS_SIMD_ALIGNMENT ==
+                 0));
+    // sizes that overflow the byte count are refused
+    physics::aligned_allocator<double> allocator;
+    BOOST_CHECK_THROW(allocator.allocate(SIZE_MAX / 4), std::bad_alloc);
+    BOOST_CHECK((a[42] == su::distance::mm{0}));
+    a[42] = su::distance::mm{3.};
+    BOOST_CHECK((a.raw_data()[42] == 3.));
+    mm_array b{su::distance::mm{1}, su::distance::mm{2}};
+    BOOST_CHECK((b.size() == 2 && b[1].value() == 2.));
+    // from a span of compatible quantities (rescales)
+    std::vector<su::distance::m> vm{su::distance::m{1}, su::distance::m{2}};
+    mm_array c{physics::make_span(vm)};
+    BOOST_CHECK((c[0].value() == 1000. && c[1].value() == 2000.));
+    physics::const_quantity_span<su::distance::mm::unit> sc{c};
+    BOOST_CHECK((sc.size() == 2 && sc[1].value() == 2000.));
+  }
+
+  // element-wise arithmetic
+  constexpr std::size_t n{1001}; // deliberately not a multiple of the SIMD width
+  mm_array a(n);
+  mm_array b(n);
+  m_array c(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    a[i] = su::distance::mm{1. + i};
+    b[i] = su::distance::mm{0.5 * i};
+    c[i] = su::distance::m{0.001 * i};
+  }
+  {
+    auto sum = a + b;
+    auto diff = a - c; // rescales c to mm
+    auto prod = a * b;
+    auto ratio = b / a;
+    auto neg = -a;
+    BOOST_CHECK((physics::unit_string(sum[0]) == " mm"));
+    BOOST_CHECK((physics::unit_string(prod[0]) == " mm^2"));
+    BOOST_CHECK((physics::unit_string(ratio[0]) == ""));
+    bool ok{true};
+    for (std::size_t i = 0; i < n; ++i) {
+      ok &= (sum[i] == a[i] + b[i]);
+      ok &= (fabs((diff[i] - (a[i] - c[i])).value()) < 1.e-10);
+      ok &= (prod[i] == a[i] * b[i]);
+      ok &= (ratio[i] == b[i] / a[i]);
+      ok &= (neg[i] == -a[i]);
+    }
+    BOOST_CHECK(ok);
+  }
+  {
+    constexpr su::time::ns t{2.};
+    auto ms = a * t;
+    auto sm = t * a;
+    auto ds = a / t;
+    auto sd = t / a;
+    auto md = a * 3.;
+    auto dm = 3. * a;
+    auto dd = a / 4.;
+    auto inv = 1. / a;
+    BOOST_CHECK((physics::unit_string(ds[0]) == " mm ns^-1"));
+    BOOST_CHECK((physics::unit_string(inv[0]) == " mm^-1"));
+    bool ok{true};
+    for (std::size_t i = 0; i < n; ++i) {
+      ok &= (ms[i] == a[i] * t && sm[i] == t * a[i]);
+      ok &= (ds[i] == a[i] / t && sd[i] == t / a[i]);
+      ok &= (md[i] == a[i] * 3. && dm[i] == 3. * a[i]);
+      ok &= (dd[i] == a[i] / 4. && inv[i] == 1. / a[i]);
+    }
+    BOOST_CHECK(ok);
+  }
+  // compound assignment
+  {
+    mm_array x{a};
+    x += b;
+    x -= su::distance::mm{1.};
+    x *= 2.;
+    x /= 4.;
+    x -= c;
+    bool ok{true};
+    for (std::size_t i = 0; i < n; ++i) {
+      auto ref = ((a[i] + b[i] - su::distance::mm{1.}) * 2. / 4.) -
+                 su::distance::mm{c[i]};
+      ok &= (fabs((x[i] - ref).value()) < 1.e-10);
+    }
+    BOOST_CHECK(ok);
+    mm_array y(n - 1);
+    BOOST_CHECK_THROW(y += a, physics::expression_error);
+    BOOST_CHECK_THROW(a * y, physics::expression_error);
+  }
+  // powers
+  {
+    auto a2 = a.pow<2>();
+    auto a23 = pow<2, 3>(a);
+    auto as = sqrt(a);
+    auto ac = a.cbrt();
+    BOOST_CHECK((physics::unit_string(a2[0]) == " mm^2"));
+    BOOST_CHECK((physics::unit_string(a23[0]) == " mm^(2/3)"));
+    bool ok{true};
+    for (std::size_t i = 0; i < n; ++i) {
+      ok &= (a2[i] == a[i].pow<2>() && a23[i] == pow<2, 3>(a[i]));
+      ok &= (as[i] == sqrt(a[i]) && ac[i] == cbrt(a[i]));
+    }
+    BOOST_CHECK(ok);
+  }
+  // dimensionless arrays keep the raw-value semantics of quantity
+  {
+    auto r = c / a;
+    auto r2 = r * r;
+    bool ok{true};
+    for (std::size_t i = 0; i < n; ++i) {
+      ok &= (r2[i].raw_value() == (c[i] / a[i] * (c[i] / a[i])).raw_value());
+    }
+    BOOST_CHECK(ok);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_quantity_expression) {
+  using MeV_array = physics::quantity_array<su::energy::MeV::unit>;
+  using mm_array = physics::quantity_array<su::distance::mm::unit>;
+  namespace constants = su::constants;
+
+  constexpr std::size_t n{517};
+  mm_array a(n);
+  std::vector<su::distance::cm> b(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    a[i] = su::distance::mm{1. + i};
+    b[i] = su::distance::cm{0.1 * i};
+  }
+  // expressions are lazy, but can be evaluated element by element
+  {
+    auto e = a * a + a * physics::make_span(b) * 2.;
+    BOOST_CHECK((e.size() == n));
+    BOOST_CHECK((physics::unit_string(e[0]) == " mm^2"));
+    BOOST_CHECK((fabs((e[10] - (a[10] * a[10] + a[10] * b[10] * 2.)).value()) <
+                 1.e-10));
+    // assign to array in a compatible unit
+    physics::quantity_array<su::cross_section::barn::unit> ea = e;
+    mm_array ref(n);
+    bool ok{true};
+    for (std::size_t i = 0; i < n; ++i) {
+      su::cross_section::barn val{a[i] * a[i] + a[i] * b[i] * 2.};
+      ok &= (fabs(ea[i].value() - val.value()) < 1.e-10 * val.value());
+    }
+    BOOST_CHECK(ok);
+  }
+  // expressions can reference the array they are assigned to
+  {
+    mm_array x{a};
+    x = x * 2. + x;
+    x += a;
+    bool ok{true};
+    for (std::size_t i = 0; i < n; ++i) {
+      ok &= (x[i] == a[i] * 4.);
+    }
+    BOOST_CHECK(ok);
+    // eval() materializes an expression
+    auto y = physics::eval(-x / 4.);
+    bool ok2{true};
+    for (std::size_t i = 0; i < n; ++i) {
+      ok2 &= (y[i] == -a[i]);
+    }
+    BOOST_CHECK(ok2);
+  }
+  // dimensionless expressions can be mixed with doubles
+  {
+    auto r = physics::eval(a / physics::make_span(b));
+    auto r2 = physics::eval(1. - r * r + 0.5);
+    bool ok{true};
+    for (std::size_t i = 1; i < n; ++i) {
+      double ref = 1. - (a[i] / b[i]) * (a[i] / b[i]) + 0.5;
+      ok &= (fabs(r2[i] - ref) < 1.e-10 * fabs(ref));
+    }
+    BOOST_CHECK(ok);
+  }
+  // relativistic energy, with all unit conversions in a single loop
+  {
+    using momentum_unit = decltype(su::energy::MeV{} / constants::c)::unit;
+    using mass_unit = decltype(su::energy::MeV{} / constants::c2)::unit;
+    physics::quantity_array<momentum_unit> p(n);
+    physics::quantity_array<mass_unit> m(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      p[i] = physics::quantity<momentum_unit>{1. * i};
+      m[i] = physics::quantity<mass_unit>{0.5 + i};
+    }
+    const auto c2 = constants::c2;
+    MeV_array E = sqrt(p * p * c2 + m * m * c2 * c2);
+    bool ok{true};
+    for (std::size_t i = 0; i < n; ++i) {
+      su::energy::MeV ref{sqrt(p[i] * p[i] * c2 + m[i] * m[i] * c2 * c2)};
+      ok &= (fabs((E[i] - ref).value()) < 1.e-10 * ref.value());
+    }
+    BOOST_CHECK(ok);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_convert) {
+  using GeV_per_cm = decltype(su::energy::GeV{} / su::distance::cm{});
+  using MeV_per_mm = decltype(su::energy::MeV{} / su::distance::mm{});
+
+  constexpr std::size_t n{257};
+  std::vector<GeV_per_cm> in(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    in[i] = GeV_per_cm{0.25 * i};
+  }
+  // into a new array (ToUnit can be a quantity or a unit)
+  auto out = physics::convert<MeV_per_mm>(in);
+  auto out2 = physics::convert<MeV_per_mm::unit>(physics::make_span(in));
+  static_assert(std::is_same<decltype(out),
+                             physics::quantity_array<MeV_per_mm::unit>>::value,
+                "convert<ToUnit>() has to return a quantity_array<ToUnit>");
+  BOOST_CHECK((out.size() == n && out2.size() == n));
+  bool ok{true};
+  for (std::size_t i = 0; i < n; ++i) {
+    ok &= (fabs(out[i].value() - 25. * i) <= 1.e-12 * 25. * i);
+    ok &= (out[i] == out2[i]);
+  }
+  BOOST_CHECK(ok);
+  // into an existing range, including in-place
+  std::vector<su::distance::m> vm{su::distance::m{1}, su::distance::m{2.5}};
+  physics::quantity_array<su::distance::mm::unit> mm(2);
+  physics::convert(physics::make_span(vm), physics::make_span(mm));
+  BOOST_CHECK((mm[0].value() == 1000. && mm[1].value() == 2500.));
+  physics::convert(physics::make_span(mm), physics::make_span(mm));
+  BOOST_CHECK((mm[1].value() == 2500.));
+  // into single precision storage (and back, through an expression)
+  std::vector<physics::quantity<su::distance::cm::unit, float>> cmf(2);
+  physics::convert(physics::make_span(mm), physics::make_span(cmf));
+  BOOST_CHECK((cmf[0].value() == 100.f && cmf[1].value() == 250.f));
+  physics::quantity_array<su::distance::mm::unit> mm2 =
+      physics::make_span(cmf) * 2.;
+  BOOST_CHECK((mm2[1].value() == 5000.));
+  // from raw fixed-point counts
+  using tdc_time = physics::fixed_quantity<su::time::ns, std::ratio<25, 1024>>;
+  std::vector<tdc_time> tdc{tdc_time{0}, tdc_time{512}, tdc_time{4096}};
+  auto ns = physics::convert<su::time::ns>(tdc);
+  BOOST_CHECK((ns[1].value() == 12.5 && ns[2].value() == 100.));
+  physics::quantity_array<su::distance::mm::unit> mm3(3);
+  BOOST_CHECK_THROW(
+      physics::convert(physics::make_span(vm), physics::make_span(mm3)),
+      physics::expression_error);
+}
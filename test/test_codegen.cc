@@ -0,0 +1,139 @@
+// Codegen regression test: verify that the quantity kernels in
+// codegen_kernels.cc compile to the same machine code as their raw double
+// counterparts.
+//
+// usage: test_codegen -- <objdump> <codegen_kernels.o>
+//
+// The object file is disassembled with objdump, and for every pair of kernels
+// kernel_<name>_double and kernel_<name>_quantity we check that the quantity
+// version has no more instructions, no more memory operands (loads or stores),
+// and no additional calls (e.g. to pow or cbrt) than the double version.
+
+#include <iostream>
+
+#define BOOST_TEST_MODULE test_codegen
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <regex>
+#include <set>
+#include <string>
+
+namespace {
+struct function_info {
+  unsigned n_instructions{0};
+  unsigned n_memory{0};
+  std::set<std::string> calls;
+};
+using function_map = std::map<std::string, function_info>;
+
+// padding between functions is not part of the function body
+bool is_padding(const std::string& instruction) {
+  return instruction.compare(0, 3, "nop") == 0 ||
+         instruction.compare(0, 6, "data16") == 0 ||
+         instruction.compare(0, 6, "cs nop") == 0 ||
+         instruction == "xchg   %ax,%ax";
+}
+// any explicit memory operand except for address calculations
+bool is_memory(const std::string& instruction) {
+  return instruction.find('(') != std::string::npos &&
+         instruction.compare(0, 3, "lea") != 0;
+}
+
+// disassemble an object file and collect the kernel statistics
+function_map disassemble(const std::string& objdump, const std::string& obj) {
+  const std::string cmd{objdump + " -dr --no-show-raw-insn -C '" + obj + "'"};
+  std::unique_ptr<FILE, int (*)(FILE*)> pipe{popen(cmd.c_str(), "r"), pclose};
+  BOOST_REQUIRE_MESSAGE(pipe, "Failed to run " << cmd);
+  const std::regex header{"^[0-9a-f]+ <(?:[^<>]* )?(kernel_\\w+)\\(.*>:$"};
+  const std::regex symbol{"^[0-9a-f]+ <.*>:$"};
+  const std::regex instruction{"^ *[0-9a-f]+:\\t(.*)$"};
+  const std::regex call{"R_X86_64_(?:PLT32|PC32|GOTPCREL\\w*)\\t([^-+]+)"};
+  function_map functions;
+  function_info* current{nullptr};
+  std::string pending_jump;
+  char buffer[4096];
+  std::smatch m;
+  while (std::fgets(buffer, sizeof(buffer), pipe.get())) {
+    std::string line{buffer};
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+      line.pop_back();
+    }
+    if (std::regex_match(line, m, header)) {
+      current = &functions[m[1]];
+    } else if (std::regex_match(line, symbol)) {
+      current = nullptr;
+    } else if (current && std::regex_match(line, m, instruction)) {
+      const std::string ins{m[1]};
+      pending_jump = (ins.compare(0, 4, "call") == 0 ||
+                      ins.compare(0, 3, "jmp") == 0)
+                         ? ins
+                         : "";
+      if (!is_padding(ins)) {
+        current->n_instructions += 1;
+        current->n_memory += is_memory(ins);
+      }
+    } else if (current && !pending_jump.empty() &&
+               std::regex_search(line, m, call)) {
+      // relocation of a call or tail call: an external function
+      current->calls.insert(m[1]);
+    }
+  }
+  return functions;
+}
+
+// command line: everything after "--"
+struct fixture {
+  fixture() {
+    const auto& suite = boost::unit_test::framework::master_test_suite();
+    if (suite.argc < 3) {
+      std::cerr << "usage: test_codegen -- <objdump> <codegen_kernels.o>"
+                << std::endl;
+      return;
+    }
+    functions = disassemble(suite.argv[suite.argc - 2],
+                            suite.argv[suite.argc - 1]);
+  }
+  function_map functions;
+};
+} // namespace
+
+BOOST_FIXTURE_TEST_CASE(test_kernels, fixture) {
+  BOOST_REQUIRE_MESSAGE(!functions.empty(), "No kernels found");
+  unsigned n_pairs{0};
+  for (const auto& f : functions) {
+    const std::string& name{f.first};
+    const std::string suffix{"_double"};
+    if (name.size() < suffix.size() ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix)) {
+      continue;
+    }
+    const std::string base{name.substr(0, name.size() - suffix.size())};
+    const auto q = functions.find(base + "_quantity");
+    BOOST_CHECK_MESSAGE(q != functions.end(),
+                        "Missing quantity kernel for " << name);
+    if (q == functions.end()) {
+      continue;
+    }
+    ++n_pairs;
+    const function_info& fd{f.second};
+    const function_info& fq{q->second};
+    BOOST_CHECK_MESSAGE(fq.n_instructions <= fd.n_instructions,
+                        base << ": " << fq.n_instructions
+                             << " instructions for quantity vs. "
+                             << fd.n_instructions << " for double");
+    BOOST_CHECK_MESSAGE(fq.n_memory <= fd.n_memory,
+                        base << ": " << fq.n_memory
+                             << " loads/stores for quantity vs. "
+                             << fd.n_memory << " for double");
+    for (const auto& c : fq.calls) {
+      BOOST_CHECK_MESSAGE(fd.calls.count(c),
+                          base << ": additional call to " << c
+                               << " in the quantity kernel");
+    }
+  }
+  BOOST_CHECK(n_pairs > 0);
+  BOOST_TEST_MESSAGE("Compared " << n_pairs << " kernel pairs");
+}
@@ -0,0 +1,529 @@
+#include <atomic>
+#include <chrono>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE test_configuration
+#include <boost/test/unit_test.hpp>
+
+#include "physics/unit.hh"
+#include "physics/unit/standard.hh"
+#include "physics/util/configuration.hh"
+#ifdef __linux__
+#include "physics/util/configuration_watcher.hh"
+#endif
+
+namespace {
+physics::ptree make_settings() {
+  std::istringstream json{R"({
+    "board": {
+      "module": "adc",
+      "threshold": "12.5",
+      "channels": "8",
+      "enabled": "true",
+      "mode": "fast",
+      "bad": "abc",
+      "list": ["1", "2", "x", "3"],
+      "nested": {"gain": "2"}
+    },
+    "defaults": {
+      "adc": {
+        "threshold": "1",
+        "pedestal": "100",
+        "bad": "7",
+        "nested": {"gain": "1", "offset": "3"}
+      }
+    }
+  })"};
+  physics::ptree settings;
+  physics::read_json(json, settings);
+  return settings;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(configuration_snapshot) {
+  physics::configuration conf{"board", make_settings()};
+  const auto snapshot = conf.freeze();
+  BOOST_CHECK((snapshot->module() == "adc"));
+  BOOST_CHECK((snapshot->contains("nested.offset") &&
+               !snapshot->contains("nested.missing")));
+  // the same values as the configuration, with the fallback to the defaults
+  // (also for values in the settings that do not convert)
+  for (const std::string key : {"threshold", "channels", "pedestal",
+                                "nested.gain", "nested.offset", "bad"}) {
+    BOOST_CHECK((snapshot->get<double>(key) == conf.get<double>(key)));
+    BOOST_CHECK((snapshot->get<std::string>(key) ==
+                 conf.get<std::string>(key)));
+    BOOST_CHECK((snapshot->get_optional<int>(key) ==
+                 conf.get_optional<int>(key)));
+    BOOST_CHECK((snapshot->get_optional<short>(key) ==
+                 conf.get_optional<short>(key)));
+  }
+  BOOST_CHECK((snapshot->get<int>("bad") == 7));
+  BOOST_CHECK((snapshot->get<bool>("enabled")));
+  BOOST_CHECK((snapshot->get_vector<int>("list") ==
+               std::vector<int>{1, 2, 3}));
+  BOOST_CHECK((snapshot->get<int>("missing", 5) == 5));
+  BOOST_CHECK_THROW(snapshot->get<int>("missing"),
+                    physics::configuration_key_error);
+  BOOST_CHECK_THROW(snapshot->get<int>("mode"),
+                    physics::configuration_key_error);
+  const physics::translation_map<int> modes{{"fast", 1}, {"slow", 2}};
+  BOOST_CHECK((snapshot->get("mode", modes) == 1));
+  BOOST_CHECK_THROW(snapshot->get("nested.gain", modes),
+                    physics::configuration_translation_error);
+
+  // handles: frozen types, other types (shared by key), translated values
+  // and vectors
+  const auto gain = snapshot->handle<double>("nested.gain");
+  const auto channels = snapshot->handle<short>("channels");
+  const auto mode = snapshot->handle("mode", modes);
+  const auto list = snapshot->vector_handle<int>("list");
+  BOOST_CHECK((*gain == 2. && *channels == 8 && *mode == 1 &&
+               list->size() == 3));
+  BOOST_CHECK((&snapshot->handle<short>("channels").get() == &*channels));
+  BOOST_CHECK_THROW(snapshot->handle<double>("missing"),
+                    physics::configuration_key_error);
+
+  // the snapshot does not change with the configuration
+  conf.get<int>("new_key", 3);
+  BOOST_CHECK((!snapshot->contains("new_key") &&
+               conf.freeze()->get<int>("new_key") == 3));
+}
+
+BOOST_AUTO_TEST_CASE(configuration_quantities) {
+  namespace su = physics::standard_units;
+  std::istringstream json{R"({
+    "cuts": {
+      "module": "cuts",
+      "energy": "5 GeV",
+      "length": " 2.5mm ",
+      "angle": "30 deg",
+      "bare": "7",
+      "bad_int": "1e10 MeV",
+      "text": "abc",
+      "unknown": "5 GeVs",
+      "wrong": "5 mm",
+      "window": ["1 GeV", "200 GeV"],
+      "bad_window": ["1 GeV", "2 ns"]
+    },
+    "defaults": {"cuts": {"text": "3 ns"}}
+  })"};
+  physics::ptree settings;
+  physics::read_json(json, settings);
+  physics::configuration conf{"cuts", settings};
+
+  // converted to the requested unit, a bare number is in this unit
+  BOOST_CHECK((conf.get<su::energy::MeV>("energy").value() == 5000.));
+  BOOST_CHECK((conf.get<su::energy::GeV>("energy").value() == 5.));
+  BOOST_CHECK_CLOSE(conf.get<su::distance::m>("length").value(), 2.5e-3,
+                    1e-12);
+  BOOST_CHECK_CLOSE(conf.get<su::angle::rad>("angle").value(), M_PI / 6,
+                    1e-12);
+  BOOST_CHECK((conf.get<su::energy::keV>("bare").value() == 7.));
+  // text that is not a number falls back to the defaults
+  BOOST_CHECK((conf.get<su::time::ns>("text").value() == 3.));
+  BOOST_CHECK((!conf.get_optional<su::energy::MeV>("missing")));
+  BOOST_CHECK_THROW(conf.get<su::energy::MeV>("unknown"),
+                    physics::configuration_translation_error);
+  BOOST_CHECK_THROW(conf.get<su::energy::MeV>("wrong"),
+                    physics::configuration_translation_error);
+  // vectors and ranges
+  const auto window = conf.get_range<su::energy::MeV>("window");
+  BOOST_CHECK((window.first.value() == 1e3 && window.second.value() == 2e5));
+  BOOST_CHECK((conf.get_vector<su::energy::GeV>("window").size() == 2));
+  BOOST_CHECK_THROW(conf.get_vector<su::energy::GeV>("bad_window"),
+                    physics::configuration_translation_error);
+  // default values are stored with their unit name
+  BOOST_CHECK((conf.get("new_cut", su::energy::GeV{1.5}).value() == 1.5));
+  BOOST_CHECK((conf.get<std::string>("new_cut") == "1.5 GeV"));
+  BOOST_CHECK((conf.get<su::energy::MeV>("new_cut").value() == 1500.));
+
+  // handles hold the converted value
+  const auto snapshot = conf.freeze();
+  const auto energy = snapshot->handle<su::energy::MeV>("energy");
+  BOOST_CHECK((energy->value() == 5000.));
+  BOOST_CHECK((snapshot->get_vector<su::energy::GeV>("window").size() == 2));
+  BOOST_CHECK_THROW(snapshot->get<su::energy::MeV>("wrong"),
+                    physics::configuration_translation_error);
+  BOOST_CHECK_THROW(snapshot->handle<su::energy::MeV>("unknown"),
+                    physics::configuration_translation_error);
+
+  // parse_quantity directly
+  su::distance::mm d;
+  BOOST_CHECK((!physics::parse_quantity("mm", d)));
+  BOOST_CHECK((physics::parse_quantity("-3e2 um", d) && d.value() == -0.3));
+  // numbers are read strictly, independent of the locale
+  BOOST_CHECK((physics::parse_quantity("2.5mm", d) && d.value() == 2.5));
+  BOOST_CHECK((physics::parse_quantity(" +4", d) && d.value() == 4));
+  BOOST_CHECK((!physics::parse_quantity("inf mm", d)));
+  BOOST_CHECK((!physics::parse_quantity("nan", d)));
+  BOOST_CHECK((!physics::parse_quantity(".", d)));
+  BOOST_CHECK_THROW(physics::parse_quantity("0x10 mm", d),
+                    physics::unit_name_error);
+  BOOST_CHECK_THROW(physics::parse_quantity("1e999 mm", d),
+                    physics::unit_name_error);
+  su::energy::MeV e_double;
+  BOOST_CHECK((physics::parse_quantity("5eV", e_double) &&
+               std::abs(e_double.value() - 5e-6) < 1e-18));
+  BOOST_CHECK((physics::parse_quantity("2 J", e_double) &&
+               e_double.value() > 1e13));
+  const char* const previous{std::setlocale(LC_NUMERIC, nullptr)};
+  const std::string restore{previous ? previous : "C"};
+  if (std::setlocale(LC_NUMERIC, "de_DE.UTF-8")) {
+    BOOST_CHECK((physics::parse_quantity("1.5 mm", d) && d.value() == 1.5));
+    std::setlocale(LC_NUMERIC, restore.c_str());
+  }
+  // integral representations round to the nearest value, and are range
+  // checked
+  using MeV_int = physics::quantity<su::energy::MeV::unit, int>;
+  MeV_int e;
+  BOOST_CHECK((physics::parse_quantity("1.001 GeV", e) && e.value() == 1001));
+  BOOST_CHECK((physics::parse_quantity("-0.0016 GeV", e) && e.value() == -2));
+  BOOST_CHECK((physics::parse_quantity("7.6", e) && e.value() == 8));
+  BOOST_CHECK_THROW(physics::parse_quantity("3e6 GeV", e),
+                    physics::unit_name_error);
+  BOOST_CHECK((conf.get<MeV_int>("energy").value() == 5000));
+  BOOST_CHECK_THROW(conf.get<MeV_int>("bad_int"),
+                    physics::configuration_translation_error);
+  try {
+    physics::parse_quantity("5 GeV", d);
+    BOOST_ERROR("no unit_name_error");
+  } catch (const physics::unit_name_error& e) {
+    BOOST_CHECK((std::string{e.type()} == "unit_dimension_error"));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(configuration_holder) {
+  const auto settings = [](int version) {
+    std::istringstream json{R"({"daq": {"module": "daq", "first": ")" +
+                            std::to_string(version) + R"(", "second": ")" +
+                            std::to_string(version) + R"("}})"};
+    return json.str();
+  };
+  std::istringstream initial{settings(0)};
+  physics::ptree tree;
+  physics::read_json(initial, tree);
+  physics::configuration_holder holder{"daq", tree};
+  BOOST_CHECK((holder.version() == 1 &&
+               holder.snapshot()->get<int>("first") == 0));
+
+  // readers always see both values of the same reload
+  constexpr int n_reloads{200};
+  std::atomic<bool> done{false};
+  std::atomic<int> n_inconsistent{0};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 3; ++t) {
+    workers.emplace_back([&] {
+      physics::configuration_holder::reader reader{holder};
+      int last{0};
+      while (!done.load()) {
+        const auto& snapshot = reader.get();
+        const int first{snapshot.get<int>("first")};
+        if (first != snapshot.get<int>("second") || first < last) {
+          ++n_inconsistent;
+        }
+        last = first;
+      }
+    });
+  }
+  for (int version = 1; version <= n_reloads; ++version) {
+    std::istringstream json{settings(version)};
+    holder.reload(json);
+  }
+  done.store(true);
+  for (auto& w : workers) {
+    w.join();
+  }
+  BOOST_CHECK((n_inconsistent.load() == 0));
+  BOOST_CHECK((holder.version() == n_reloads + 1));
+
+  // a reader keeps its snapshot until its next get()
+  physics::configuration_holder::reader reader{holder};
+  const auto& old_snapshot = reader.get();
+  const auto old_version = reader.version();
+  std::istringstream next{settings(n_reloads + 1)};
+  holder.reload(next);
+  BOOST_CHECK((holder.reclaim() == 2));
+  BOOST_CHECK((old_snapshot.get<int>("first") == n_reloads));
+  BOOST_CHECK((reader.get().get<int>("first") == n_reloads + 1 &&
+               reader.version() == old_version + 1));
+  BOOST_CHECK((holder.reclaim() == 1));
+
+  // a failed reload keeps the current snapshot
+  std::istringstream invalid{"{"};
+  BOOST_CHECK_THROW(holder.reload(invalid), physics::configuration_error);
+  BOOST_CHECK_THROW(holder.reload(physics::ptree{}),
+                    physics::configuration_path_error);
+  BOOST_CHECK((reader.get().get<int>("first") == n_reloads + 1));
+}
+
+BOOST_AUTO_TEST_CASE(json_reader) {
+  // SAX events
+  struct recorder : physics::json_handler {
+    std::string events;
+    void begin_object() override { events += "{"; }
+    void end_object() override { events += "}"; }
+    void begin_array() override { events += "["; }
+    void end_array() override { events += "]"; }
+    void key(boost::string_view key) override {
+      events += key.to_string() + ":";
+    }
+    void string(boost::string_view value) override {
+      events += "'" + value.to_string() + "'";
+    }
+    void number(boost::string_view text, double value) override {
+      events += text.to_string() + "=" + physics::json_number_text(value);
+    }
+    void literal(boost::string_view text) override {
+      events += text.to_string();
+    }
+  } r;
+  std::istringstream json{R"( {"a": [1, -2.50, 3e2], "b\n\u00e9\ud83d\ude00":
+                                 {"c": true, "d": null, "e": "x\"y"}} )"};
+  physics::parse_json(json, r);
+  BOOST_CHECK((r.events == "{a:[1=1-2.50=-2.53e2=300]b\n\xc3\xa9\xf0\x9f\x98\x80:"
+                           "{c:trued:nulle:'x\"y'}}"));
+  for (const std::string invalid :
+       {"", "{", "[1,]", "{\"a\" 1}", "\"\\x\"", "tru", "1 2", "[1e]",
+        "{\"a\": \"\n\"}", "01x", "01", "1.", "-01", ".5", "-", "1e+",
+        "1.e3", "+1", "--1", "1e2.5"}) {
+    std::istringstream in{invalid};
+    BOOST_CHECK_THROW(physics::parse_json(in, r), physics::json_error);
+  }
+  for (const std::string valid : {"0", "-0.0e-0", "10E+2", "0.5e3"}) {
+    std::istringstream in{valid};
+    BOOST_CHECK_NO_THROW(physics::parse_json(in, r));
+  }
+
+  // flat document: arrays of numbers are doubles, mixed arrays text, the
+  // contents of nested containers are skipped, long values cross the read
+  // blocks of the reader
+  const std::string long_text(100000, 'x');
+  std::string numbers;
+  for (int i = 0; i < 20000; ++i) {
+    numbers += (i ? ", " : "") + std::to_string(i) + ".5";
+  }
+  std::istringstream doc_json{R"({"a": {"b": "1", "c": [)" + numbers +
+                              R"(]}, "mixed": [1, "x", 0.1, {"y": 1}],
+                              "long": ")" + long_text + R"(", "a": "2"})"};
+  const physics::json_document doc{doc_json};
+  BOOST_CHECK((doc.find("a.b")->text == "1" && !doc.find("a.x")));
+  const auto c = doc.numbers(*doc.find("a.c"));
+  BOOST_CHECK((c.size() == 20000 && c[0] == 0.5 && c[19999] == 19999.5));
+  const auto mixed = doc.elements(*doc.find("mixed"));
+  BOOST_CHECK((mixed.size() == 4 && mixed[0] == "1" && mixed[1] == "x" &&
+               mixed[2] == "0.1" && mixed[3].empty()));
+  BOOST_CHECK((!doc.find("mixed.y")));
+  BOOST_CHECK((doc.find("long")->text == long_text));
+  // (a repeated key is found in its first node)
+  BOOST_CHECK((doc.find("a")->text.empty() && doc.size() == 6));
+
+  // snapshots from a document and from the configuration agree
+  std::ostringstream settings_json;
+  physics::write_json(settings_json, make_settings());
+  std::istringstream document_json{settings_json.str()};
+  const physics::configuration_snapshot from_document{
+      physics::json_document{document_json}, "board"};
+  const auto from_ptree = physics::configuration{"board", make_settings()}
+                              .freeze();
+  BOOST_CHECK((from_document.size() == from_ptree->size() &&
+               from_document.module() == "adc"));
+  for (const std::string key : {"threshold", "channels", "pedestal",
+                                "nested.gain", "nested.offset", "bad", "mode",
+                                "enabled", "nested"}) {
+    BOOST_CHECK((from_document.get<std::string>(key) ==
+                 from_ptree->get<std::string>(key)));
+    BOOST_CHECK((from_document.get_optional<int>(key) ==
+                 from_ptree->get_optional<int>(key)));
+  }
+  BOOST_CHECK((from_document.get_vector<int>("list") ==
+               from_ptree->get_vector<int>("list")));
+  BOOST_CHECK_THROW(from_document.get_numbers("list"),
+                    physics::configuration_translation_error);
+  std::istringstream missing_json{settings_json.str()};
+  BOOST_CHECK_THROW(physics::configuration_snapshot(
+                        physics::json_document{missing_json}, "missing"),
+                    physics::configuration_path_error);
+
+  std::istringstream calibration{R"({"calib": {"module": "calib",
+                                     "gains": [1, 2.5, 4]}})"};
+  const physics::configuration_snapshot calib{
+      physics::json_document{calibration}, "calib"};
+  const auto gains = calib.get_numbers("gains");
+  BOOST_CHECK((gains.size() == 3 && gains[1] == 2.5));
+  BOOST_CHECK((calib.get_vector<double>("gains") ==
+               std::vector<double>{1, 2.5, 4}));
+  BOOST_CHECK((calib.get_vector<int>("gains") == std::vector<int>{1, 4}));
+
+  // arrays of numbers keep their values when the double does not read back
+  // as their text (64-bit integers, 1.10)
+  const std::string exact_json{R"({"daq": {"module": "daq",
+      "masks": [9007199254740993, 18446744073709551615, 1],
+      "large": [9007199254740992, 18014398509481984],
+      "exact": [9007199254740992, 0.5, 1e+300], "empty": [],
+      "levels": [1.10, 2.5, 1e3], "mixed": [0.1, "x", 12345678901234567],
+      "small": [1e-3, 2.50]}})"};
+  std::istringstream exact_document_json{exact_json};
+  const physics::configuration_snapshot exact_document{
+      physics::json_document{exact_document_json}, "daq"};
+  std::istringstream exact_ptree_json{exact_json};
+  physics::ptree exact_settings;
+  physics::read_json(exact_ptree_json, exact_settings);
+  const auto exact_ptree =
+      physics::configuration{"daq", exact_settings}.freeze();
+  for (const std::string key :
+       {"masks", "large", "exact", "levels", "mixed", "small"}) {
+    BOOST_CHECK((exact_document.get_vector<std::string>(key) ==
+                 exact_ptree->get_vector<std::string>(key)));
+  }
+  for (const std::string key : {"masks", "large"}) {
+    BOOST_CHECK((exact_document.get_vector<unsigned long long>(key) ==
+                 exact_ptree->get_vector<unsigned long long>(key)));
+  }
+  BOOST_CHECK((exact_document.get_vector<unsigned long long>("masks") ==
+               std::vector<unsigned long long>{9007199254740993ull,
+                                               18446744073709551615ull, 1}));
+  BOOST_CHECK((exact_document.get_vector<double>("levels") ==
+               exact_ptree->get_vector<double>("levels")));
+  BOOST_CHECK((exact_document.get_vector<std::string>("levels")[0] == "1.10"));
+  // an empty array has no numbers for both snapshots
+  BOOST_CHECK_THROW(exact_document.get_numbers("empty"),
+                    physics::configuration_translation_error);
+  BOOST_CHECK_THROW(exact_ptree->get_numbers("empty"),
+                    physics::configuration_translation_error);
+  BOOST_CHECK((exact_document.get_vector<double>("empty").empty() &&
+               exact_ptree->get_vector<double>("empty").empty()));
+  // the numbers of all arrays of numbers are the same for both snapshots
+  for (const std::string key :
+       {"masks", "large", "exact", "levels", "small"}) {
+    const auto document_numbers = exact_document.get_numbers(key);
+    const auto ptree_numbers = exact_ptree->get_numbers(key);
+    BOOST_CHECK((std::vector<double>(document_numbers.begin(),
+                                     document_numbers.end()) ==
+                 std::vector<double>(ptree_numbers.begin(),
+                                     ptree_numbers.end())));
+  }
+  const auto exact = exact_document.get_numbers("exact");
+  BOOST_CHECK((exact.size() == 3 && exact[0] == 9007199254740992. &&
+               exact[2] == 1e300));
+  const auto levels = exact_document.get_numbers("levels");
+  BOOST_CHECK((levels.size() == 3 && levels[0] == 1.1 && levels[2] == 1e3));
+  // strings that strtod reads as numbers are not numbers for both snapshots
+  const std::string strict_json{R"({"daq": {"module": "daq",
+      "nan": ["nan", "1"], "space": [" 3"], "hex": ["0x10"], "inf": ["inf"],
+      "numbers": [1, -2.5e3, 0]}})"};
+  std::istringstream strict_document_json{strict_json};
+  const physics::configuration_snapshot strict_document{
+      physics::json_document{strict_document_json}, "daq"};
+  std::istringstream strict_ptree_json{strict_json};
+  physics::ptree strict_settings;
+  physics::read_json(strict_ptree_json, strict_settings);
+  const auto strict_ptree =
+      physics::configuration{"daq", strict_settings}.freeze();
+  for (const std::string key : {"nan", "space", "hex", "inf"}) {
+    BOOST_CHECK_THROW(strict_document.get_numbers(key),
+                      physics::configuration_translation_error);
+    BOOST_CHECK_THROW(strict_ptree->get_numbers(key),
+                      physics::configuration_translation_error);
+  }
+  for (const auto& strict : {&strict_document, strict_ptree.get()}) {
+    const auto numbers = strict->get_numbers("numbers");
+    BOOST_CHECK((std::vector<double>(numbers.begin(), numbers.end()) ==
+                 std::vector<double>{1, -2500, 0}));
+  }
+  // (the error shows the elements of an array that is not all numbers)
+  try {
+    exact_document.get_numbers("mixed");
+    BOOST_ERROR("get_numbers of a mixed array did not throw");
+  } catch (physics::configuration_translation_error& e) {
+    BOOST_CHECK((std::string{e.what()}.find("[0.1, x, 12345678901234567]") !=
+                 std::string::npos));
+  }
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(configuration_watcher) {
+  std::istringstream before_json{R"({"a": {"b": "1", "c": ["1", "2"]},
+                                     "d": "x", "e": "y"})"};
+  std::istringstream after_json{R"({"a": {"b": "1", "c": ["1", "3"]},
+                                    "d": "z", "f": {"g": "1"}})"};
+  physics::ptree before, after;
+  physics::read_json(before_json, before);
+  physics::read_json(after_json, after);
+  BOOST_CHECK((physics::configuration_diff(before, after) ==
+               std::vector<std::string>{"a.c", "d", "e", "f"}));
+  BOOST_CHECK((physics::configuration_diff(after, after).empty()));
+
+  char dir[]{"/tmp/test_configuration_XXXXXX"};
+  BOOST_REQUIRE((mkdtemp(dir) != nullptr));
+  const std::string path{std::string{dir} + "/settings.json"};
+  const auto write = [&](const std::string& threshold, const std::string& cut,
+                         const std::string& gain) {
+    // (written next to the file and renamed, as editors do)
+    {
+      std::ofstream file{path + ".new"};
+      file << R"({"daq": {"module": "daq", "trigger": {"threshold": ")"
+           << threshold << R"(", "window": "10"}, "tracking": {"cut": ")"
+           << cut << R"("}}, "defaults": {"daq": {"gain": ")" << gain
+           << R"("}}})";
+    }
+    std::rename((path + ".new").c_str(), path.c_str());
+  };
+  write("5", "1", "2");
+  physics::configuration_watcher watcher{path, "daq"};
+  std::vector<std::vector<std::string>> trigger, tracking, all;
+  watcher.subscribe("trigger", [&](const physics::configuration_snapshot& s,
+                                   const std::vector<std::string>& keys) {
+    BOOST_CHECK((s.get<int>("trigger.threshold") == 6));
+    trigger.push_back(keys);
+  });
+  watcher.subscribe("tracking.cut",
+                    [&](const physics::configuration_snapshot&,
+                        const std::vector<std::string>& keys) {
+                      tracking.push_back(keys);
+                    });
+  watcher.subscribe("", [&](const physics::configuration_snapshot&,
+                            const std::vector<std::string>& keys) {
+    all.push_back(keys);
+  });
+  BOOST_CHECK((!watcher.poll()));
+
+  // only the subscriptions of the changed keys are called
+  const std::chrono::milliseconds timeout{2000};
+  write("6", "1", "2");
+  BOOST_CHECK((watcher.poll(timeout)));
+  BOOST_CHECK((trigger.size() == 1 && tracking.empty() && all.size() == 1));
+  BOOST_CHECK((trigger[0] == std::vector<std::string>{"trigger.threshold"}));
+  BOOST_CHECK((watcher.holder().snapshot()->get<int>("trigger.threshold") ==
+               6));
+  const auto version = watcher.holder().version();
+  // no changes, and invalid files, are not published
+  write("6", "1", "2");
+  BOOST_CHECK((!watcher.poll(timeout)));
+  {
+    std::ofstream file{path};
+    file << "{";
+  }
+  BOOST_CHECK((!watcher.poll(timeout)));
+  BOOST_CHECK((watcher.holder().version() == version));
+  // defaults
+  write("6", "1", "3");
+  BOOST_CHECK((watcher.poll(timeout)));
+  BOOST_CHECK((all.size() == 2 &&
+               all[1] == std::vector<std::string>{"gain"} &&
+               trigger.size() == 1 && tracking.empty()));
+  BOOST_CHECK((watcher.holder().snapshot()->get<int>("gain") == 3));
+
+  std::remove(path.c_str());
+  std::remove(dir);
+}
+#endif
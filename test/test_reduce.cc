@@ -0,0 +1,116 @@
+#include <iostream>
+#include <vector>
+
+#define BOOST_TEST_MODULE test_reduce
+#include <boost/test/unit_test.hpp>
+
+#include "physics/unit.hh"
+#include "physics/unit/array.hh"
+#include "physics/unit/reduce.hh"
+#include "physics/unit/standard.hh"
+#include "physics/util/thread_pool.hh"
+
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+
+using std::fabs;
+
+namespace su = physics::standard_units;
+
+BOOST_AUTO_TEST_CASE(test_thread_pool) {
+  physics::thread_pool pool{3};
+  BOOST_CHECK((pool.size() == 3));
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; ++i) {
+    results.push_back(pool.submit([i] { return i * i; }));
+  }
+  int total{0};
+  for (auto& r : results) {
+    total += r.get();
+  }
+  BOOST_CHECK((total == 328350));
+  // exceptions are forwarded through the future
+  auto f = pool.submit([]() -> int { throw std::runtime_error{"oops"}; });
+  BOOST_CHECK_THROW(f.get(), std::runtime_error);
+  // without worker threads, the task runs in the calling thread
+  physics::thread_pool serial{0};
+  BOOST_CHECK((serial.submit([] { return 42; }).get() == 42));
+}
+
+BOOST_AUTO_TEST_CASE(test_reduce) {
+  // 10^5 elements, enough to be split in several chunks
+  const std::size_t n{100000};
+  physics::quantity_array<su::distance::cm::unit> x(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    x[i] = su::distance::cm{(i % 100) * 0.5 - 10.};
+  }
+  physics::thread_pool pool{4};
+  // sum and mean, in the unit of the range
+  const auto s1 = physics::sum(x);
+  const auto s2 = physics::sum(x, pool);
+  BOOST_CHECK((std::is_same<decltype(s1), const su::distance::cm>::value));
+  BOOST_CHECK((fabs(s1.value() - 1475000.) < 1e-6));
+  BOOST_CHECK((fabs(s2.value() - 1475000.) < 1e-6));
+  const su::distance::mm m{physics::mean(x.begin(), x.end(), pool)};
+  BOOST_CHECK((fabs(m.value() - 147.5) < 1e-9));
+  // variance in cm^2
+  const auto v1 = physics::variance(x);
+  const auto v2 = physics::variance(x, pool);
+  const decltype(su::distance::cm{} * su::distance::cm{}) v_expected{208.3125};
+  BOOST_CHECK((std::is_same<decltype(v1), decltype(v_expected)>::value));
+  BOOST_CHECK((fabs((v1 - v_expected).value()) < 1e-9));
+  BOOST_CHECK((fabs((v2 - v_expected).value()) < 1e-9));
+  // min, max and minmax
+  BOOST_CHECK((physics::min(x, pool) == su::distance::cm{-10.}));
+  BOOST_CHECK((physics::max(x, pool) == su::distance::cm{39.5}));
+  const auto mm = physics::minmax(physics::make_span(x));
+  BOOST_CHECK((mm.first == su::distance::cm{-10.} &&
+               mm.second == su::distance::cm{39.5}));
+  // empty ranges
+  std::vector<su::distance::cm> empty;
+  BOOST_CHECK((physics::sum(empty).value() == 0.));
+  BOOST_CHECK_THROW(physics::mean(empty), physics::reduce_error);
+  BOOST_CHECK_THROW(physics::min(empty, pool), physics::reduce_error);
+  // integer quantities are summed in std::intmax_t, the mean is a double
+  using tdc_time = physics::fixed_quantity<su::time::ns, std::ratio<1, 4>>;
+  std::vector<tdc_time> t(n, tdc_time{100000});
+  const auto ts = physics::sum(t, pool);
+  BOOST_CHECK((ts.raw_value() == std::intmax_t{10000000000}));
+  BOOST_CHECK((fabs(su::time::ns{physics::mean(t)}.value() - 25000.) < 1e-9));
+}
+
+BOOST_AUTO_TEST_CASE(test_reproducible_sum) {
+  // values spanning many orders of magnitude, so the rounding errors depend
+  // on the order of the additions
+  const std::size_t n{300001};
+  std::vector<su::energy::MeV> e(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    e[i] = su::energy::MeV{std::pow(10., static_cast<double>(i % 13) - 6) *
+                           (1. + 1e-3 * (i % 7))};
+  }
+  const auto reference = physics::reproducible_sum(e);
+  const auto reference_c =
+      physics::reproducible_sum(e, physics::summation::compensated);
+  for (std::size_t n_threads : {1, 2, 3, 5, 8}) {
+    physics::thread_pool pool{n_threads};
+    BOOST_CHECK((physics::reproducible_sum(e, pool).raw_value() ==
+                 reference.raw_value()));
+    BOOST_CHECK((physics::reproducible_sum(e.begin(), e.end(), pool,
+                                           physics::summation::compensated)
+                     .raw_value() == reference_c.raw_value()));
+  }
+  BOOST_CHECK((fabs(reference.value() / physics::sum(e).value() - 1.) <
+               1e-12));
+  // compensation recovers the small terms lost next to the large ones
+  std::vector<su::energy::MeV> c(10000, su::energy::MeV{1.});
+  c.front() = su::energy::MeV{1e17};
+  c.back() = su::energy::MeV{-1e17};
+  BOOST_CHECK(
+      (physics::reproducible_sum(c, physics::summation::compensated).value() ==
+       9998.));
+  BOOST_CHECK((physics::reproducible_sum(std::vector<su::energy::MeV>{})
+                   .value() == 0.));
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <array>
+#include <cmath>
 
 #define BOOST_TEST_MODULE test_unit
 #include <boost/test/unit_test.hpp>
@@ -16,6 +17,15 @@ constexpr const char* radian_name{"rad"};
 
 using std::fabs;
 
+// a and b are at most n representable doubles apart (n units in the last
+// place), for values that are only exact up to rounding
+bool within_ulps(double a, double b, int n) {
+  for (int i = 0; i < n && a != b; ++i) {
+    a = std::nextafter(a, b);
+  }
+  return a == b;
+}
+
 BOOST_AUTO_TEST_CASE(test_unit_system) {
   using sys1_type = physics::unit_system<mm_name, ns_name, MeV_name>;
   using sys2_type =
@@ -157,7 +167,9 @@ BOOST_AUTO_TEST_CASE(test_quantity) {
     double val = q_pi_cm_over_2.value() * (physics::unit_impl::pi * 10.) / 2.;
     BOOST_CHECK((q_mm.value() == val));
     // extract value in another unit
-    BOOST_CHECK((q_mm.value<pi_cm_over_2_type>() == q_pi_cm_over_2.value()));
+    // (the round trip is exact up to rounding of the rescale factors)
+    BOOST_CHECK((within_ulps(q_mm.value<pi_cm_over_2_type>(),
+                             q_pi_cm_over_2.value(), 1)));
     BOOST_CHECK((q_mm.value<mm_type>() == q_mm.value()));
     // value and raw_value are the same for dimensionfull units
     BOOST_CHECK((q_mm.value() == q_mm.raw_value()));
@@ -174,6 +186,20 @@ BOOST_AUTO_TEST_CASE(test_quantity) {
     // factors)
     BOOST_CHECK((q00.value() == val0 && q01.value() == val1));
   }
+  // fractional powers of 10 and pi are rescaled with a compile-time constant
+  {
+    using frac_type = physics::unit<sys1_type, distance_type, std::ratio<1, 2>,
+                                    std::ratio<-1, 3>>;
+    constexpr physics::quantity<frac_type> q_frac{q_mm};
+    constexpr double factor{
+        physics::unit_impl::rescale_factor<frac_type, mm_type>()};
+    static_assert(factor > 0.3 && factor < 0.5,
+                  "10^(-1/2) pi^(1/3) should be evaluated at compile time");
+    double val = q_mm.value() * std::pow(10., -0.5) *
+                 std::cbrt(physics::unit_impl::pi);
+    BOOST_CHECK((fabs(q_frac.value() - val) < 1.e-12 * val));
+    BOOST_CHECK((within_ulps(q_frac.value<mm_type>(), q_mm.value(), 1)));
+  }
 
   //
   // multiplication and division (implicit testing of I/O,
@@ -185,7 +211,7 @@ BOOST_AUTO_TEST_CASE(test_quantity) {
     auto qm = q_mm * q_pi_cm_over_2;
     auto qd = q_mm / q_pi_cm_over_2;
     BOOST_CHECK((qm.value() == q_mm.value() * q_pi_cm_over_2.value()));
-    BOOST_CHECK((qd.value() == 1));
+    BOOST_CHECK((within_ulps(qd.value(), 1, 1)));
     using qm_unit_type = typename decltype(qm)::unit;
     using qd_unit_type = typename decltype(qd)::unit;
     BOOST_CHECK((qm_unit_type::pow_10::num == 1));
@@ -238,7 +264,7 @@ BOOST_AUTO_TEST_CASE(test_quantity) {
     BOOST_CHECK(
         (qm.value() ==
          q_mm.value() * q00.raw_value() * q00.value() * 3.2 * 2.1 * 3.4));
-    BOOST_CHECK((qd_inv.value() == 1. / qd.value()));
+    BOOST_CHECK((within_ulps(qd_inv.value(), 1. / qd.value(), 1)));
     BOOST_CHECK(
         (physics::unit_string(qd_inv) == " x (0.25 x 10^2 x pi) mm^-1"));
   }
@@ -313,7 +339,7 @@ BOOST_AUTO_TEST_CASE(test_quantity) {
     BOOST_CHECK((qm.raw_value() ==
                  q00.raw_value() * q00.raw_value() * q00.value() * q00.value() *
                      3.2 * 2.1 * 3.4));
-    BOOST_CHECK((qd_inv.value() == 1. / qd.value()));
+    BOOST_CHECK((within_ulps(qd_inv.value(), 1. / qd.value(), 1)));
     BOOST_CHECK((physics::unit_string(qd_inv) == " x (6 x 10^-2 x pi^-1)"));
     double dm = qm;
     double dd = qd;
@@ -598,7 +624,7 @@ BOOST_AUTO_TEST_CASE(test_quantity) {
   {
     auto qpr = q00.pow<std::ratio<2,3>>();
     BOOST_CHECK((physics::unit_string(qpr) == " x (10^(4/3) x pi^(2/3))"));
-    BOOST_CHECK((qpr.value() == std::pow(q00.value(), 2./3)));
+    BOOST_CHECK((within_ulps(qpr.value(), std::pow(q00.value(), 2. / 3), 2)));
     auto qpn = qpr.pow<3,2>();
     BOOST_CHECK((physics::unit_string(qpn) == " x (10^2 x pi)"));
     BOOST_CHECK((fabs(qpn.value() - q00.value()) < 1.e-10));
@@ -616,7 +642,7 @@ BOOST_AUTO_TEST_CASE(test_quantity) {
   {
     auto qpr = pow<std::ratio<2,3>>(q00);
     BOOST_CHECK((physics::unit_string(qpr) == " x (10^(4/3) x pi^(2/3))"));
-    BOOST_CHECK((qpr.value() == std::pow(q00.value(), 2./3)));
+    BOOST_CHECK((within_ulps(qpr.value(), std::pow(q00.value(), 2. / 3), 2)));
     auto qpn = pow<3,2>(qpr);
     BOOST_CHECK((physics::unit_string(qpn) == " x (10^2 x pi)"));
     BOOST_CHECK((fabs(qpn.value() - q00.value()) < 1.e-10));
@@ -629,6 +655,120 @@ BOOST_AUTO_TEST_CASE(test_quantity) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(test_quantity_rep) {
+  using sys1_type = physics::unit_system<mm_name, ns_name, MeV_name>;
+  using distance_type =
+      physics::unit_dimensions<std::ratio<1>, std::ratio<0>, std::ratio<0>>;
+  using mm_type = physics::unit<sys1_type, distance_type>;
+  using cm_type = physics::unit<sys1_type, distance_type, std::ratio<1>>;
+  using mm_d = physics::quantity<mm_type>;
+  using mm_f = physics::quantity<mm_type, float>;
+  using cm_f = physics::quantity<cm_type, float>;
+  using mm_i = physics::quantity<mm_type, int>;
+
+  // storage and defaults
+  static_assert(std::is_same<mm_d, physics::quantity<mm_type, double>>::value,
+                "Rep defaults to double");
+  static_assert(sizeof(mm_f) == sizeof(float) && sizeof(mm_i) == sizeof(int),
+                "quantity only stores its Rep");
+  static_assert(std::is_same<mm_f::rep, float>::value, "");
+
+  // conversion between reps only on explicit request
+  static_assert(!std::is_convertible<mm_d, mm_f>::value &&
+                    !std::is_convertible<mm_f, mm_d>::value,
+                "Conversion to a different Rep has to be explicit");
+  static_assert(std::is_convertible<mm_f, cm_f>::value,
+                "Unit conversion within the same Rep is implicit");
+  constexpr cm_f qf{1.5f};
+  constexpr mm_d qd{qf};
+  BOOST_CHECK((qd.value() == 15.));
+  constexpr auto qi = physics::quantity_cast<mm_i>(mm_d{7.9});
+  BOOST_CHECK((qi.value() == 7));
+  mm_f qf2 = qf;
+  BOOST_CHECK((qf2.value() == 15.f));
+
+  // mixed-rep arithmetic follows std::common_type
+  {
+    constexpr mm_f a{2.f};
+    constexpr mm_d b{0.5};
+    constexpr auto s = a + b;
+    constexpr auto p = a * b;
+    constexpr auto d = a / 2.;
+    constexpr auto f = a * 2.f;
+    constexpr auto i = mm_i{3} * 2;
+    static_assert(std::is_same<decltype(s), const mm_d>::value, "");
+    static_assert(std::is_same<decltype(p)::rep, double>::value, "");
+    static_assert(std::is_same<decltype(d), const mm_d>::value, "");
+    static_assert(std::is_same<decltype(f), const mm_f>::value, "");
+    static_assert(std::is_same<decltype(i), const mm_i>::value, "");
+    BOOST_CHECK((s.value() == 2.5 && p.value() == 1. && d.value() == 1.));
+    BOOST_CHECK((f.value() == 4.f && i.value() == 6));
+    // the result of a mixed-rep sum is in the LHS unit
+    constexpr auto s2 = qf + b;
+    static_assert(std::is_same<decltype(s2)::unit, cm_type>::value, "");
+    BOOST_CHECK((fabs(s2.value() - 1.55) < 1e-6));
+    // roots of integer quantities are evaluated in double precision
+    auto r = mm_i{4}.sqrt();
+    static_assert(std::is_same<decltype(r)::rep, double>::value, "");
+    BOOST_CHECK((r.value() == 2.));
+  }
+
+  // integer quantities only convert implicitly when the value is exact, and
+  // are compared in the unit that is exact
+  {
+    using cm_i = physics::quantity<cm_type, int>;
+    static_assert(std::is_convertible<cm_i, mm_i>::value &&
+                      !std::is_convertible<mm_i, cm_i>::value &&
+                      std::is_constructible<cm_i, mm_i>::value,
+                  "Truncating unit conversion has to be explicit");
+    constexpr auto s = mm_i{15} + cm_i{1};
+    static_assert(std::is_same<decltype(s), const mm_i>::value, "");
+    BOOST_CHECK((s.value() == 25 && cm_i{mm_i{15}}.value() == 1));
+    BOOST_CHECK((!(cm_i{1} == mm_i{15}) && cm_i{1} != mm_i{15}));
+    BOOST_CHECK((cm_i{1} == mm_i{10} && mm_i{10} == cm_i{1}));
+    BOOST_CHECK((cm_i{1} < mm_i{15} && cm_i{1} <= mm_i{15}));
+    BOOST_CHECK((cm_i{2} > mm_i{15} && cm_i{2} >= mm_i{15}));
+    BOOST_CHECK((mm_i{15} < cm_i{2} && !(mm_i{15} < cm_i{1})));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_fixed_quantity) {
+  namespace su = physics::standard_units;
+  using tdc_time =
+      physics::fixed_quantity<su::time::ns, std::ratio<25, 1024>>;
+  using adc_energy =
+      physics::fixed_quantity<su::energy::keV, std::ratio<1, 2>, std::uint16_t>;
+  static_assert(sizeof(tdc_time) == 4 && sizeof(adc_energy) == 2,
+                "fixed quantities only store the integer count");
+  static_assert(std::is_same<tdc_time::rep, std::int32_t>::value, "");
+
+  constexpr tdc_time t1{1024};
+  constexpr tdc_time t2{100};
+  // integer arithmetic and comparison stay in the integer domain
+  constexpr auto dt = t1 - t2;
+  static_assert(std::is_same<decltype(dt), const tdc_time>::value, "");
+  BOOST_CHECK((dt.value() == 924 && t2 < t1 && (t1 + t2).value() == 1124));
+  // conversion to a floating point quantity (explicit, one multiplication)
+  constexpr su::time::ns t1_ns{t1};
+  BOOST_CHECK((t1_ns.value() == 25.));
+  BOOST_CHECK((su::time::ps{dt}.value() == 924 * 25000. / 1024.));
+  BOOST_CHECK((su::energy::MeV{adc_energy{3000}}.value() == 1.5));
+  // and back (truncating)
+  BOOST_CHECK((tdc_time{su::time::ns{0.05}}.value() == 2));
+  BOOST_CHECK((physics::unit_string(t1) == " x (0.0244141) ns"));
+  // conversion to other integer units only implicit when exact
+  using ns_count = physics::fixed_quantity<su::time::ns, std::ratio<1>>;
+  using tdc_fine =
+      physics::fixed_quantity<su::time::ns, std::ratio<1, 1024>>;
+  static_assert(!std::is_convertible<tdc_time, ns_count>::value &&
+                    !std::is_convertible<ns_count, tdc_time>::value &&
+                    std::is_convertible<tdc_time, tdc_fine>::value,
+                "Truncating unit conversion has to be explicit");
+  BOOST_CHECK((ns_count{tdc_time{1000}}.value() == 24));
+  constexpr tdc_fine t1_fine{t1};
+  BOOST_CHECK((t1_fine.value() == 25600 && t1_fine == t1 && t2 < t1_fine));
+}
+
 namespace myunits {
 using system = physics::unit_system<mm_name, ns_name>;
 using distance_dim = physics::unit_dimensions<std::ratio<1>, std::ratio<0>>;
@@ -638,6 +778,8 @@ PHYSICS_DEFINE_PREFIX_QUANTITIES(m, m_unit);
 }
 }
 PHYSICS_DEFINE_PREFIX_QUANTITY_NAMES(myunits::distance, m);
+PHYSICS_DEFINE_SYSTEM_UNIT_NAMES(
+    myunits::system, physics::unit_impl::prefix_units<myunits::distance::m>);
 
 BOOST_AUTO_TEST_CASE(test_unit_prefix) {
   // TODO finalize test_unit_prefix
@@ -647,6 +789,9 @@ BOOST_AUTO_TEST_CASE(test_unit_prefix) {
   distance::dam d3 {0.2};
   BOOST_CHECK((d1 == d2));
   BOOST_CHECK((d2 > d3));
+  BOOST_CHECK((physics::parse_quantity("2 km", d1) && d1.value() == 2000));
+  BOOST_CHECK((physics::unit_impl::registered_unit_name<
+                   distance::dam::unit>() == "dam"));
 //  std::cout << physics::standard_units::constants::c
 //            << physics::unit_string(physics::standard_units::constants::c)
 //            << std::endl;
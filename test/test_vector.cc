@@ -5,7 +5,9 @@
 
 #include "physics/unit.hh"
 
+#include <algorithm>
 #include <cmath>
+#include <random>
 
 constexpr const char* mm_name{"mm"};
 constexpr const char* ns_name{"ns"};
@@ -36,6 +38,16 @@ double cos(quantities::angle_radian_type phi) { return std::cos(phi.value()); }
 double sin(quantities::angle_radian_type phi) { return std::sin(phi.value()); }
 
 #include "physics/vector.hh"
+#include "physics/vector/array.hh"
+#include "physics/vector/boost.hh"
+#include "physics/vector/combinatorics.hh"
+#include "physics/vector/grid_hash.hh"
+#include "physics/vector/jet.hh"
+#include "physics/vector/kdtree.hh"
+#include "physics/vector/kinematics.hh"
+#include "physics/vector/matching.hh"
+#include "physics/vector/padded.hh"
+#include "physics/vector/transform.hh"
 namespace quantities {
 using velocity_vector =
     physics::vector<velocity_mm_per_ns_type, angle_radian_type>;
@@ -699,3 +711,768 @@ BOOST_AUTO_TEST_CASE(lorentzvector_quantity) {
     velocity_lorentzvector vcm_too = physics::boost(v, v.beta());
   }
 }
+
+// vectors of single-precision quantities
+BOOST_AUTO_TEST_CASE(vector_float) {
+  using namespace quantities;
+  using velocity_f_type = physics::quantity<mm_per_ns_type, float>;
+  using velocity_f_vector = physics::vector<velocity_f_type, angle_radian_type>;
+  using velocity_f_lorentzvector =
+      physics::lorentzvector<velocity_f_type, angle_radian_type>;
+  static_assert(sizeof(velocity_f_vector) == 3 * sizeof(float), "");
+  static_assert(!std::is_convertible<velocity_vector, velocity_f_vector>::value,
+                "Conversion to a different Rep has to be explicit");
+
+  constexpr velocity_f_vector vf{velocity_f_type{1.f}, velocity_f_type{2.f},
+                                 velocity_f_type{3.f}};
+  // same Rep: stays in float
+  auto sum = vf + vf;
+  static_assert(
+      std::is_same<decltype(sum.x1), velocity_f_type>::value, "");
+  BOOST_CHECK((sum.x3.value() == 6.f));
+  // mixed Rep: promoted to double
+  const velocity_vector vd{vf};
+  auto mixed = vf + vd;
+  static_assert(
+      std::is_same<decltype(mixed.x1), velocity_mm_per_ns_type>::value, "");
+  BOOST_CHECK((mixed == velocity_vector{vd * 2.}));
+  BOOST_CHECK((vf.mag2().value() == 14.f));
+  velocity_f_vector vs{vf};
+  vs *= 2.;
+  BOOST_CHECK((vs.x2.value() == 4.f));
+
+  // boosts keep the Rep of the lorentzvector
+  const velocity_f_lorentzvector lv{velocity_f_type{9.83e3f}, vf};
+  velocity_f_lorentzvector lvcm = lv.boost(lv.beta());
+  BOOST_CHECK((fabs(lvcm.x.x3.value()) < 1e-3));
+}
+
+// structure-of-arrays vector container
+BOOST_AUTO_TEST_CASE(vector_array) {
+  using namespace quantities;
+  using array_type = physics::vector_array<velocity_mm_per_ns_type>;
+  using array2_type = physics::vector_array<velocity_m_per_ns_type>;
+  const velocity_mm_per_ns_type v0{0}, v1{1}, v2{2}, v3{3};
+  array_type a{{v1, v2, v3}, {v3, v0, v1}, {v2, v2, v2}};
+  const array2_type b(3, {velocity_m_per_ns_type{1e-3}, v0, v1});
+  BOOST_CHECK((a.size() == 3 && b.size() == 3));
+
+  // proxy element access
+  BOOST_CHECK((a[1].x1 == v3 && a[1] == physics::vector<velocity_mm_per_ns_type>{
+                                            v3, v0, v1}));
+  a[2] = physics::vector<velocity_mm_per_ns_type>{v1, v0, v1};
+  a[2].x2 = v2;
+  a[2] *= 2.;
+  BOOST_CHECK((a[2].x1 == v2 && a[2].x2.value() == 4. && a[2].x3 == v2));
+  physics::vector<velocity_mm_per_ns_type> sum;
+  for (const auto& v : a) {
+    sum += v;
+  }
+  BOOST_CHECK((sum.x1.value() == 6. && sum.x2.value() == 6.));
+  a[2] = a[0];
+  BOOST_CHECK((a[2] == a[0]));
+
+  // batch arithmetic matches the element-wise vector arithmetic
+  const auto sum_ab = a + b;
+  const auto diff_ab = a - b;
+  const auto dot_ab = a * b;
+  const auto cross_ab = a ^ b;
+  const auto mag2_a = a.mag2();
+  const auto mag_a = a.mag();
+  const auto scaled = 2. * a / 4.;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    const physics::vector<velocity_mm_per_ns_type> va{a[i]};
+    const physics::vector<velocity_m_per_ns_type> vb{b[i]};
+    BOOST_CHECK((sum_ab[i] == va + vb));
+    BOOST_CHECK((diff_ab[i] == va - vb));
+    BOOST_CHECK((dot_ab[i] == va * vb));
+    BOOST_CHECK((cross_ab[i] == (va ^ vb)));
+    BOOST_CHECK((mag2_a[i] == va.mag2()));
+    BOOST_CHECK((mag_a[i] == va.mag()));
+    BOOST_CHECK((scaled[i] == va * 0.5));
+  }
+  static_assert(std::is_same<typename decltype(dot_ab)::value_type,
+                             decltype(v1 * velocity_m_per_ns_type{})>::value,
+                "");
+  array_type c{a};
+  c += b;
+  c -= a;
+  BOOST_CHECK((c[0] == physics::vector<velocity_m_per_ns_type>{b[0]}));
+  // in-place division rounds like the element-wise and out-of-place division
+  array_type q{{velocity_mm_per_ns_type{0.1}, v1, velocity_mm_per_ns_type{7}},
+               {velocity_mm_per_ns_type{0.7}, v2, v3}};
+  const auto qd = q / 3.;
+  const physics::vector<velocity_mm_per_ns_type> q0{q[0]}, q1{q[1]};
+  q /= 3.;
+  physics::vector<velocity_mm_per_ns_type> vq0{q0}, vq1{q1};
+  vq0 /= 3.;
+  vq1 /= 3.;
+  BOOST_CHECK((q[0] == vq0 && q[1] == vq1));
+  BOOST_CHECK((q[0] == qd[0] && q[1] == qd[1]));
+  BOOST_CHECK_THROW(a + array_type(2), physics::expression_error);
+}
+
+BOOST_AUTO_TEST_CASE(boost_transform) {
+  using namespace quantities;
+  using array_type = physics::lorentzvector_array<energy_MeV_type>;
+  const auto close = [](const physics::lorentzvector<energy_MeV_type>& a,
+                        const physics::lorentzvector<energy_MeV_type>& b) {
+    return std::fabs((a.x0 - b.x0).value()) < 1e-9 &&
+           std::fabs((a.x.x1 - b.x.x1).value()) < 1e-9 &&
+           std::fabs((a.x.x2 - b.x.x2).value()) < 1e-9 &&
+           std::fabs((a.x.x3 - b.x.x3).value()) < 1e-9;
+  };
+  const physics::vector<double> beta{0.3, -0.2, 0.5};
+  const physics::boost_transform t{beta};
+  BOOST_CHECK((std::fabs(t.gamma() - 1. / std::sqrt(1. - beta.mag2())) <
+               1e-12));
+  array_type p(17);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    const double d{static_cast<double>(i)};
+    p[i] = physics::lorentzvector<energy_MeV_type>{
+        energy_MeV_type{100. + d},
+        {energy_MeV_type{d}, energy_MeV_type{-2. * d}, energy_MeV_type{5.}}};
+  }
+  // single vectors and batches agree with lorentzvector::boost
+  const auto q = t(p);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    const physics::lorentzvector<energy_MeV_type> pi{p[i]};
+    BOOST_CHECK(close(t(pi), pi.boost(beta)));
+    BOOST_CHECK(close(q[i], pi.boost(beta)));
+    BOOST_CHECK(close(t.inverse()(q[i]), pi));
+  }
+  // boosting into the rest frame leaves only the mass
+  const physics::lorentzvector<energy_MeV_type> rest{
+      physics::boost_transform{physics::lorentzvector<energy_MeV_type>{p[3]}}(
+          p[3])};
+  BOOST_CHECK((std::fabs((rest.x0 - p[3].mag()).value()) < 1e-9 &&
+               std::fabs(rest.x.mag().value()) < 1e-9));
+  // the identity transform
+  array_type r{p};
+  physics::boost_transform{}.apply(r);
+  BOOST_CHECK((r[5] == p[5]));
+}
+
+BOOST_AUTO_TEST_CASE(lorentz_transform) {
+  using namespace quantities;
+  using array_type = physics::lorentzvector_array<energy_MeV_type>;
+  const auto close = [](const physics::lorentzvector<energy_MeV_type>& a,
+                        const physics::lorentzvector<energy_MeV_type>& b) {
+    return std::fabs((a.x0 - b.x0).value()) < 1e-9 &&
+           std::fabs((a - b).x.mag().value()) < 1e-9;
+  };
+  const double pi{std::acos(-1.)};
+  // a right-handed rotation around the z-axis
+  const physics::rotation3 rz{physics::vector<double>{0., 0., 2.}, pi / 2};
+  const auto y = rz(physics::vector<double>{1., 0., 0.});
+  BOOST_CHECK((std::fabs(y.x1) < 1e-12 && std::fabs(y.x2 - 1.) < 1e-12));
+  // composition of rotations, and the rotation of a vector_array
+  const physics::rotation3 rx{physics::vector<double>{1., 0., 0.}, 0.3};
+  const physics::vector<double> v{0.5, -1.5, 2.};
+  BOOST_CHECK(((rz * rx)(v) - rz(rx(v))).mag() < 1e-12);
+  BOOST_CHECK(((rz * rz.inverse())(v) - v).mag() < 1e-12);
+  physics::vector_array<double> va(5, v);
+  rx.apply(va);
+  BOOST_CHECK((va[4] == rx(v)));
+
+  // a chain of rotate, boost and rotate collapses into one transformation
+  const physics::boost_transform b{physics::vector<double>{0.1, 0.4, -0.2}};
+  const physics::lorentz_transform t{rz * b * rx};
+  array_type p(9);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    const double d{static_cast<double>(i)};
+    p[i] = physics::lorentzvector<energy_MeV_type>{
+        energy_MeV_type{50. + d},
+        {energy_MeV_type{d}, energy_MeV_type{3.}, energy_MeV_type{-d}}};
+  }
+  const auto q = t(p);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    const physics::lorentzvector<energy_MeV_type> pi{p[i]};
+    BOOST_CHECK(close(q[i], rz(b(rx(pi)))));
+    BOOST_CHECK(close(t.inverse()(q[i]), pi));
+    // the invariant mass is conserved
+    BOOST_CHECK((std::fabs((q[i].mag() - pi.mag()).value()) < 1e-9));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(kinematics) {
+  using namespace quantities;
+  using physics::approximation;
+  const double pi{std::acos(-1.)};
+  // scalar accessors
+  const energy_vector p{energy_MeV_type{3.}, energy_MeV_type{-3.},
+                        energy_MeV_type{0.}};
+  BOOST_CHECK((std::fabs((p.perp() - energy_MeV_type{std::sqrt(18.)}).value()) <
+               1e-12));
+  BOOST_CHECK((std::fabs(p.phi().value() + pi / 4) < 1e-12));
+  BOOST_CHECK((std::fabs(p.theta().value() - pi / 2) < 1e-12));
+  BOOST_CHECK((std::fabs(p.eta()) < 1e-12));
+  const energy_lorentzvector l{energy_MeV_type{5.},
+                               {energy_MeV_type{0.}, energy_MeV_type{0.},
+                                energy_MeV_type{3.}}};
+  BOOST_CHECK((std::fabs(l.rapidity() - std::log(2.)) < 1e-12));
+  BOOST_CHECK((std::fabs(l.mt().value() - 4.) < 1e-12));
+  BOOST_CHECK((physics::mt(l) == l.mt() && physics::eta(p) == p.eta()));
+
+  // batch versions agree with the scalar accessors, the fast approximations
+  // within the documented maximum errors
+  const std::size_t n{1000};
+  physics::lorentzvector_array<energy_MeV_type, angle_radian_type> a(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const double d{static_cast<double>(i)};
+    a[i] = energy_lorentzvector{
+        energy_MeV_type{1000. + d},
+        {energy_MeV_type{std::cos(d) * (1 + d)},
+         energy_MeV_type{std::sin(3 * d) * 50.},
+         energy_MeV_type{(d - 500.) * 1.9}}};
+  }
+  const auto perp = physics::perp(a);
+  const auto phi = physics::phi(a);
+  const auto phi_fast = physics::phi(a, approximation::fast);
+  const auto theta_fast = physics::theta(a, approximation::fast);
+  const auto eta = physics::eta(a);
+  const auto eta_fast = physics::eta(a, approximation::fast);
+  const auto y_fast = physics::rapidity(a, approximation::fast);
+  const auto mt = physics::mt(a);
+  for (std::size_t i = 0; i < n; ++i) {
+    const energy_lorentzvector v{a[i]};
+    BOOST_CHECK((perp[i] == v.perp() && phi[i] == v.phi() &&
+                 eta[i] == v.eta() && mt[i] == v.mt()));
+    BOOST_CHECK((std::fabs((phi_fast[i] - v.phi()).value()) < 1e-8));
+    BOOST_CHECK((std::fabs((theta_fast[i] - v.theta()).value()) < 1e-8));
+    BOOST_CHECK((std::fabs(eta_fast[i] - v.eta()) < 1e-9));
+    BOOST_CHECK((std::fabs(y_fast[i] - v.rapidity()) < 1e-9));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(padded_vector) {
+  using namespace quantities;
+  using padded_type = physics::padded_vector<energy_MeV_type, angle_radian_type>;
+  using padded_lorentz_type =
+      physics::padded_lorentzvector<energy_MeV_type, angle_radian_type>;
+  static_assert(sizeof(padded_type) == 32 && alignof(padded_type) == 32, "");
+  static_assert(sizeof(padded_lorentz_type) == 32, "");
+  const energy_MeV_type e1{1}, e2{2}, e3{3}, e4{-4};
+  const energy_vector a{e1, e2, e3}, b{e4, e1, e2};
+  const padded_type pa{a}, pb{b};
+  // same results as the 3-component layout
+  BOOST_CHECK((energy_vector(pa) == a && pa.x3() == e3));
+  BOOST_CHECK((energy_vector(pa + pb) == a + b));
+  BOOST_CHECK((energy_vector(pa - pb) == a - b));
+  BOOST_CHECK((pa * pb == a * b && pa.mag2() == a.mag2()));
+  BOOST_CHECK((pa.mag() == a.mag()));
+  const auto cross = pa ^ pb;
+  BOOST_CHECK((cross.x1() == (a ^ b).x1 && cross.x2() == (a ^ b).x2 &&
+               cross.x3() == (a ^ b).x3 && cross.raw()[3] == 0.));
+  const auto scaled = 2. * pa / e2;
+  const decltype(2. * a / e2) scaled_vector = scaled;
+  BOOST_CHECK((scaled_vector == 2. * a / e2));
+  // lorentzvectors: mag, beta and boost
+  const energy_lorentzvector l{energy_MeV_type{10}, a};
+  const padded_lorentz_type pl{l};
+  BOOST_CHECK((std::fabs((pl.mag() - l.mag()).value()) < 1e-12));
+  const decltype(l.beta()) beta_vector = pl.beta();
+  BOOST_CHECK((beta_vector == l.beta()));
+  const physics::vector<double> beta{0.2, -0.4, 0.1};
+  const energy_lorentzvector boosted{
+      pl.boost(physics::padded_vector<double>{beta})};
+  const energy_lorentzvector expected{l.boost(beta)};
+  BOOST_CHECK((std::fabs((boosted.x0 - expected.x0).value()) < 1e-12 &&
+               (boosted.x - expected.x).mag().value() < 1e-12));
+}
+
+BOOST_AUTO_TEST_CASE(combinatorics) {
+  using namespace quantities;
+  using array_type =
+      physics::lorentzvector_array<energy_MeV_type, angle_radian_type>;
+  using window_type = physics::mass_window<energy_MeV_type>;
+  const std::size_t n{9};
+  array_type event(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const double d{static_cast<double>(i)};
+    event[i] = energy_lorentzvector{
+        energy_MeV_type{50. + 7. * d},
+        {energy_MeV_type{10. * std::cos(d)}, energy_MeV_type{12. - d},
+         energy_MeV_type{5. * d - 20.}}};
+  }
+  // all pairs and triples, in lexicographic order, with the masses of the
+  // summed lorentzvectors
+  const auto pairs = physics::combinations<2>(event);
+  BOOST_CHECK((pairs.size() == n * (n - 1) / 2));
+  std::size_t k{0};
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = i + 1; j < n; ++j, ++k) {
+      const energy_lorentzvector sum{energy_lorentzvector(event[i]) +
+                                     energy_lorentzvector(event[j])};
+      BOOST_CHECK((pairs.indices[k][0] == i && pairs.indices[k][1] == j));
+      BOOST_CHECK((std::fabs((pairs.mass[k] - sum.mag()).value()) < 1e-9));
+    }
+  }
+  const auto triples = physics::combinations<3>(event);
+  BOOST_CHECK((triples.size() == n * (n - 1) * (n - 2) / 6));
+  const auto& t = triples.indices[40];
+  const energy_lorentzvector sum3{energy_lorentzvector(event[t[0]]) +
+                                  energy_lorentzvector(event[t[1]]) +
+                                  energy_lorentzvector(event[t[2]])};
+  BOOST_CHECK((t[0] < t[1] && t[1] < t[2]));
+  BOOST_CHECK((std::fabs((triples.mass[40] - sum3.mag()).value()) < 1e-9));
+  // mass window and mask: only the selected survivors, with the original
+  // indices
+  const window_type window{energy_MeV_type{100.}, energy_MeV_type{130.}};
+  std::vector<bool> mask(n, true);
+  mask[2] = mask[5] = false;
+  const auto selected = physics::combinations<2>(event, mask, window);
+  std::size_t expected{0};
+  for (std::size_t k = 0; k < pairs.size(); ++k) {
+    if (mask[pairs.indices[k][0]] && mask[pairs.indices[k][1]] &&
+        window.contains(pairs.mass[k])) {
+      BOOST_CHECK((selected.indices[expected] == pairs.indices[k] &&
+                   selected.mass[expected] == pairs.mass[k]));
+      ++expected;
+    }
+  }
+  BOOST_CHECK((expected > 0 && selected.size() == expected));
+  BOOST_CHECK((physics::combinations<4>(event, std::vector<bool>(n, false))
+                   .empty()));
+  BOOST_CHECK_THROW(physics::combinations<2>(event, std::vector<bool>(3)),
+                    physics::combinatorics_error);
+  // many events in parallel: the same result as one event at a time
+  std::vector<array_type> events;
+  for (std::size_t e = 0; e < 20; ++e) {
+    events.push_back(event);
+    events.back().resize(e % n);
+  }
+  physics::thread_pool pool{3};
+  const auto results = physics::combinations<3>(events, pool, window);
+  BOOST_CHECK((results.size() == events.size()));
+  for (std::size_t e = 0; e < events.size(); ++e) {
+    const auto single = physics::combinations<3>(events[e], window);
+    BOOST_CHECK((results[e].indices == single.indices &&
+                 results[e].size() == single.size()));
+  }
+  const std::vector<std::vector<bool>> masks(events.size(),
+                                             std::vector<bool>(n, true));
+  BOOST_CHECK_THROW(physics::combinations<2>(events, masks, pool),
+                    physics::combinatorics_error);
+}
+
+// O(N^3) generalized-kt clustering, returns the sorted constituents of the
+// jets
+std::vector<std::vector<std::size_t>>
+reference_jets(const std::vector<physics::lorentzvector<double>>& particles,
+               double p, double radius) {
+  const double pi{std::acos(-1.)};
+  std::vector<physics::lorentzvector<double>> jets{particles};
+  std::vector<std::vector<std::size_t>> members(particles.size());
+  for (std::size_t i = 0; i < particles.size(); ++i) {
+    members[i] = {i};
+  }
+  std::vector<std::vector<std::size_t>> result;
+  while (!jets.empty()) {
+    std::size_t a{0}, b{0};
+    double d_min{std::pow(jets[0].perp() * jets[0].perp(), p)};
+    for (std::size_t i = 0; i < jets.size(); ++i) {
+      const double ki{std::pow(jets[i].perp() * jets[i].perp(), p)};
+      if (ki < d_min) {
+        d_min = ki;
+        a = b = i;
+      }
+      for (std::size_t j = i + 1; j < jets.size(); ++j) {
+        const double kj{std::pow(jets[j].perp() * jets[j].perp(), p)};
+        double dphi{std::fabs(jets[i].phi() - jets[j].phi())};
+        dphi = dphi > pi ? 2 * pi - dphi : dphi;
+        const double dy{jets[i].rapidity() - jets[j].rapidity()};
+        const double d{std::min(ki, kj) * (dy * dy + dphi * dphi) /
+                       (radius * radius)};
+        if (d < d_min) {
+          d_min = d;
+          a = i;
+          b = j;
+        }
+      }
+    }
+    if (a == b) {
+      std::sort(members[a].begin(), members[a].end());
+      result.push_back(members[a]);
+    } else {
+      jets[a] = jets[a] + jets[b];
+      members[a].insert(members[a].end(), members[b].begin(),
+                        members[b].end());
+    }
+    jets.erase(jets.begin() + b);
+    members.erase(members.begin() + b);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE(jet_clustering) {
+  using namespace quantities;
+  using physics::jet_algorithm;
+  // a few hard particles with soft particles around them, and a soft
+  // background
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<double> uniform{0., 1.};
+  std::vector<physics::lorentzvector<double>> particles;
+  for (std::size_t i = 0; i < 300; ++i) {
+    const double pt{i % 50 == 0 ? 100. + i : 0.5 + 5. * uniform(rng)};
+    const double y{i % 50 < 25 ? 0.8 * uniform(rng) - 1.
+                               : 6. * uniform(rng) - 3.};
+    const double phi{6.2 * uniform(rng)};
+    particles.push_back(
+        {pt * std::cosh(y), {pt * std::cos(phi), pt * std::sin(phi),
+                             pt * std::sinh(y)}});
+  }
+  const std::pair<jet_algorithm, double> algorithms[]{
+      {jet_algorithm::kt, 1.},
+      {jet_algorithm::cambridge_aachen, 0.},
+      {jet_algorithm::antikt, -1.}};
+  for (const auto& algorithm : algorithms) {
+    for (double radius : {0.4, 1.0, 4.0}) {
+      const auto jets = physics::cluster(
+          particles, physics::jet_definition{algorithm.first, radius});
+      std::vector<std::vector<std::size_t>> constituents;
+      for (std::size_t i = 0; i < jets.size(); ++i) {
+        const auto c = jets.constituents(i);
+        constituents.emplace_back(c.begin(), c.end());
+        physics::lorentzvector<double> sum;
+        for (std::size_t k : c) {
+          sum = sum + particles[k];
+        }
+        BOOST_CHECK((std::fabs(sum.x0 - jets[i].x0) < 1e-9));
+        BOOST_CHECK((i == 0 || jets[i - 1].perp() >= jets[i].perp()));
+      }
+      std::sort(constituents.begin(), constituents.end());
+      BOOST_CHECK((constituents ==
+                   reference_jets(particles, algorithm.second, radius)));
+    }
+  }
+  // a particle without pt, whose anti-kt distances are the largest (and
+  // would overflow for R > 1)
+  const std::vector<physics::lorentzvector<double>> zero_pt{
+      {10., {5., 0., 0.}}, {10., {5., 0.1, 0.}}, {10., {0., 0., 9.99}}};
+  for (double radius : {0.8, 1.5, 4.0}) {
+    const auto jets = physics::cluster(
+        zero_pt, physics::jet_definition{jet_algorithm::antikt, radius});
+    std::vector<std::vector<std::size_t>> constituents;
+    for (std::size_t i = 0; i < jets.size(); ++i) {
+      const auto c = jets.constituents(i);
+      constituents.emplace_back(c.begin(), c.end());
+    }
+    std::sort(constituents.begin(), constituents.end());
+    BOOST_CHECK((constituents == reference_jets(zero_pt, -1., radius)));
+  }
+  // quantities, and a lorentzvector_array input
+  physics::lorentzvector_array<energy_MeV_type, angle_radian_type> a;
+  for (const auto& p : particles) {
+    a.push_back({energy_MeV_type{p.x0},
+                 {energy_MeV_type{p.x.x1}, energy_MeV_type{p.x.x2},
+                  energy_MeV_type{p.x.x3}}});
+  }
+  const auto jets = physics::cluster(
+      a, physics::jet_definition{jet_algorithm::antikt, 0.4});
+  const auto raw_jets = physics::cluster(
+      particles, physics::jet_definition{jet_algorithm::antikt, 0.4});
+  BOOST_CHECK((jets.size() == raw_jets.size() &&
+               jets.indices == raw_jets.indices &&
+               jets[0].x0.value() == raw_jets[0].x0));
+  BOOST_CHECK((physics::cluster(std::vector<energy_lorentzvector>{},
+                                physics::jet_definition{jet_algorithm::kt, 1.})
+                   .empty()));
+  BOOST_CHECK_THROW(physics::jet_definition(jet_algorithm::kt, 0.),
+                    physics::jet_error);
+}
+
+BOOST_AUTO_TEST_CASE(kdtree) {
+  using distance_type = physics::unit_dimensions<std::ratio<1>, std::ratio<0>,
+                                                 std::ratio<0>, std::ratio<0>>;
+  using mm_type = physics::unit<quantities::sys_type, distance_type>;
+  using distance_mm_type = physics::quantity<mm_type>;
+  using position = physics::vector<distance_mm_type>;
+  // hits on a coarse grid (with duplicate distances) and random hits
+  std::mt19937 rng{7};
+  std::uniform_real_distribution<double> u{-100., 100.};
+  std::vector<position> hits;
+  for (int i = 0; i < 1000; ++i) {
+    hits.push_back({distance_mm_type{10. * (i % 10)},
+                    distance_mm_type{10. * (i / 10 % 10)},
+                    distance_mm_type{10. * (i / 100)}});
+  }
+  for (int i = 0; i < 2000; ++i) {
+    hits.push_back({distance_mm_type{u(rng)}, distance_mm_type{u(rng)},
+                    distance_mm_type{0.1 * u(rng)}});
+  }
+  const physics::kdtree<distance_mm_type> tree{hits};
+  physics::thread_pool pool{3};
+  const physics::kdtree<distance_mm_type> parallel_tree{hits, pool};
+  physics::vector_array<distance_mm_type> array;
+  for (const auto& h : hits) {
+    array.push_back(h);
+  }
+  const physics::kdtree<distance_mm_type> array_tree{array};
+  BOOST_CHECK((tree.size() == hits.size() && !tree.empty()));
+
+  const auto distance = [&](std::size_t i, const position& p) {
+    return (hits[i] - p).mag().value();
+  };
+  for (int q = 0; q < 20; ++q) {
+    const position p{q % 2 ? hits[q * 97]
+                           : position{distance_mm_type{u(rng)},
+                                      distance_mm_type{u(rng)},
+                                      distance_mm_type{u(rng)}}};
+    const distance_mm_type radius{q % 5 == 0 ? 10. : 0.5 * q + 1.};
+    // radius query against brute force, the trees agree in the order
+    std::vector<std::size_t> expected;
+    for (std::size_t i = 0; i < hits.size(); ++i) {
+      if (distance(i, p) <= radius.value()) {
+        expected.push_back(i);
+      }
+    }
+    auto found = tree.within(p, radius);
+    BOOST_CHECK((found == parallel_tree.within(p, radius)));
+    std::sort(found.begin(), found.end());
+    BOOST_CHECK((found == expected));
+    // k nearest, ordered by distance and index
+    std::vector<std::size_t> order(hits.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+      const double da{(hits[a] - p).mag2().value()};
+      const double db{(hits[b] - p).mag2().value()};
+      return da < db || (da == db && a < b);
+    });
+    order.resize(10);
+    BOOST_CHECK((tree.nearest(p, 10) == order));
+    BOOST_CHECK((array_tree.nearest(p, 10) == order));
+    // box query
+    const position high{p + position{radius, 2. * radius, radius}};
+    expected.clear();
+    for (std::size_t i = 0; i < hits.size(); ++i) {
+      if (p.x1 <= hits[i].x1 && hits[i].x1 <= high.x1 && p.x2 <= hits[i].x2 &&
+          hits[i].x2 <= high.x2 && p.x3 <= hits[i].x3 &&
+          hits[i].x3 <= high.x3) {
+        expected.push_back(i);
+      }
+    }
+    tree.in_box(p, high, found);
+    std::sort(found.begin(), found.end());
+    BOOST_CHECK((found == expected));
+  }
+  BOOST_CHECK((tree.nearest(hits[0], hits.size() + 5).size() == hits.size()));
+  BOOST_CHECK((tree.within(hits[0], distance_mm_type{-1.}).empty()));
+  BOOST_CHECK((physics::kdtree<distance_mm_type>{}.nearest(hits[0], 3).empty()));
+}
+
+BOOST_AUTO_TEST_CASE(grid_hash) {
+  using distance_type = physics::unit_dimensions<std::ratio<1>, std::ratio<0>,
+                                                 std::ratio<0>, std::ratio<0>>;
+  using mm_type = physics::unit<quantities::sys_type, distance_type>;
+  using distance_mm_type = physics::quantity<mm_type>;
+  using position = physics::vector<distance_mm_type>;
+  std::mt19937 rng{11};
+  std::uniform_real_distribution<double> u{-50., 50.};
+  physics::grid_hash<distance_mm_type> grid{distance_mm_type{4.}};
+  BOOST_CHECK((grid.empty() && grid.within(position{}, distance_mm_type{1.})
+                                   .empty()));
+  // rebuild the grid for events of different sizes, with a far away hit
+  for (const std::size_t n : {500, 0, 1500, 20}) {
+    std::vector<position> hits;
+    for (std::size_t i = 0; i < n; ++i) {
+      hits.push_back({distance_mm_type{u(rng)}, distance_mm_type{u(rng)},
+                      distance_mm_type{u(rng)}});
+    }
+    if (n > 0) {
+      hits[n / 2] = {distance_mm_type{1e12}, distance_mm_type{-3.},
+                     distance_mm_type{0.}};
+    }
+    grid.build(hits);
+    BOOST_CHECK((grid.size() == n));
+    for (std::size_t q = 0; q < std::min<std::size_t>(n, 30); ++q) {
+      // search radii smaller and larger than the cells, and one larger than
+      // the event
+      const distance_mm_type radius{q == 0 ? 1e3 : 0.5 * q};
+      std::vector<std::size_t> expected;
+      for (std::size_t i = 0; i < n; ++i) {
+        if ((hits[i] - hits[q]).mag() <= radius) {
+          expected.push_back(i);
+        }
+      }
+      auto found = grid.within(hits[q], radius);
+      std::sort(found.begin(), found.end());
+      BOOST_CHECK((found == expected));
+    }
+    if (n > 0) {
+      BOOST_CHECK((grid.within(hits[n / 2], distance_mm_type{1.}) ==
+                   std::vector<std::size_t>{n / 2}));
+    }
+    // all pairs within the cutoff, once
+    std::vector<std::pair<std::size_t, std::size_t>> expected, found;
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = i + 1; j < n; ++j) {
+        if ((hits[i] - hits[j]).mag() <= distance_mm_type{5.}) {
+          expected.emplace_back(i, j);
+        }
+      }
+    }
+    grid.for_each_pair(distance_mm_type{5.}, [&](std::size_t i, std::size_t j) {
+      found.emplace_back(i, j);
+    });
+    std::sort(found.begin(), found.end());
+    BOOST_CHECK((found == expected));
+  }
+  BOOST_CHECK_THROW(
+      physics::grid_hash<distance_mm_type>{distance_mm_type{0.}},
+      physics::grid_hash_error);
+}
+
+namespace {
+// best matching of a[i] (i >= i0) by brute force: the most matches, then the
+// smallest sum of deltaR
+std::pair<std::size_t, double>
+best_matching(const std::vector<std::vector<double>>& d, double cut,
+              std::size_t i0, std::vector<bool>& used) {
+  if (i0 == d.size()) {
+    return {0, 0.};
+  }
+  auto best = best_matching(d, cut, i0 + 1, used);
+  for (std::size_t j = 0; j < used.size(); ++j) {
+    if (!used[j] && d[i0][j] <= cut) {
+      used[j] = true;
+      auto r = best_matching(d, cut, i0 + 1, used);
+      used[j] = false;
+      ++r.first;
+      r.second += d[i0][j];
+      if (r.first > best.first ||
+          (r.first == best.first && r.second < best.second - 1e-12)) {
+        best = r;
+      }
+    }
+  }
+  return best;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(delta_r_matching) {
+  using namespace quantities;
+  using physics::match_strategy;
+  using array_type =
+      physics::lorentzvector_array<energy_MeV_type, angle_radian_type>;
+  using raw_lorentzvector = physics::lorentzvector<double>;
+  std::mt19937 rng{5};
+  std::uniform_real_distribution<double> u{0., 1.};
+  const auto random_particle = [&](double eta_range) {
+    const double pt{1. + 10. * u(rng)};
+    const double eta{eta_range * (2. * u(rng) - 1.)};
+    const double phi{2. * M_PI * u(rng)};
+    return raw_lorentzvector{pt * std::cosh(eta),
+                             {pt * std::cos(phi), pt * std::sin(phi),
+                              pt * std::sinh(eta)}};
+  };
+  const auto delta_r = [](const raw_lorentzvector& a,
+                          const raw_lorentzvector& b) {
+    double dphi{std::fabs(std::atan2(a.x.x2, a.x.x1) -
+                          std::atan2(b.x.x2, b.x.x1))};
+    dphi = dphi > M_PI ? 2 * M_PI - dphi : dphi;
+    const double deta{a.x.eta() - b.x.eta()};
+    return std::sqrt(deta * deta + dphi * dphi);
+  };
+  // batch deltaR, across the phi boundary
+  const raw_lorentzvector a{10., {-5., 0.01, 1.}};
+  const raw_lorentzvector b{10., {-5., -0.01, 2.}};
+  array_type first, second;
+  first.push_back({energy_MeV_type{a.x0},
+                   {energy_MeV_type{a.x.x1}, energy_MeV_type{a.x.x2},
+                    energy_MeV_type{a.x.x3}}});
+  second.push_back({energy_MeV_type{b.x0},
+                    {energy_MeV_type{b.x.x1}, energy_MeV_type{b.x.x2},
+                     energy_MeV_type{b.x.x3}}});
+  BOOST_CHECK((std::fabs(physics::delta_r(first, second)[0] - delta_r(a, b)) <
+               1e-12));
+  BOOST_CHECK((delta_r(a, b) < 0.3));
+  BOOST_CHECK_THROW(physics::delta_r(first, array_type{}),
+                    physics::expression_error);
+
+  for (int event = 0; event < 40; ++event) {
+    // small events (the optimal matching is checked by brute force), and a
+    // wide cut for crowded events
+    const std::size_t n_a{1 + static_cast<std::size_t>(6 * u(rng))};
+    const std::size_t n_b{1 + static_cast<std::size_t>(6 * u(rng))};
+    const double cut{event % 2 ? 0.8 : 2.5};
+    std::vector<raw_lorentzvector> va, vb;
+    for (std::size_t i = 0; i < n_a; ++i) {
+      va.push_back(random_particle(1.5));
+    }
+    for (std::size_t j = 0; j < n_b; ++j) {
+      vb.push_back(random_particle(1.5));
+    }
+    std::vector<std::vector<double>> d(n_a, std::vector<double>(n_b));
+    for (std::size_t i = 0; i < n_a; ++i) {
+      for (std::size_t j = 0; j < n_b; ++j) {
+        d[i][j] = delta_r(va[i], vb[j]);
+      }
+    }
+    // greedy: repeatedly the closest remaining pair
+    std::vector<std::pair<std::size_t, std::size_t>> expected;
+    std::vector<bool> used_a(n_a), used_b(n_b);
+    for (;;) {
+      double d_min{cut};
+      std::size_t i_min{n_a}, j_min{n_b};
+      for (std::size_t i = 0; i < n_a; ++i) {
+        for (std::size_t j = 0; j < n_b; ++j) {
+          if (!used_a[i] && !used_b[j] && d[i][j] <= d_min) {
+            if (i_min == n_a || d[i][j] < d_min) {
+              d_min = d[i][j];
+              i_min = i;
+              j_min = j;
+            }
+          }
+        }
+      }
+      if (i_min == n_a) {
+        break;
+      }
+      used_a[i_min] = used_b[j_min] = true;
+      expected.emplace_back(i_min, j_min);
+    }
+    std::sort(expected.begin(), expected.end());
+    const auto greedy = physics::match_delta_r(va, vb, cut);
+    std::vector<std::pair<std::size_t, std::size_t>> found;
+    for (const auto& m : greedy) {
+      found.emplace_back(m.first, m.second);
+      BOOST_CHECK((std::fabs(m.delta_r - d[m.first][m.second]) < 1e-12));
+    }
+    BOOST_CHECK((found == expected));
+    // optimal: as many matches as possible, with the smallest sum
+    const auto optimal =
+        physics::match_delta_r(va, vb, cut, match_strategy::optimal);
+    std::vector<bool> used(n_b);
+    const auto best = best_matching(d, cut, 0, used);
+    double sum{0};
+    std::vector<bool> seen_b(n_b);
+    for (std::size_t k = 0; k < optimal.size(); ++k) {
+      BOOST_CHECK((optimal[k].delta_r <= cut && !seen_b[optimal[k].second]));
+      BOOST_CHECK((k == 0 || optimal[k - 1].first < optimal[k].first));
+      seen_b[optimal[k].second] = true;
+      sum += optimal[k].delta_r;
+    }
+    BOOST_CHECK((optimal.size() == best.first &&
+                 std::fabs(sum - best.second) < 1e-9));
+  }
+  // a larger event, with a lorentzvector_array
+  array_type truth, reco;
+  for (int i = 0; i < 300; ++i) {
+    const auto p = random_particle(4.);
+    truth.push_back({energy_MeV_type{p.x0},
+                     {energy_MeV_type{p.x.x1}, energy_MeV_type{p.x.x2},
+                      energy_MeV_type{p.x.x3}}});
+    reco.push_back({energy_MeV_type{p.x0},
+                    {energy_MeV_type{p.x.x1 * 1.01}, energy_MeV_type{p.x.x2},
+                     energy_MeV_type{p.x.x3 * 0.99}}});
+  }
+  const auto matches =
+      physics::match_delta_r(reco, truth, 0.1, match_strategy::optimal);
+  BOOST_CHECK((matches.size() == 300));
+  BOOST_CHECK_THROW(physics::match_delta_r(reco, truth, 0.),
+                    physics::matching_error);
+}